@@ -0,0 +1,59 @@
+// Cycle counter used to time single calls in the latency benchmark
+//
+// Reads the time stamp counter on x86 and the virtual counter on AArch64, both of which tick at a constant rate on
+// current hardware, and falls back to `CLOCK_MONOTONIC` elsewhere. `bench_clock_calibrate()` measures the rate against
+// `CLOCK_MONOTONIC` so ticks can be reported in nanoseconds.
+
+#ifndef CLOGGER_BENCH_CLOCK_H
+#define CLOGGER_BENCH_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static inline uint64_t bench_clock_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // Keep the read from being reordered around the call being timed
+    _mm_lfence();
+    uint64_t ticks = __rdtsc();
+    _mm_lfence();
+
+    return ticks;
+#elif defined(__aarch64__)
+    uint64_t ticks;
+
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(ticks) :: "memory");
+
+    return ticks;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+#endif
+}
+
+// Ticks per nanosecond
+static inline double bench_clock_calibrate()
+{
+    struct timespec start, now;
+    long long elapsed_ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t start_ticks = bench_clock_ticks();
+
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed_ns = (long long) (now.tv_sec - start.tv_sec) * 1000000000LL + (now.tv_nsec - start.tv_nsec);
+    } while (elapsed_ns < 50000000LL);
+
+    return (double) (bench_clock_ticks() - start_ticks) / (double) elapsed_ns;
+}
+
+#endif //CLOGGER_BENCH_CLOCK_H
@@ -0,0 +1,739 @@
+// Throughput and latency benchmark for the clogger entry points
+//
+// Every case is run with 1, 2, 4, ... up to `--threads` producer threads, each logging `--messages` messages. Console
+// output goes to /dev/null so the terminal doesn't dominate the numbers, the results are written as CSV or JSON to the
+// original stdout or to `--output`.
+//
+// In throughput mode the whole run is timed, including waiting for queued messages to be written. In latency mode
+// every call is timed with the cycle counter and the percentiles of the call times are reported instead, which shows
+// the stalls an average hides.
+//
+// Wakeup mode compares the async backend's wait strategies instead of the cases: a single thread queues a message every
+// `--gap-us`, long enough for the backend to go idle, and times how long it takes to be written. The CPU time the
+// process burns over the run is reported alongside.
+
+#include <clogger.h>
+
+#include "bench_clock.h"
+#include "histogram.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef CLOGGER_VERSION
+#define CLOGGER_VERSION "unknown"
+#endif
+
+#define BENCH_FILE_PATH "clogger_bench.log"
+
+#define BENCH_MAX_MESSAGE_SIZE 65536
+
+// Wakeup mode sends this many times fewer messages, each one is followed by a gap
+#define BENCH_WAKEUP_DIVISOR 100
+
+typedef enum bench_mode
+{
+    BENCH_MODE_THROUGHPUT,
+    BENCH_MODE_LATENCY,
+    BENCH_MODE_WAKEUP
+} bench_mode_t;
+
+typedef struct bench_strategy
+{
+    const char* name;
+    clog_async_wait_strategy_t strategy;
+} bench_strategy_t;
+
+static const bench_strategy_t bench_strategies[] = {
+        {"adaptive", CLOG_ASYNC_WAIT_ADAPTIVE},
+        {"spin", CLOG_ASYNC_WAIT_BUSY_SPIN},
+        {"yield", CLOG_ASYNC_WAIT_YIELD},
+        {"sleep", CLOG_ASYNC_WAIT_SLEEP}
+};
+
+typedef struct bench_case
+{
+    const char* name;
+    void (* setup)();
+    void (* log)(size_t index);
+    void (* drain)(); // Timed, waits for everything logged to be written
+    void (* teardown)();
+    size_t divisor; // Slow cases log this many times fewer messages
+} bench_case_t;
+
+typedef struct bench_options
+{
+    size_t max_threads;
+    size_t messages;
+    size_t message_size;
+    const char* filter;
+    int json;
+    bench_mode_t mode;
+    const bench_strategy_t* strategy; // `NULL` for the default, or every strategy in wakeup mode
+    int cpu;
+    unsigned int gap_us;
+    FILE* output;
+} bench_options_t;
+
+// Holds the producers back until every one of them exists (macOS has no `pthread_barrier_t`)
+typedef struct bench_worker
+{
+    const bench_case_t* bench;
+    size_t messages;
+    int latency;
+    int started;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+} bench_worker_t;
+
+typedef struct bench_producer
+{
+    bench_worker_t* worker;
+    pthread_t thread;
+    bench_histogram_t histogram;
+} bench_producer_t;
+
+static clogger_t unfiltered_logger;
+static clogger_t filtered_logger;
+static clogger_t file_logger;
+
+// The built-in file layout spelled out as a pattern, to compare the two
+#define BENCH_LAYOUT "%t >> %{%n >> %}%{[%L] >> %}%{%loc >> %}%m"
+
+// Used by the cases that start the backend
+static clog_async_config_t backend_config;
+
+// Text logged with every message, `--size` characters long
+static char payload[BENCH_MAX_MESSAGE_SIZE + 1];
+
+static long long now_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void nothing()
+{
+}
+
+static void log_clog_message(size_t index)
+{
+    clog_message(__FUNCTION__, "Message %zu: %s", index, payload);
+}
+
+static void log_clogger_info(size_t index)
+{
+    clogger_info(&unfiltered_logger, __FUNCTION__, "Message %zu: %s", index, payload);
+}
+
+static void log_clogger_info_filtered(size_t index)
+{
+    clogger_info(&filtered_logger, __FUNCTION__, "Message %zu: %s", index, payload);
+}
+
+static void log_clog_message_async(size_t index)
+{
+    clog_ticket_t ticket = clog_message_async(__FUNCTION__, "Message %zu: %s", index, payload);
+
+    // Without the backend every call has a thread of its own, don't let them pile up
+    if (!clog_async_is_running())
+    {
+        clog_wait(ticket);
+    }
+}
+
+static void log_clogger_info_async(size_t index)
+{
+    clog_ticket_t ticket = clogger_info_async(&unfiltered_logger, __FUNCTION__, "Message %zu: %s", index, payload);
+
+    // Without the backend every call has a thread of its own, don't let them pile up
+    if (!clog_async_is_running())
+    {
+        clog_wait(ticket);
+    }
+}
+
+static void log_clog_append_to_file(size_t index)
+{
+    clog_append_to_file(BENCH_FILE_PATH, __FUNCTION__, "Message %zu: %s", index, payload);
+}
+
+static void log_file_sink(size_t index)
+{
+    clogger_info(&file_logger, __FUNCTION__, "Message %zu: %s", index, payload);
+}
+
+static void log_file_sink_repeated(size_t index)
+{
+    (void) index;
+    clogger_info(&file_logger, __FUNCTION__, "Repeated message: %s", payload);
+}
+
+static void log_file_sink_kv(size_t index)
+{
+    clogger_info_kv(&file_logger, __FUNCTION__, "Message", CLOG_KV_UINT("index", index), CLOG_KV_STR("text", payload));
+}
+
+static void start_backend()
+{
+    clog_async_start(&backend_config);
+}
+
+static void start_backend_thread_buffers()
+{
+    clog_async_config_t config = backend_config;
+
+    config.mode = CLOG_ASYNC_THREAD_BUFFERS;
+    clog_async_start(&config);
+}
+
+static void stop_backend()
+{
+    clog_async_stop();
+}
+
+static void open_file_sink()
+{
+    remove(BENCH_FILE_PATH);
+    file_logger.file_sink = clog_file_sink_open(BENCH_FILE_PATH, CLOGGER_FILE_SINK_DEFAULT_BUFFER_SIZE, 0);
+}
+
+static void close_file_sink()
+{
+    clog_file_sink_close(file_logger.file_sink);
+    file_logger.file_sink = NULL;
+    remove(BENCH_FILE_PATH);
+}
+
+static void open_file_sink_layout()
+{
+    open_file_sink();
+    file_logger.layout = clog_layout_compile(BENCH_LAYOUT);
+}
+
+static void close_file_sink_layout()
+{
+    close_file_sink();
+    clog_layout_free((clog_layout_t*) file_logger.layout);
+    file_logger.layout = NULL;
+}
+
+static void open_file_sink_dedup()
+{
+    open_file_sink();
+    clog_set_dedup(CLOG_DEDUP_TEXT, 0);
+}
+
+static void close_file_sink_dedup()
+{
+    clog_set_dedup(CLOG_DEDUP_OFF, 0);
+    close_file_sink();
+}
+
+static void open_binary_sink()
+{
+    remove(BENCH_FILE_PATH);
+    file_logger.binary_sink = clog_binary_sink_open(BENCH_FILE_PATH, CLOGGER_BINARY_SINK_DEFAULT_BUFFER_SIZE, 0);
+}
+
+static void close_binary_sink()
+{
+    clog_binary_sink_close(file_logger.binary_sink);
+    file_logger.binary_sink = NULL;
+    remove(BENCH_FILE_PATH);
+}
+
+static void remove_file()
+{
+    remove(BENCH_FILE_PATH);
+}
+
+static const bench_case_t bench_cases[] = {
+        {"clog_message", nothing, log_clog_message, clog_flush, nothing, 1},
+        {"clogger_info", nothing, log_clogger_info, clog_flush, nothing, 1},
+        {"clogger_info_filtered", nothing, log_clogger_info_filtered, nothing, nothing, 1},
+        {"clog_message_async_thread", nothing, log_clog_message_async, clog_flush, nothing, 100},
+        {"clogger_info_async_thread", nothing, log_clogger_info_async, clog_flush, nothing, 100},
+        {"clog_message_async_backend", start_backend, log_clog_message_async, clog_flush, stop_backend, 1},
+        {"clogger_info_async_backend", start_backend, log_clogger_info_async, clog_flush, stop_backend, 1},
+        {"clog_message_async_thread_buffers", start_backend_thread_buffers, log_clog_message_async, clog_flush,
+         stop_backend, 1},
+        {"clog_append_to_file", remove_file, log_clog_append_to_file, nothing, remove_file, 10},
+        {"file_sink", open_file_sink, log_file_sink, clog_flush, close_file_sink, 1},
+        {"file_sink_layout", open_file_sink_layout, log_file_sink, clog_flush, close_file_sink_layout, 1},
+        {"file_sink_kv", open_file_sink, log_file_sink_kv, clog_flush, close_file_sink, 1},
+        {"file_sink_dedup", open_file_sink_dedup, log_file_sink_repeated, clog_flush, close_file_sink_dedup, 1},
+        {"binary_sink", open_binary_sink, log_file_sink, clog_flush, close_binary_sink, 1}
+};
+
+static void* bench_thread(void* args)
+{
+    bench_producer_t* producer = args;
+    bench_worker_t* worker = producer->worker;
+
+    pthread_mutex_lock(&worker->mutex);
+
+    while (!worker->started)
+    {
+        pthread_cond_wait(&worker->start, &worker->mutex);
+    }
+
+    pthread_mutex_unlock(&worker->mutex);
+
+    if (worker->latency)
+    {
+        for (size_t i = 0; i < worker->messages; i++)
+        {
+            uint64_t start = bench_clock_ticks();
+
+            worker->bench->log(i);
+
+            bench_histogram_record(&producer->histogram, bench_clock_ticks() - start);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < worker->messages; i++)
+        {
+            worker->bench->log(i);
+        }
+    }
+
+    return NULL;
+}
+
+static void report_throughput(const bench_case_t* bench, size_t threads, size_t total, long long elapsed,
+                              const bench_options_t* options, int first)
+{
+    double seconds = (double) elapsed / 1e9;
+    double per_second = seconds > 0 ? (double) total / seconds : 0;
+    double ns_per_message = (double) elapsed / (double) total;
+
+    if (options->json)
+    {
+        fprintf(options->output,
+                "%s    {\"case\": \"%s\", \"threads\": %zu, \"message_size\": %zu, \"messages\": %zu, "
+                "\"seconds\": %.6f, \"messages_per_second\": %.1f, \"ns_per_message\": %.1f}",
+                first ? "" : ",\n", bench->name, threads, options->message_size, total, seconds, per_second,
+                ns_per_message);
+    }
+    else
+    {
+        fprintf(options->output, "%s,%zu,%zu,%zu,%.6f,%.1f,%.1f\n", bench->name, threads, options->message_size, total,
+                seconds, per_second, ns_per_message);
+    }
+}
+
+static void report_latency(const bench_case_t* bench, size_t threads, const bench_histogram_t* histogram,
+                           double ticks_per_ns, const bench_options_t* options, int first)
+{
+    double p50 = (double) bench_histogram_percentile(histogram, 50.0) / ticks_per_ns;
+    double p99 = (double) bench_histogram_percentile(histogram, 99.0) / ticks_per_ns;
+    double p999 = (double) bench_histogram_percentile(histogram, 99.9) / ticks_per_ns;
+    double max = (double) histogram->max / ticks_per_ns;
+
+    if (options->json)
+    {
+        fprintf(options->output,
+                "%s    {\"case\": \"%s\", \"threads\": %zu, \"message_size\": %zu, \"samples\": %llu, "
+                "\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p99_9_ns\": %.0f, \"max_ns\": %.0f}",
+                first ? "" : ",\n", bench->name, threads, options->message_size,
+                (unsigned long long) histogram->total, p50, p99, p999, max);
+    }
+    else
+    {
+        fprintf(options->output, "%s,%zu,%zu,%llu,%.0f,%.0f,%.0f,%.0f\n", bench->name, threads, options->message_size,
+                (unsigned long long) histogram->total, p50, p99, p999, max);
+    }
+}
+
+static void run_case(const bench_case_t* bench, size_t threads, double ticks_per_ns, const bench_options_t* options,
+                     int first)
+{
+    int latency = options->mode == BENCH_MODE_LATENCY;
+    size_t messages = options->messages / bench->divisor;
+    bench_producer_t* producers = calloc(threads, sizeof(bench_producer_t));
+    bench_worker_t worker = {bench, 0, latency, CLOGGER_FALSE, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    bench_histogram_t histogram = {NULL, 0, 0};
+
+    if (messages == 0)
+    {
+        messages = 1;
+    }
+
+    if (producers == NULL || (latency && !bench_histogram_init(&histogram)))
+    {
+        free(producers);
+        return;
+    }
+
+    worker.messages = messages;
+    bench->setup();
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        producers[i].worker = &worker;
+
+        if (latency)
+        {
+            bench_histogram_init(&producers[i].histogram);
+        }
+
+        pthread_create(&producers[i].thread, NULL, bench_thread, &producers[i]);
+    }
+
+    long long start = now_ns();
+
+    pthread_mutex_lock(&worker.mutex);
+    worker.started = CLOGGER_TRUE;
+    pthread_cond_broadcast(&worker.start);
+    pthread_mutex_unlock(&worker.mutex);
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_join(producers[i].thread, NULL);
+    }
+
+    bench->drain();
+
+    long long elapsed = now_ns() - start;
+
+    bench->teardown();
+
+    if (latency)
+    {
+        for (size_t i = 0; i < threads; i++)
+        {
+            bench_histogram_merge(&histogram, &producers[i].histogram);
+            bench_histogram_free(&producers[i].histogram);
+        }
+
+        report_latency(bench, threads, &histogram, ticks_per_ns, options, first);
+        bench_histogram_free(&histogram);
+    }
+    else
+    {
+        report_throughput(bench, threads, messages * threads, elapsed, options, first);
+    }
+
+    fflush(options->output);
+    free(producers);
+}
+
+static long long cpu_time_ns()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return ((long long) usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL
+           + ((long long) usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+}
+
+static void run_wakeup(const bench_strategy_t* strategy, double ticks_per_ns, const bench_options_t* options,
+                       int first)
+{
+    size_t samples = options->messages / BENCH_WAKEUP_DIVISOR;
+    struct timespec gap = {options->gap_us / 1000000, (long) (options->gap_us % 1000000) * 1000L};
+    clog_async_config_t config = backend_config;
+    bench_histogram_t histogram;
+
+    if (samples == 0)
+    {
+        samples = 1;
+    }
+
+    config.wait_strategy = strategy->strategy;
+
+    if (!bench_histogram_init(&histogram) || !clog_async_start(&config))
+    {
+        bench_histogram_free(&histogram);
+        return;
+    }
+
+    long long start = now_ns();
+    long long start_cpu = cpu_time_ns();
+
+    for (size_t i = 0; i < samples; i++)
+    {
+        nanosleep(&gap, NULL);
+
+        uint64_t sent = bench_clock_ticks();
+
+        clog_wait(clog_message_async(__FUNCTION__, "Message %zu: %s", i, payload));
+        bench_histogram_record(&histogram, bench_clock_ticks() - sent);
+    }
+
+    double cpu_percent = 100.0 * (double) (cpu_time_ns() - start_cpu) / (double) (now_ns() - start);
+
+    clog_async_stop();
+
+    double p50 = (double) bench_histogram_percentile(&histogram, 50.0) / ticks_per_ns;
+    double p99 = (double) bench_histogram_percentile(&histogram, 99.0) / ticks_per_ns;
+    double max = (double) histogram.max / ticks_per_ns;
+
+    if (options->json)
+    {
+        fprintf(options->output,
+                "%s    {\"strategy\": \"%s\", \"cpu\": %d, \"samples\": %zu, \"gap_us\": %u, \"p50_ns\": %.0f, "
+                "\"p99_ns\": %.0f, \"max_ns\": %.0f, \"cpu_percent\": %.1f}",
+                first ? "" : ",\n", strategy->name, config.cpu, samples, options->gap_us, p50, p99, max, cpu_percent);
+    }
+    else
+    {
+        fprintf(options->output, "%s,%d,%zu,%u,%.0f,%.0f,%.0f,%.1f\n", strategy->name, config.cpu, samples,
+                options->gap_us, p50, p99, max, cpu_percent);
+    }
+
+    fflush(options->output);
+    bench_histogram_free(&histogram);
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --threads N    Largest number of producer threads, swept in powers of two (default: 4)\n"
+            "  --messages N   Messages logged by each thread (default: 100000)\n"
+            "  --size N       Characters of text in each message (default: 32)\n"
+            "  --mode MODE    throughput, latency or wakeup (default: throughput)\n"
+            "  --case NAME    Only run cases whose name contains NAME\n"
+            "  --wait NAME    Backend wait strategy: adaptive, spin, yield or sleep (default: adaptive, or all\n"
+            "                 of them in wakeup mode)\n"
+            "  --cpu N        Pin the backend thread to CPU N\n"
+            "  --gap-us N     Microseconds between messages in wakeup mode (default: 1000)\n"
+            "  --format FMT   csv or json (default: csv)\n"
+            "  --output FILE  Write the results to FILE instead of stdout\n"
+            "  --list         List the cases and exit\n",
+            program);
+}
+
+static int parse_options(int argc, char** argv, bench_options_t* options)
+{
+    *options = (bench_options_t) {4, 100000, 32, NULL, CLOGGER_FALSE, BENCH_MODE_THROUGHPUT, NULL, -1, 1000, NULL};
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(argv[i], "--list") == 0)
+        {
+            for (size_t j = 0; j < sizeof bench_cases / sizeof bench_cases[0]; j++)
+            {
+                printf("%s\n", bench_cases[j].name);
+            }
+
+            exit(EXIT_SUCCESS);
+        }
+        else if (value == NULL)
+        {
+            return CLOGGER_FALSE;
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            options->max_threads = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(argv[i], "--messages") == 0)
+        {
+            options->messages = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(argv[i], "--size") == 0)
+        {
+            options->message_size = strtoul(value, NULL, 10);
+
+            if (options->message_size > BENCH_MAX_MESSAGE_SIZE)
+            {
+                return CLOGGER_FALSE;
+            }
+        }
+        else if (strcmp(argv[i], "--mode") == 0)
+        {
+            if (strcmp(value, "latency") == 0)
+            {
+                options->mode = BENCH_MODE_LATENCY;
+            }
+            else if (strcmp(value, "wakeup") == 0)
+            {
+                options->mode = BENCH_MODE_WAKEUP;
+            }
+            else if (strcmp(value, "throughput") != 0)
+            {
+                return CLOGGER_FALSE;
+            }
+        }
+        else if (strcmp(argv[i], "--wait") == 0)
+        {
+            for (size_t j = 0; j < sizeof bench_strategies / sizeof bench_strategies[0]; j++)
+            {
+                if (strcmp(value, bench_strategies[j].name) == 0)
+                {
+                    options->strategy = &bench_strategies[j];
+                }
+            }
+
+            if (options->strategy == NULL)
+            {
+                return CLOGGER_FALSE;
+            }
+        }
+        else if (strcmp(argv[i], "--cpu") == 0)
+        {
+            options->cpu = atoi(value);
+        }
+        else if (strcmp(argv[i], "--gap-us") == 0)
+        {
+            options->gap_us = (unsigned int) strtoul(value, NULL, 10);
+        }
+        else if (strcmp(argv[i], "--case") == 0)
+        {
+            options->filter = value;
+        }
+        else if (strcmp(argv[i], "--format") == 0)
+        {
+            if (strcmp(value, "json") == 0)
+            {
+                options->json = CLOGGER_TRUE;
+            }
+            else if (strcmp(value, "csv") != 0)
+            {
+                return CLOGGER_FALSE;
+            }
+        }
+        else if (strcmp(argv[i], "--output") == 0)
+        {
+            options->output = fopen(value, "w");
+
+            if (options->output == NULL)
+            {
+                perror(value);
+                return CLOGGER_FALSE;
+            }
+        }
+        else
+        {
+            return CLOGGER_FALSE;
+        }
+
+        i++;
+    }
+
+    return options->max_threads > 0 && options->messages > 0;
+}
+
+int main(int argc, char** argv)
+{
+    bench_options_t options;
+
+    if (!parse_options(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Keep the real stdout for the results, the log output itself is thrown away
+    if (options.output == NULL)
+    {
+        options.output = fdopen(dup(STDOUT_FILENO), "w");
+    }
+
+    if (options.output == NULL || freopen("/dev/null", "w", stdout) == NULL)
+    {
+        perror("clogger_bench");
+        return EXIT_FAILURE;
+    }
+
+    memset(payload, 'x', options.message_size);
+    payload[options.message_size] = '\0';
+
+    double ticks_per_ns = options.mode != BENCH_MODE_THROUGHPUT ? bench_clock_calibrate() : 1.0;
+
+    backend_config = clog_async_default_config();
+    backend_config.cpu = options.cpu;
+
+    if (options.strategy != NULL)
+    {
+        backend_config.wait_strategy = options.strategy->strategy;
+    }
+
+    unfiltered_logger = make_clogger("bench");
+    unfiltered_logger.log_level = CLOG_LEVEL_INFO;
+
+    filtered_logger = make_clogger("bench");
+    filtered_logger.log_level = CLOG_LEVEL_ERROR;
+
+    file_logger = make_clogger("bench");
+    file_logger.log_level = CLOG_LEVEL_INFO;
+
+    if (options.json)
+    {
+        static const char* mode_names[] = {"throughput", "latency", "wakeup"};
+
+        fprintf(options.output, "{\n  \"clogger_version\": \"%s\",\n  \"mode\": \"%s\",\n  \"results\": [\n",
+                CLOGGER_VERSION, mode_names[options.mode]);
+    }
+    else if (options.mode == BENCH_MODE_WAKEUP)
+    {
+        fprintf(options.output, "strategy,cpu,samples,gap_us,p50_ns,p99_ns,max_ns,cpu_percent\n");
+    }
+    else if (options.mode == BENCH_MODE_LATENCY)
+    {
+        fprintf(options.output, "case,threads,message_size,samples,p50_ns,p99_ns,p99_9_ns,max_ns\n");
+    }
+    else
+    {
+        fprintf(options.output, "case,threads,message_size,messages,seconds,messages_per_second,ns_per_message\n");
+    }
+
+    int first = CLOGGER_TRUE;
+
+    for (size_t i = 0; options.mode == BENCH_MODE_WAKEUP && i < sizeof bench_strategies / sizeof bench_strategies[0];
+         i++)
+    {
+        if (options.strategy == NULL || options.strategy == &bench_strategies[i])
+        {
+            run_wakeup(&bench_strategies[i], ticks_per_ns, &options, first);
+            first = CLOGGER_FALSE;
+        }
+    }
+
+    for (size_t i = 0; options.mode != BENCH_MODE_WAKEUP && i < sizeof bench_cases / sizeof bench_cases[0]; i++)
+    {
+        if (options.filter != NULL && strstr(bench_cases[i].name, options.filter) == NULL)
+        {
+            continue;
+        }
+
+        for (size_t threads = 1;; threads *= 2)
+        {
+            if (threads > options.max_threads)
+            {
+                threads = options.max_threads;
+            }
+
+            run_case(&bench_cases[i], threads, ticks_per_ns, &options, first);
+            first = CLOGGER_FALSE;
+
+            if (threads == options.max_threads)
+            {
+                break;
+            }
+        }
+    }
+
+    if (options.json)
+    {
+        fprintf(options.output, "\n  ]\n}\n");
+    }
+
+    fclose(options.output);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include "histogram.h"
+
+#include <stdlib.h>
+
+// 2^11 sub-buckets in the first bucket, then each bucket doubles the range with the upper half of the sub-buckets
+#define BENCH_SUB_BUCKET_BITS 11
+#define BENCH_SUB_BUCKET_HALF (1u << (BENCH_SUB_BUCKET_BITS - 1))
+#define BENCH_HISTOGRAM_SIZE ((64 - BENCH_SUB_BUCKET_BITS + 2) * BENCH_SUB_BUCKET_HALF)
+
+static unsigned int highest_bit(uint64_t value)
+{
+    unsigned int result = 0;
+
+    while (value >>= 1)
+    {
+        result++;
+    }
+
+    return result;
+}
+
+static size_t index_of(uint64_t value)
+{
+    if (value < 2 * BENCH_SUB_BUCKET_HALF)
+    {
+        return (size_t) value;
+    }
+
+    unsigned int bucket = highest_bit(value) - (BENCH_SUB_BUCKET_BITS - 1);
+
+    return (size_t) bucket * BENCH_SUB_BUCKET_HALF + (size_t) (value >> bucket);
+}
+
+// Highest value counted at `index`
+static uint64_t value_at(size_t index)
+{
+    if (index < 2 * BENCH_SUB_BUCKET_HALF)
+    {
+        return index;
+    }
+
+    unsigned int bucket = (unsigned int) (index / BENCH_SUB_BUCKET_HALF) - 1;
+    uint64_t sub_bucket = index % BENCH_SUB_BUCKET_HALF + BENCH_SUB_BUCKET_HALF;
+
+    return ((sub_bucket + 1) << bucket) - 1;
+}
+
+int bench_histogram_init(bench_histogram_t* histogram)
+{
+    histogram->counts = calloc(BENCH_HISTOGRAM_SIZE, sizeof(uint64_t));
+    histogram->total = 0;
+    histogram->max = 0;
+
+    return histogram->counts != NULL;
+}
+
+void bench_histogram_free(bench_histogram_t* histogram)
+{
+    free(histogram->counts);
+    histogram->counts = NULL;
+}
+
+void bench_histogram_record(bench_histogram_t* histogram, uint64_t value)
+{
+    histogram->counts[index_of(value)]++;
+    histogram->total++;
+
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+void bench_histogram_merge(bench_histogram_t* histogram, const bench_histogram_t* source)
+{
+    for (size_t i = 0; i < BENCH_HISTOGRAM_SIZE; i++)
+    {
+        histogram->counts[i] += source->counts[i];
+    }
+
+    histogram->total += source->total;
+
+    if (source->max > histogram->max)
+    {
+        histogram->max = source->max;
+    }
+}
+
+uint64_t bench_histogram_percentile(const bench_histogram_t* histogram, double percentile)
+{
+    uint64_t target = (uint64_t) (percentile / 100.0 * (double) histogram->total + 0.5);
+    uint64_t seen = 0;
+
+    if (target == 0)
+    {
+        target = 1;
+    }
+
+    if (target >= histogram->total)
+    {
+        return histogram->max;
+    }
+
+    for (size_t i = 0; i < BENCH_HISTOGRAM_SIZE; i++)
+    {
+        seen += histogram->counts[i];
+
+        if (seen >= target)
+        {
+            uint64_t value = value_at(i);
+
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
@@ -0,0 +1,30 @@
+// HDR-style latency histogram for the benchmark
+//
+// Values are counted in log-linear buckets: exact below 2048, and within 1/1024 of the value above, so any 64-bit
+// value can be recorded in constant time with three significant digits of precision.
+
+#ifndef CLOGGER_BENCH_HISTOGRAM_H
+#define CLOGGER_BENCH_HISTOGRAM_H
+
+#include <stdint.h>
+
+typedef struct bench_histogram
+{
+    uint64_t* counts;
+    uint64_t total;
+    uint64_t max;
+} bench_histogram_t;
+
+int bench_histogram_init(bench_histogram_t* histogram);
+
+void bench_histogram_free(bench_histogram_t* histogram);
+
+void bench_histogram_record(bench_histogram_t* histogram, uint64_t value);
+
+// Add every value recorded in `source` to `histogram`
+void bench_histogram_merge(bench_histogram_t* histogram, const bench_histogram_t* source);
+
+// Smallest recorded value that `percentile` percent of the values are less than or equal to, `100` gives the max
+uint64_t bench_histogram_percentile(const bench_histogram_t* histogram, double percentile);
+
+#endif //CLOGGER_BENCH_HISTOGRAM_H
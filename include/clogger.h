@@ -8,5 +8,19 @@
 #include "clogger/clog_assert.h"
 #include "clogger/clog_expect.h"
 #include "clogger/clogger.h"
+#include "clogger/clog_macros.h"
+#include "clogger/site.h"
+#include "clogger/rate_limit.h"
+#include "clogger/async.h"
+#include "clogger/timestamp.h"
+#include "clogger/file_sink.h"
+#include "clogger/binary_sink.h"
+#include "clogger/dedup.h"
+#include "clogger/prepend_sink.h"
+#include "clogger/error_dispatch.h"
+#include "clogger/crash.h"
+#include "clogger/flight_recorder.h"
+#include "clogger/layout.h"
+#include "clogger/kv.h"
 
 #endif //CLOGGER_H
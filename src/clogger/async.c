@@ -0,0 +1,1246 @@
+#include "async.h"
+#include "record.h"
+#include "file_sink.h"
+#include "binary_sink.h"
+#include "dedup.h"
+#include "fileio.h"
+#include "clogger_pch.h"
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "clog.h"
+
+// Iterations the backend spins on an empty queue before going to sleep, also how often a backend that never sleeps
+// does its idle housekeeping
+#define CLOGGER_ASYNC_SPIN_COUNT 256
+
+// Upper bound on how long the backend sleeps, so a missed wake-up can only ever delay a message
+#define CLOGGER_ASYNC_SLEEP_NS 10000000L
+
+#define CLOGGER_CACHE_LINE 64
+
+// Records written between checks for dropped messages to report, besides whenever the backend goes idle
+#define CLOGGER_ASYNC_DROP_CHECK_INTERVAL 1024
+
+// Layout of a `clog_ticket_t`: a message handed to its own thread, or a queue position plus one. Positions in a thread
+// buffer also carry the id of the buffer, positions in the priority lane are flagged
+#define CLOGGER_TICKET_DETACHED (1ULL << 63)
+#define CLOGGER_TICKET_THREAD_BUFFER (1ULL << 62)
+#define CLOGGER_TICKET_PRIORITY (1ULL << 61)
+#define CLOGGER_TICKET_BUFFER_SHIFT 40
+#define CLOGGER_TICKET_BUFFER_MASK ((1ULL << (62 - CLOGGER_TICKET_BUFFER_SHIFT)) - 1)
+#define CLOGGER_TICKET_POSITION_MASK ((1ULL << CLOGGER_TICKET_BUFFER_SHIFT) - 1)
+
+// Bounded multi-producer queue (Vyukov), each slot carries a sequence number telling producers and the consumer
+// whose turn it is, so neither side ever takes a lock
+typedef struct clog_async_slot
+{
+    atomic_size_t sequence;
+    clog_record_t record;
+} clog_async_slot_t;
+
+typedef struct clog_async_queue
+{
+    _Alignas(CLOGGER_CACHE_LINE) atomic_size_t enqueue_position;
+    _Alignas(CLOGGER_CACHE_LINE) atomic_size_t dequeue_position;
+    atomic_size_t completed_position; // Records written or dropped from the queue, with none before them in flight
+    clog_async_slot_t* slots;
+    size_t mask;
+} clog_async_queue_t;
+
+// Single-producer buffer owned by one logging thread in `CLOG_ASYNC_THREAD_BUFFERS` mode. Records are claimed by
+// moving `read_position` with a CAS, normally by the backend but also by the producer when it overwrites the oldest,
+// and `released_position` counts the slots given back to the producer afterwards
+typedef struct clog_async_thread_buffer
+{
+    _Alignas(CLOGGER_CACHE_LINE) atomic_size_t write_position;
+    _Alignas(CLOGGER_CACHE_LINE) atomic_size_t read_position;
+    atomic_size_t released_position;
+    _Alignas(CLOGGER_CACHE_LINE) atomic_int abandoned; // Set once the owning thread has exited
+    clog_record_t* records;
+    _Atomic(long long)* stamps; // Timestamp of each record in ns, so the backend can peek at it without claiming
+    size_t mask;
+    unsigned long long id;
+    struct clog_async_thread_buffer* next;
+} clog_async_thread_buffer_t;
+
+typedef struct clog_async_backend
+{
+    clog_async_queue_t queue; // Unused in `CLOG_ASYNC_THREAD_BUFFERS` mode
+    clog_async_queue_t priority; // `ERROR` and above, always drained first
+    _Alignas(CLOGGER_CACHE_LINE) atomic_size_t dropped;
+    _Alignas(CLOGGER_CACHE_LINE) atomic_int running;
+    atomic_int sleeping;
+    atomic_int stopping;
+    atomic_int waiters; // Threads blocked in `wait_until()`
+    atomic_int draining; // Set for good by `clog_async_halt_safe()`, the backend leaves the queue alone from then on
+    atomic_int writing; // Set while the backend is taking a record from the queue
+    clog_async_mode_t mode;
+    clog_backpressure_t backpressure;
+    clog_async_wait_strategy_t wait_strategy;
+    size_t thread_mask;
+    size_t sync_threshold;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t completed;
+} clog_async_backend_t;
+
+static clog_async_backend_t backend = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .wake = PTHREAD_COND_INITIALIZER,
+        .completed = PTHREAD_COND_INITIALIZER
+};
+
+// Messages handed to a thread of their own because the backend wasn't running
+static size_t detached_pending = 0;
+static pthread_mutex_t detached_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t detached_done = PTHREAD_COND_INITIALIZER;
+
+static pthread_mutex_t lifecycle_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Every registered thread buffer, threads push themselves at the head and only the backend unlinks
+static _Atomic(clog_async_thread_buffer_t*) thread_buffers = NULL;
+static _Thread_local clog_async_thread_buffer_t* thread_buffer = NULL;
+static pthread_mutex_t thread_buffers_mutex = PTHREAD_MUTEX_INITIALIZER; // Held while a buffer is released
+static pthread_key_t thread_buffer_key;
+static pthread_once_t thread_buffer_key_once = PTHREAD_ONCE_INIT;
+static atomic_ullong next_thread_buffer_id = 0;
+
+typedef struct clog_async_buffer_target
+{
+    clog_async_thread_buffer_t* buffer;
+    size_t position;
+} clog_async_buffer_target_t;
+
+typedef struct clog_async_queue_target
+{
+    clog_async_queue_t* queue;
+    size_t position;
+} clog_async_queue_target_t;
+
+static size_t round_up_power_of_two(size_t value)
+{
+    size_t result = 2;
+
+    while (result < value)
+    {
+        result <<= 1;
+    }
+
+    return result;
+}
+
+// Tell the core we're spinning, so a sibling hyperthread gets the pipeline and the loop doesn't hammer the bus
+static inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield" ::: "memory");
+#endif
+}
+
+static void wake_backend()
+{
+    // Pairs with the flag store in `backend_sleep()`, so either the backend sees the record or we see the flag
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&backend.sleeping, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&backend.mutex);
+        pthread_cond_signal(&backend.wake);
+        pthread_mutex_unlock(&backend.mutex);
+    }
+}
+
+// Wake the threads blocked in `wait_until()`
+static void notify_waiters()
+{
+    // Pairs with the increment in `wait_until()`, so either the waiter sees the progress or we see the waiter
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&backend.waiters, memory_order_relaxed) > 0)
+    {
+        pthread_mutex_lock(&backend.mutex);
+        pthread_cond_broadcast(&backend.completed);
+        pthread_mutex_unlock(&backend.mutex);
+    }
+}
+
+static int timespec_before(const struct timespec* a, const struct timespec* b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+// Block until `done()` holds or the backend has stopped, which drains it. Gives up once `deadline` passes, unless it's
+// `NULL`
+static int wait_until(int (* done)(const void*), const void* argument, const struct timespec* deadline)
+{
+    int result = CLOGGER_TRUE;
+
+    // Most waits are short, try not to sleep
+    for (int i = 0; i < CLOGGER_ASYNC_SPIN_COUNT; i++)
+    {
+        if (done(argument) || !clog_async_is_running())
+        {
+            return CLOGGER_TRUE;
+        }
+
+        wake_backend();
+        sched_yield();
+    }
+
+    pthread_mutex_lock(&backend.mutex);
+    atomic_fetch_add(&backend.waiters, 1);
+
+    while (!done(argument) && clog_async_is_running())
+    {
+        struct timespec now, until;
+
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        if (deadline != NULL && !timespec_before(&now, deadline))
+        {
+            result = CLOGGER_FALSE;
+            break;
+        }
+
+        // Bounded like the backend's own sleep, so a missed wake-up can only ever delay us
+        until = now;
+        until.tv_nsec += CLOGGER_ASYNC_SLEEP_NS;
+
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+
+        if (deadline != NULL && timespec_before(deadline, &until))
+        {
+            until = *deadline;
+        }
+
+        pthread_cond_signal(&backend.wake);
+        pthread_cond_timedwait(&backend.completed, &backend.mutex, &until);
+    }
+
+    atomic_fetch_sub(&backend.waiters, 1);
+    pthread_mutex_unlock(&backend.mutex);
+
+    return result;
+}
+
+static int position_reached(const void* target)
+{
+    const clog_async_queue_target_t* queue_target = target;
+
+    return atomic_load_explicit(&queue_target->queue->completed_position, memory_order_acquire)
+           >= queue_target->position;
+}
+
+static int buffer_position_reached(const void* target)
+{
+    const clog_async_buffer_target_t* buffer_target = target;
+
+    return atomic_load_explicit(&buffer_target->buffer->released_position, memory_order_acquire)
+           >= buffer_target->position;
+}
+
+static int wait_for_detached(const struct timespec* deadline)
+{
+    int result = CLOGGER_TRUE;
+
+    pthread_mutex_lock(&detached_mutex);
+
+    while (detached_pending > 0 && result)
+    {
+        if (deadline == NULL)
+        {
+            pthread_cond_wait(&detached_done, &detached_mutex);
+        }
+        else if (pthread_cond_timedwait(&detached_done, &detached_mutex, deadline) != 0)
+        {
+            result = detached_pending == 0;
+        }
+    }
+
+    pthread_mutex_unlock(&detached_mutex);
+
+    return result;
+}
+
+static void abandon_thread_buffer(void* buffer)
+{
+    atomic_store_explicit(&((clog_async_thread_buffer_t*) buffer)->abandoned, CLOGGER_TRUE, memory_order_release);
+}
+
+static void create_thread_buffer_key()
+{
+    pthread_key_create(&thread_buffer_key, abandon_thread_buffer);
+}
+
+// Get the calling thread's buffer, creating and registering it on first use
+static clog_async_thread_buffer_t* get_thread_buffer()
+{
+    if (thread_buffer != NULL)
+    {
+        return thread_buffer;
+    }
+
+    pthread_once(&thread_buffer_key_once, create_thread_buffer_key);
+
+    clog_async_thread_buffer_t* buffer = calloc(1, sizeof(clog_async_thread_buffer_t));
+
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+
+    buffer->mask = backend.thread_mask;
+    buffer->id = atomic_fetch_add(&next_thread_buffer_id, 1) & CLOGGER_TICKET_BUFFER_MASK;
+    buffer->records = malloc((buffer->mask + 1) * sizeof(clog_record_t));
+    buffer->stamps = malloc((buffer->mask + 1) * sizeof(buffer->stamps[0]));
+
+    if (buffer->records == NULL || buffer->stamps == NULL)
+    {
+        free(buffer->records);
+        free(buffer->stamps);
+        free(buffer);
+        return NULL;
+    }
+
+    buffer->next = atomic_load_explicit(&thread_buffers, memory_order_relaxed);
+
+    while (!atomic_compare_exchange_weak_explicit(&thread_buffers, &buffer->next, buffer, memory_order_release,
+                                                  memory_order_relaxed))
+    {
+    }
+
+    pthread_setspecific(thread_buffer_key, buffer);
+    thread_buffer = buffer;
+
+    return buffer;
+}
+
+// Only called by the backend, or once it has stopped
+static void release_thread_buffer(clog_async_thread_buffer_t* previous, clog_async_thread_buffer_t* buffer)
+{
+    if (previous == NULL)
+    {
+        clog_async_thread_buffer_t* expected = buffer;
+
+        if (!atomic_compare_exchange_strong(&thread_buffers, &expected, buffer->next))
+        {
+            // Newer buffers were pushed in front of it
+            previous = expected;
+
+            while (previous->next != buffer)
+            {
+                previous = previous->next;
+            }
+        }
+    }
+
+    if (previous != NULL)
+    {
+        previous->next = buffer->next;
+    }
+
+    free(buffer->records);
+    free(buffer->stamps);
+    free(buffer);
+}
+
+// Write out the oldest record across the thread buffers, if any, releasing the buffers of exited threads on the way
+static int collect_one()
+{
+    clog_async_thread_buffer_t* previous = NULL;
+    clog_async_thread_buffer_t* oldest = NULL;
+    size_t oldest_position = 0;
+    long long oldest_stamp = 0;
+    clog_async_thread_buffer_t* next;
+
+    for (clog_async_thread_buffer_t* buffer = atomic_load_explicit(&thread_buffers, memory_order_acquire);
+         buffer != NULL; buffer = next)
+    {
+        int abandoned = atomic_load_explicit(&buffer->abandoned, memory_order_acquire);
+        size_t position = atomic_load_explicit(&buffer->read_position, memory_order_relaxed);
+
+        next = buffer->next;
+
+        if (atomic_load_explicit(&buffer->write_position, memory_order_acquire) == position)
+        {
+            // Left for the next pass if `clog_async_flush()` is walking the list
+            if (abandoned && pthread_mutex_trylock(&thread_buffers_mutex) == 0)
+            {
+                release_thread_buffer(previous, buffer);
+                pthread_mutex_unlock(&thread_buffers_mutex);
+                continue;
+            }
+        }
+        else
+        {
+            long long stamp = atomic_load_explicit(&buffer->stamps[position & buffer->mask], memory_order_relaxed);
+
+            if (oldest == NULL || stamp < oldest_stamp)
+            {
+                oldest = buffer;
+                oldest_position = position;
+                oldest_stamp = stamp;
+            }
+        }
+
+        previous = buffer;
+    }
+
+    if (oldest == NULL)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    // The producer may have overwritten it since, in which case the next pass picks again
+    if (atomic_compare_exchange_strong_explicit(&oldest->read_position, &oldest_position, oldest_position + 1,
+                                                memory_order_acquire, memory_order_relaxed))
+    {
+        clog_record_write(&oldest->records[oldest_position & oldest->mask]);
+        atomic_fetch_add_explicit(&oldest->released_position, 1, memory_order_release);
+        notify_waiters();
+    }
+
+    return CLOGGER_TRUE;
+}
+
+static int thread_buffers_are_empty()
+{
+    for (clog_async_thread_buffer_t* buffer = atomic_load_explicit(&thread_buffers, memory_order_acquire);
+         buffer != NULL; buffer = buffer->next)
+    {
+        if (atomic_load_explicit(&buffer->write_position, memory_order_acquire)
+            != atomic_load_explicit(&buffer->read_position, memory_order_relaxed))
+        {
+            return CLOGGER_FALSE;
+        }
+    }
+
+    return CLOGGER_TRUE;
+}
+
+// Drop the oldest record of a full thread buffer, unless the backend is busy writing it. Nothing is in flight when it
+// succeeds, so `released_position` can't count past a record that isn't written yet.
+static int drop_oldest_in_buffer(clog_async_thread_buffer_t* buffer)
+{
+    size_t released = atomic_load_explicit(&buffer->released_position, memory_order_acquire);
+    size_t position = released;
+
+    if (!atomic_compare_exchange_strong_explicit(&buffer->read_position, &position, released + 1,
+                                                 memory_order_relaxed, memory_order_relaxed))
+    {
+        return CLOGGER_FALSE;
+    }
+
+    atomic_fetch_add_explicit(&buffer->released_position, 1, memory_order_release);
+    atomic_fetch_add_explicit(&backend.dropped, 1, memory_order_relaxed);
+    notify_waiters();
+
+    return CLOGGER_TRUE;
+}
+
+// Captures the message into the buffer, or copies `source` if it isn't `NULL`
+static int enqueue_thread_buffer(const clog_record_t* source, clog_level_t level, clogger_t* logger,
+                                 const char* location, const char* format, va_list* args, clog_ticket_t* ticket)
+{
+    clog_async_thread_buffer_t* buffer = get_thread_buffer();
+    clog_backpressure_t backpressure = logger != NULL ? logger->backpressure : backend.backpressure;
+
+    if (buffer == NULL)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    size_t position = atomic_load_explicit(&buffer->write_position, memory_order_relaxed);
+
+    while (position - atomic_load_explicit(&buffer->released_position, memory_order_acquire) > buffer->mask)
+    {
+        if (backpressure == CLOG_BACKPRESSURE_DROP_NEWEST)
+        {
+            atomic_fetch_add_explicit(&backend.dropped, 1, memory_order_relaxed);
+            *ticket = CLOG_TICKET_COMPLETED;
+            return CLOGGER_TRUE;
+        }
+
+        if (backpressure == CLOG_BACKPRESSURE_OVERWRITE_OLDEST && drop_oldest_in_buffer(buffer))
+        {
+            break;
+        }
+
+        // Buffer is full, wait for the backend to catch up
+        wake_backend();
+        sched_yield();
+    }
+
+    clog_record_t* record = &buffer->records[position & buffer->mask];
+
+    if (source != NULL)
+    {
+        *record = *source;
+    }
+    else
+    {
+        clog_record_capture(record, level, logger, location, format, *args);
+    }
+    atomic_store_explicit(&buffer->stamps[position & buffer->mask],
+                          (long long) record->timestamp.tv_sec * 1000000000LL + record->timestamp.tv_nsec,
+                          memory_order_relaxed);
+
+    atomic_store_explicit(&buffer->write_position, position + 1, memory_order_release);
+
+    *ticket = CLOGGER_TICKET_THREAD_BUFFER | buffer->id << CLOGGER_TICKET_BUFFER_SHIFT
+              | ((position + 1) & CLOGGER_TICKET_POSITION_MASK);
+
+    wake_backend();
+
+    return CLOGGER_TRUE;
+}
+
+static int queue_is_empty(const clog_async_queue_t* queue)
+{
+    size_t position = atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);
+    clog_async_slot_t* slot = &queue->slots[position & queue->mask];
+
+    return atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1;
+}
+
+static int backend_is_empty()
+{
+    if (!queue_is_empty(&backend.priority))
+    {
+        return CLOGGER_FALSE;
+    }
+
+    return backend.mode == CLOG_ASYNC_THREAD_BUFFERS ? thread_buffers_are_empty() : queue_is_empty(&backend.queue);
+}
+
+// Claim the record at the head of a queue, producers overwriting the oldest record compete with the backend for it
+static clog_async_slot_t* claim_head(clog_async_queue_t* queue)
+{
+    size_t position = atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);
+    clog_async_slot_t* slot = &queue->slots[position & queue->mask];
+
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1
+        || !atomic_compare_exchange_strong_explicit(&queue->dequeue_position, &position, position + 1,
+                                                    memory_order_relaxed, memory_order_relaxed))
+    {
+        return NULL;
+    }
+
+    return slot;
+}
+
+// Hand a claimed slot back to the producers
+static void release_head(clog_async_queue_t* queue, clog_async_slot_t* slot)
+{
+    // Sequentially consistent, so of two slots released side by side at least one release sees the other
+    atomic_store_explicit(&slot->sequence, atomic_load_explicit(&slot->sequence, memory_order_relaxed) + queue->mask,
+                          memory_order_seq_cst);
+
+    // A producer overwriting the oldest record may release it while the backend is still writing an earlier one, so
+    // completion only moves over slots handed back in a row. A slot handed back for `position` carries at least
+    // `position` + capacity, even once it's been taken again.
+    size_t position = atomic_load_explicit(&queue->completed_position, memory_order_seq_cst);
+
+    while ((intptr_t) (atomic_load_explicit(&queue->slots[position & queue->mask].sequence, memory_order_seq_cst)
+                       - (position + queue->mask + 1)) >= 0)
+    {
+        if (atomic_compare_exchange_weak_explicit(&queue->completed_position, &position, position + 1,
+                                                  memory_order_seq_cst, memory_order_seq_cst))
+        {
+            position++;
+        }
+    }
+
+    notify_waiters();
+}
+
+// Write out the record at the head of a queue, if any
+static int dequeue_from(clog_async_queue_t* queue)
+{
+    clog_async_slot_t* slot = claim_head(queue);
+
+    if (slot == NULL)
+    {
+        return !queue_is_empty(queue);
+    }
+
+    clog_record_write(&slot->record);
+    release_head(queue, slot);
+
+    return CLOGGER_TRUE;
+}
+
+// Write out the record at the head of the queue, if any
+static int dequeue_one()
+{
+    int result = CLOGGER_TRUE;
+
+    // Pairs with `clog_async_halt_safe()`, either it sees us writing or we see it draining
+    atomic_store(&backend.writing, CLOGGER_TRUE);
+
+    if (atomic_load(&backend.draining))
+    {
+        result = CLOGGER_FALSE;
+    }
+    else if (!dequeue_from(&backend.priority))
+    {
+        result = backend.mode == CLOG_ASYNC_THREAD_BUFFERS ? collect_one() : dequeue_from(&backend.queue);
+    }
+
+    atomic_store_explicit(&backend.writing, CLOGGER_FALSE, memory_order_release);
+
+    return result;
+}
+
+// Report messages dropped since the last report through the normal logging path, at most once a second
+static void report_dropped(int force)
+{
+    static size_t reported = 0;
+    static time_t reported_at = 0;
+
+    size_t dropped = atomic_load_explicit(&backend.dropped, memory_order_relaxed);
+    time_t now = time(NULL);
+
+    if (dropped != reported && (force || now != reported_at))
+    {
+        clog_warning("clogger", "%zu messages dropped by the async backend", dropped - reported);
+
+        reported = dropped;
+        reported_at = now;
+    }
+}
+
+static void backend_sleep()
+{
+    struct timespec deadline;
+
+    pthread_mutex_lock(&backend.mutex);
+    atomic_store(&backend.sleeping, CLOGGER_TRUE);
+
+    // Re-check under the flag, a producer that published before seeing it will have been picked up here
+    if (backend_is_empty() && !atomic_load(&backend.stopping))
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += CLOGGER_ASYNC_SLEEP_NS;
+
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&backend.wake, &backend.mutex, &deadline);
+    }
+
+    atomic_store(&backend.sleeping, CLOGGER_FALSE);
+    pthread_mutex_unlock(&backend.mutex);
+}
+
+static void* backend_thread(void* args)
+{
+    (void) args;
+
+    int idle = 0;
+    size_t written = 0;
+
+    for (;;)
+    {
+        if (dequeue_one())
+        {
+            idle = 0;
+
+            if (++written % CLOGGER_ASYNC_DROP_CHECK_INTERVAL == 0)
+            {
+                report_dropped(CLOGGER_FALSE);
+            }
+
+            continue;
+        }
+
+        if (atomic_load(&backend.stopping))
+        {
+            break;
+        }
+
+        idle++;
+
+        switch (backend.wait_strategy)
+        {
+            case CLOG_ASYNC_WAIT_BUSY_SPIN:
+            case CLOG_ASYNC_WAIT_YIELD:
+                if (idle % CLOGGER_ASYNC_SPIN_COUNT == 0)
+                {
+                    report_dropped(CLOGGER_FALSE);
+                    clog_dedup_flush_expired();
+                    clog_file_sink_flush_expired();
+                    clog_binary_sink_flush_expired();
+                }
+
+                if (backend.wait_strategy == CLOG_ASYNC_WAIT_YIELD)
+                {
+                    sched_yield();
+                }
+                else
+                {
+                    cpu_relax();
+                }
+                break;
+            default:
+                if (idle < CLOGGER_ASYNC_SPIN_COUNT && backend.wait_strategy != CLOG_ASYNC_WAIT_SLEEP)
+                {
+                    sched_yield();
+                }
+                else
+                {
+                    report_dropped(CLOGGER_FALSE);
+                    clog_dedup_flush_expired();
+                    clog_file_sink_flush_expired();
+                    clog_binary_sink_flush_expired();
+                    backend_sleep();
+                }
+                break;
+        }
+    }
+
+    report_dropped(CLOGGER_TRUE);
+    fflush(stdout);
+
+    return NULL;
+}
+
+clog_async_config_t clog_async_default_config()
+{
+    return (clog_async_config_t) {CLOGGER_ASYNC_DEFAULT_CAPACITY, CLOG_ASYNC_SHARED_QUEUE,
+                                  CLOGGER_ASYNC_DEFAULT_THREAD_CAPACITY, CLOG_BACKPRESSURE_BLOCK,
+                                  CLOGGER_ASYNC_DEFAULT_PRIORITY_CAPACITY, 0, CLOG_ASYNC_WAIT_ADAPTIVE, -1};
+}
+
+static int pin_backend(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+
+    if (cpu >= CPU_SETSIZE)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(backend.thread, sizeof set, &set) == 0;
+#else
+    // No hard affinity elsewhere, macOS only takes hints
+    (void) cpu;
+
+    return CLOGGER_FALSE;
+#endif
+}
+
+static int open_queue(clog_async_queue_t* queue, size_t capacity)
+{
+    // Positions carry on from the last run, so its tickets still read as completed
+    size_t base = atomic_load(&queue->enqueue_position);
+
+    capacity = round_up_power_of_two(capacity);
+    queue->slots = malloc(capacity * sizeof(clog_async_slot_t));
+
+    if (queue->slots == NULL)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    queue->mask = capacity - 1;
+
+    for (size_t i = 0; i < capacity; i++)
+    {
+        atomic_init(&queue->slots[(base + i) & queue->mask].sequence, base + i);
+    }
+
+    atomic_store(&queue->dequeue_position, base);
+    atomic_store(&queue->completed_position, base);
+
+    return CLOGGER_TRUE;
+}
+
+static void close_queue(clog_async_queue_t* queue)
+{
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+int clog_async_start(const clog_async_config_t* config)
+{
+    clog_async_config_t settings = config ? *config : clog_async_default_config();
+    int result = CLOGGER_TRUE;
+
+    pthread_mutex_lock(&lifecycle_mutex);
+
+    if (!atomic_load(&backend.running))
+    {
+        size_t capacity = settings.mode == CLOG_ASYNC_THREAD_BUFFERS ? 2 : settings.capacity;
+
+        backend.mode = settings.mode;
+        backend.backpressure = settings.backpressure;
+        backend.thread_mask = round_up_power_of_two(settings.thread_capacity) - 1;
+        backend.sync_threshold = settings.sync_threshold;
+        backend.wait_strategy = settings.wait_strategy;
+
+        if (!open_queue(&backend.queue, capacity))
+        {
+            result = CLOGGER_FALSE;
+        }
+        else if (!open_queue(&backend.priority, settings.priority_capacity))
+        {
+            close_queue(&backend.queue);
+            result = CLOGGER_FALSE;
+        }
+        else
+        {
+            atomic_store(&backend.stopping, CLOGGER_FALSE);
+
+            if (pthread_create(&backend.thread, NULL, backend_thread, NULL) == 0)
+            {
+                atomic_store(&backend.running, CLOGGER_TRUE);
+
+                if (settings.cpu >= 0 && !pin_backend(settings.cpu))
+                {
+                    clog_warning("clogger", "Could not pin the async backend to CPU %d", settings.cpu);
+                }
+
+                clog_register_exit_flush();
+            }
+            else
+            {
+                close_queue(&backend.queue);
+                close_queue(&backend.priority);
+                result = CLOGGER_FALSE;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&lifecycle_mutex);
+
+    return result;
+}
+
+void clog_async_stop()
+{
+    pthread_mutex_lock(&lifecycle_mutex);
+
+    if (atomic_load(&backend.running))
+    {
+        atomic_store(&backend.running, CLOGGER_FALSE);
+        atomic_store(&backend.stopping, CLOGGER_TRUE);
+
+        pthread_mutex_lock(&backend.mutex);
+        pthread_cond_signal(&backend.wake);
+        pthread_mutex_unlock(&backend.mutex);
+
+        pthread_join(backend.thread, NULL);
+
+        // Everything has been written, so the buffers of exited threads can go now
+        clog_async_thread_buffer_t* previous = NULL;
+        clog_async_thread_buffer_t* next;
+
+        for (clog_async_thread_buffer_t* buffer = atomic_load(&thread_buffers); buffer != NULL; buffer = next)
+        {
+            next = buffer->next;
+
+            if (atomic_load(&buffer->abandoned))
+            {
+                release_thread_buffer(previous, buffer);
+            }
+            else
+            {
+                previous = buffer;
+            }
+        }
+
+        close_queue(&backend.queue);
+        close_queue(&backend.priority);
+    }
+
+    pthread_mutex_unlock(&lifecycle_mutex);
+}
+
+int clog_async_flush_until(const struct timespec* deadline)
+{
+    int result = wait_for_detached(deadline);
+
+    if (!clog_async_is_running())
+    {
+        return result;
+    }
+
+    clog_async_queue_target_t priority_target = {&backend.priority, atomic_load(&backend.priority.enqueue_position)};
+
+    result = wait_until(position_reached, &priority_target, deadline) && result;
+
+    if (backend.mode == CLOG_ASYNC_THREAD_BUFFERS)
+    {
+        // Keeps the backend from releasing buffers under us
+        pthread_mutex_lock(&thread_buffers_mutex);
+
+        for (clog_async_thread_buffer_t* buffer = atomic_load(&thread_buffers); buffer != NULL; buffer = buffer->next)
+        {
+            clog_async_buffer_target_t target = {buffer, atomic_load(&buffer->write_position)};
+
+            result = wait_until(buffer_position_reached, &target, deadline) && result;
+        }
+
+        pthread_mutex_unlock(&thread_buffers_mutex);
+
+        return result;
+    }
+
+    clog_async_queue_target_t target = {&backend.queue, atomic_load(&backend.queue.enqueue_position)};
+
+    return wait_until(position_reached, &target, deadline) && result;
+}
+
+void clog_async_flush()
+{
+    clog_async_flush_until(NULL);
+}
+
+int clog_async_wait(clog_ticket_t ticket, const struct timespec* deadline)
+{
+    if (ticket == CLOG_TICKET_COMPLETED)
+    {
+        return CLOGGER_TRUE;
+    }
+
+    if (ticket & CLOGGER_TICKET_DETACHED)
+    {
+        // Detached messages finish in any order, wait for all of them
+        return wait_for_detached(deadline);
+    }
+
+    if (ticket & CLOGGER_TICKET_PRIORITY)
+    {
+        clog_async_queue_target_t target = {&backend.priority, (size_t) (ticket & (CLOGGER_TICKET_PRIORITY - 1))};
+
+        return wait_until(position_reached, &target, deadline);
+    }
+
+    if (ticket & CLOGGER_TICKET_THREAD_BUFFER)
+    {
+        clog_async_buffer_target_t target = {thread_buffer, ticket & CLOGGER_TICKET_POSITION_MASK};
+
+        if (target.buffer == NULL
+            || target.buffer->id != ((ticket >> CLOGGER_TICKET_BUFFER_SHIFT) & CLOGGER_TICKET_BUFFER_MASK))
+        {
+            // Logged by another thread, whose buffer we can't safely hold on to
+            return clog_async_flush_until(deadline);
+        }
+
+        return wait_until(buffer_position_reached, &target, deadline);
+    }
+
+    clog_async_queue_target_t target = {&backend.queue, (size_t) ticket};
+
+    return wait_until(position_reached, &target, deadline);
+}
+
+clog_ticket_t clog_async_detach_begin()
+{
+    // Nothing else may have registered it, e.g. when logging to the console without the backend
+    clog_register_exit_flush();
+
+    pthread_mutex_lock(&detached_mutex);
+    detached_pending++;
+    pthread_mutex_unlock(&detached_mutex);
+
+    return CLOGGER_TICKET_DETACHED;
+}
+
+void clog_async_detach_end()
+{
+    pthread_mutex_lock(&detached_mutex);
+
+    if (--detached_pending == 0)
+    {
+        pthread_cond_broadcast(&detached_done);
+    }
+
+    pthread_mutex_unlock(&detached_mutex);
+}
+
+static int deadline_passed(const struct timespec* deadline)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return !timespec_before(&now, deadline);
+}
+
+// Claim and write the oldest record across the thread buffers, like `collect_one()` minus anything that locks or frees
+static int collect_one_safe(size_t* written)
+{
+    clog_async_thread_buffer_t* oldest = NULL;
+    size_t oldest_position = 0;
+    long long oldest_stamp = 0;
+
+    for (clog_async_thread_buffer_t* buffer = atomic_load_explicit(&thread_buffers, memory_order_acquire);
+         buffer != NULL; buffer = buffer->next)
+    {
+        size_t position = atomic_load_explicit(&buffer->read_position, memory_order_relaxed);
+
+        if (atomic_load_explicit(&buffer->write_position, memory_order_acquire) != position)
+        {
+            long long stamp = atomic_load_explicit(&buffer->stamps[position & buffer->mask], memory_order_relaxed);
+
+            if (oldest == NULL || stamp < oldest_stamp)
+            {
+                oldest = buffer;
+                oldest_position = position;
+                oldest_stamp = stamp;
+            }
+        }
+    }
+
+    if (oldest == NULL)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    if (atomic_compare_exchange_strong_explicit(&oldest->read_position, &oldest_position, oldest_position + 1,
+                                                memory_order_acquire, memory_order_relaxed))
+    {
+        clog_record_write_safe(&oldest->records[oldest_position & oldest->mask]);
+        atomic_fetch_add_explicit(&oldest->released_position, 1, memory_order_release);
+        (*written)++;
+    }
+
+    return CLOGGER_TRUE;
+}
+
+void clog_async_halt_safe(const struct timespec* deadline)
+{
+    atomic_store(&backend.draining, CLOGGER_TRUE);
+
+    // Let the backend finish the record it's writing, unless it's the thread going down
+    if (clog_async_is_running() && !pthread_equal(pthread_self(), backend.thread))
+    {
+        while (atomic_load(&backend.writing) && !deadline_passed(deadline))
+        {
+        }
+    }
+}
+
+size_t clog_async_drain_safe(const struct timespec* deadline)
+{
+    size_t written = 0;
+
+    clog_async_halt_safe(deadline);
+
+    if (!clog_async_is_running())
+    {
+        return 0;
+    }
+
+    // Waiters are never woken from here, the process is on its way out
+    while (!deadline_passed(deadline))
+    {
+        clog_async_slot_t* slot = claim_head(&backend.priority);
+
+        if (slot == NULL && backend.mode != CLOG_ASYNC_THREAD_BUFFERS && queue_is_empty(&backend.priority))
+        {
+            slot = claim_head(&backend.queue);
+        }
+
+        if (slot != NULL)
+        {
+            clog_record_write_safe(&slot->record);
+            written++;
+        }
+        else if (!queue_is_empty(&backend.priority))
+        {
+            continue;
+        }
+        else if (backend.mode == CLOG_ASYNC_THREAD_BUFFERS)
+        {
+            if (!collect_one_safe(&written))
+            {
+                break;
+            }
+        }
+        else if (queue_is_empty(&backend.queue))
+        {
+            // Includes a slot claimed but never published by a producer that crashed
+            break;
+        }
+    }
+
+    return written;
+}
+
+int clog_async_is_running()
+{
+    return atomic_load_explicit(&backend.running, memory_order_acquire);
+}
+
+size_t clog_async_dropped_count()
+{
+    return atomic_load_explicit(&backend.dropped, memory_order_relaxed);
+}
+
+// Captures the message into a queue, or copies `source` if it isn't `NULL`
+static int enqueue_queue(clog_async_queue_t* queue, clog_ticket_t ticket_flags, const clog_record_t* source,
+                         clog_level_t level, clogger_t* logger, const char* location, const char* format,
+                         va_list* args, clog_ticket_t* ticket)
+{
+    clog_backpressure_t backpressure = logger != NULL ? logger->backpressure : backend.backpressure;
+    clog_async_slot_t* slot;
+    size_t position = atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+
+    for (;;)
+    {
+        slot = &queue->slots[position & queue->mask];
+
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            if (backpressure == CLOG_BACKPRESSURE_DROP_NEWEST)
+            {
+                atomic_fetch_add_explicit(&backend.dropped, 1, memory_order_relaxed);
+                *ticket = CLOG_TICKET_COMPLETED;
+                return CLOGGER_TRUE;
+            }
+
+            clog_async_slot_t* oldest = backpressure == CLOG_BACKPRESSURE_OVERWRITE_OLDEST ? claim_head(queue) : NULL;
+
+            if (oldest != NULL)
+            {
+                release_head(queue, oldest);
+                atomic_fetch_add_explicit(&backend.dropped, 1, memory_order_relaxed);
+            }
+            else
+            {
+                // Queue is full, wait for the backend to catch up
+                wake_backend();
+                sched_yield();
+            }
+
+            position = atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+        }
+        else
+        {
+            position = atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+        }
+    }
+
+    if (source != NULL)
+    {
+        slot->record = *source;
+    }
+    else
+    {
+        clog_record_capture(&slot->record, level, logger, location, format, *args);
+    }
+
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+
+    wake_backend();
+
+    *ticket = ticket_flags | ((clog_ticket_t) position + 1);
+
+    return CLOGGER_TRUE;
+}
+
+// Records waiting ahead of a new one from the calling thread
+static size_t backlog()
+{
+    if (backend.mode == CLOG_ASYNC_THREAD_BUFFERS)
+    {
+        return thread_buffer != NULL ? atomic_load_explicit(&thread_buffer->write_position, memory_order_relaxed)
+                                       - atomic_load_explicit(&thread_buffer->released_position, memory_order_relaxed)
+                                     : 0;
+    }
+
+    return atomic_load_explicit(&backend.queue.enqueue_position, memory_order_relaxed)
+           - atomic_load_explicit(&backend.queue.completed_position, memory_order_relaxed);
+}
+
+// Urgent records take the priority lane, or are written on the spot when the backend is too far behind
+static int enqueue(int urgent, const clog_record_t* source, clog_level_t level, clogger_t* logger,
+                   const char* location, const char* format, va_list* args, clog_ticket_t* ticket)
+{
+    if (!clog_async_is_running())
+    {
+        return CLOGGER_FALSE;
+    }
+
+    if (urgent)
+    {
+        if (backend.sync_threshold > 0 && backlog() > backend.sync_threshold)
+        {
+            if (source != NULL)
+            {
+                clog_record_write(source);
+            }
+            else
+            {
+                clog_messagef(level, logger, location, format, *args);
+            }
+
+            *ticket = CLOG_TICKET_COMPLETED;
+            return CLOGGER_TRUE;
+        }
+
+        return enqueue_queue(&backend.priority, CLOGGER_TICKET_PRIORITY, source, level, logger, location, format, args,
+                             ticket);
+    }
+
+    if (backend.mode == CLOG_ASYNC_THREAD_BUFFERS)
+    {
+        return enqueue_thread_buffer(source, level, logger, location, format, args, ticket);
+    }
+
+    return enqueue_queue(&backend.queue, 0, source, level, logger, location, format, args, ticket);
+}
+
+int clog_async_enqueue(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args,
+                       clog_ticket_t* ticket)
+{
+    va_list enqueue_args;
+    int result;
+
+    va_copy(enqueue_args, args);
+    result = enqueue(level == CLOG_LEVEL_ERROR || level == CLOG_LEVEL_CRITICAL || level == CLOG_LEVEL_FATAL_ASSERT,
+                     NULL, level, logger, location, format, &enqueue_args, ticket);
+    va_end(enqueue_args);
+
+    return result;
+}
+
+int clog_async_enqueue_record(const clog_record_t* record, int urgent, clog_ticket_t* ticket)
+{
+    return enqueue(urgent, record, record->level, record->logger, record->location, NULL, NULL, ticket);
+}
@@ -0,0 +1,107 @@
+//! @file
+//! @brief Persistent asynchronous logging backend
+
+#ifndef CLOGGER_ASYNC_H
+#define CLOGGER_ASYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "core.h"
+
+/// @brief Default number of records the async queue can hold
+#define CLOGGER_ASYNC_DEFAULT_CAPACITY 8192
+
+/// @brief Default number of records the priority lane can hold
+#define CLOGGER_ASYNC_DEFAULT_PRIORITY_CAPACITY 256
+
+/// @brief Default number of records each thread's buffer can hold in `CLOG_ASYNC_THREAD_BUFFERS` mode
+#define CLOGGER_ASYNC_DEFAULT_THREAD_CAPACITY 1024
+
+/// @brief How producer threads hand their messages to the backend
+typedef enum clog_async_mode
+{
+    CLOG_ASYNC_SHARED_QUEUE, ///< One queue shared by every thread, messages are written in the order they were queued
+    /// Every thread gets its own single-producer buffer on its first message, released when the thread exits. No
+    /// cache line is shared between producers, and the backend merges the buffers by timestamp
+    CLOG_ASYNC_THREAD_BUFFERS
+} clog_async_mode_t;
+
+/// @brief How the backend thread waits for messages while the queue is empty
+typedef enum clog_async_wait_strategy
+{
+    CLOG_ASYNC_WAIT_ADAPTIVE, ///< Yield for a short while, then sleep until a producer wakes it up, the default
+    /// Never give up the CPU, the lowest wake-up latency for a whole core. Only worth it with a core to spare, pair it
+    /// with `cpu`
+    CLOG_ASYNC_WAIT_BUSY_SPIN,
+    CLOG_ASYNC_WAIT_YIELD, ///< Yield the CPU between checks but never sleep, low latency without starving other threads
+    CLOG_ASYNC_WAIT_SLEEP ///< Sleep as soon as the queue is empty, the least CPU for the slowest wake-up
+} clog_async_wait_strategy_t;
+
+/// @brief Configuration for the asynchronous logging backend
+typedef struct clog_async_config
+{
+    size_t capacity; ///< Number of records the queue can hold, rounded up to a power of two
+    clog_async_mode_t mode; ///< How producer threads hand their messages to the backend
+    size_t thread_capacity; ///< Number of records each thread's buffer can hold, rounded up to a power of two
+    clog_backpressure_t backpressure; ///< What a full queue does to messages logged without a `clogger_t`
+    /// Number of records the priority lane can hold, rounded up to a power of two. `ERROR`, `CRITICAL` and
+    /// `FATAL_ASSERT` messages go through it, and the backend always empties it before touching the other messages
+    size_t priority_capacity;
+    /// Write `ERROR` and above on the spot instead when more than this many messages are waiting ahead of them,
+    /// `0` to always queue them. The calling thread's own buffer is what counts in `CLOG_ASYNC_THREAD_BUFFERS` mode
+    size_t sync_threshold;
+    clog_async_wait_strategy_t wait_strategy; ///< How the backend thread waits while the queue is empty
+    /// CPU to pin the backend thread to, `-1` to leave it to the scheduler. Only supported on Linux, elsewhere or when
+    /// pinning fails the backend runs unpinned and a warning is logged
+    int cpu;
+} clog_async_config_t;
+
+/// @brief Get the default async backend configuration
+/// @return Initialized `clog_async_config_t`
+clog_async_config_t clog_async_default_config();
+
+/// @brief Start the asynchronous logging backend
+/// @details Once started, all `_async` functions push their message onto a bounded lock-free queue and return
+/// immediately, a single long-lived backend thread then writes the messages in order, the priority lane first. Without
+/// the backend, every `_async` call creates its own thread.
+///
+/// Thread buffers of a previous run are kept by their threads, so a changed `thread_capacity` only applies to threads
+/// that haven't logged asynchronously yet.
+/// @note The backend is drained and stopped automatically on `exit()`
+/// @warning The `location` strings passed to the `_async` functions must outlive the call, as they are read by the
+/// backend thread. String literals and `__FUNCTION__` are always fine. The same goes for the `clogger_t` of a message,
+/// along with its sinks and layout: the backend reads it when the message is written, which can be during `exit()`,
+/// after `main()` has returned. A logger on the stack must not go out of scope while it has messages queued, call
+/// `clog_async_stop()` first, or `clog_flush()` while the backend is in use elsewhere.
+/// @param config [in] Pointer to the backend configuration, pass `NULL` for the defaults
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success (or if already running)
+int clog_async_start(const clog_async_config_t* config);
+
+/// @brief Write every queued message and stop the asynchronous logging backend
+/// @details Once it returns, no queued message refers to a `clogger_t` any more, so loggers can go out of scope
+/// @warning Must not be called while other threads are still logging asynchronously
+void clog_async_stop();
+
+/// @brief Wait until every message queued so far has been written
+/// @details Without the backend, waits for the threads of outstanding `_async` calls instead
+void clog_async_flush();
+
+/// @brief Check whether the asynchronous logging backend is running
+/// @return `CLOGGER_TRUE` if running, otherwise `CLOGGER_FALSE`
+int clog_async_is_running();
+
+/// @brief Get the number of messages dropped because the queue was full
+/// @details See `clog_backpressure_t`. The backend also logs a warning with the number of newly dropped messages, at
+/// most once a second
+/// @return Number of messages dropped since the program started
+size_t clog_async_dropped_count();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_ASYNC_H
@@ -0,0 +1,569 @@
+#include "binary_sink.h"
+#include "record.h"
+#include "line.h"
+#include "timestamp.h"
+#include "fileio.h"
+#include "clog.h"
+#include "dedup.h"
+#include "clogger_pch.h"
+
+#include <stdint.h>
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define CLOGGER_SINK_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define CLOGGER_SINK_CLOCK CLOCK_MONOTONIC
+#endif
+
+// Most argument bytes captured for a message, messages with more are formatted instead
+#define CLOGGER_BINARY_ARGS_SIZE 4096
+
+// Buffer of a sink that writes through, big enough for most messages to go out in a single write
+#define CLOGGER_BINARY_MIN_BUFFER 512
+
+// Initial number of slots in a sink's call site table, doubled whenever it's half full
+#define CLOGGER_BINARY_SITE_SLOTS 64
+
+// A call site already written to the file. Sites are keyed on the text of their strings, not on their addresses, as
+// none of them is necessarily a string literal, so the site keeps its own copy of them in a single allocation
+typedef struct clog_binary_site
+{
+    unsigned long long hash;
+    char* format; // Start of the copies, `NULL` for an empty slot
+    const char* location;
+    const char* name;
+    clog_level_t level;
+    unsigned int id;
+} clog_binary_site_t;
+
+struct clog_binary_sink
+{
+    int fd;
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    int write_through;
+    long long flush_interval_ns;
+    long long last_flush_ns;
+    long long last_timestamp_ns;
+    clog_timestamp_precision_t precision;
+    pthread_mutex_t mutex;
+    clog_binary_sink_t* next;
+
+    // Call sites, guarded by `mutex`
+    clog_binary_site_t* sites;
+    size_t site_slots;
+    unsigned int site_count;
+};
+
+static clog_binary_sink_t* open_sinks = NULL;
+static pthread_mutex_t open_sinks_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static long long now_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOGGER_SINK_CLOCK, &now);
+
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static long long timestamp_ns(const struct timespec* timestamp)
+{
+    return (long long) timestamp->tv_sec * 1000000000LL + timestamp->tv_nsec;
+}
+
+// Caller holds the sink's mutex
+static int flush_locked(clog_binary_sink_t* sink)
+{
+    int result = clog_write_all(sink->fd, sink->buffer, sink->length);
+
+    sink->length = 0;
+    sink->last_flush_ns = now_ns();
+
+    return result;
+}
+
+// Caller holds the sink's mutex. Entries may be split across flushes, nothing reads the file while it's being written
+static int put_bytes(clog_binary_sink_t* sink, const void* data, size_t length)
+{
+    const unsigned char* bytes = data;
+    int result = CLOGGER_TRUE;
+
+    while (length > sink->capacity - sink->length)
+    {
+        size_t room = sink->capacity - sink->length;
+
+        memcpy(sink->buffer + sink->length, bytes, room);
+        sink->length += room;
+        bytes += room;
+        length -= room;
+
+        result = flush_locked(sink) && result;
+    }
+
+    memcpy(sink->buffer + sink->length, bytes, length);
+    sink->length += length;
+
+    return result;
+}
+
+static size_t encode_varint(unsigned char* buffer, unsigned long long value)
+{
+    size_t length = 0;
+
+    while (value >= 0x80)
+    {
+        buffer[length++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+
+    buffer[length++] = (unsigned char) value;
+
+    return length;
+}
+
+static int put_varint(clog_binary_sink_t* sink, unsigned long long value)
+{
+    unsigned char buffer[10];
+
+    return put_bytes(sink, buffer, encode_varint(buffer, value));
+}
+
+static int put_string(clog_binary_sink_t* sink, const char* text)
+{
+    if (text == NULL)
+    {
+        return put_varint(sink, 0);
+    }
+
+    size_t length = strlen(text);
+
+    return put_varint(sink, length + 1) && put_bytes(sink, text, length);
+}
+
+static int same_string(const char* copy, const char* text)
+{
+    return copy == text || (copy != NULL && text != NULL && strcmp(copy, text) == 0);
+}
+
+// FNV-1a, a `NULL` string hashes differently from an empty one
+static unsigned long long hash_string(unsigned long long hash, const char* text)
+{
+    if (text == NULL)
+    {
+        return (hash ^ 0xFF) * 0x100000001B3ULL;
+    }
+
+    for (; *text != '\0'; text++)
+    {
+        hash = (hash ^ (unsigned char) *text) * 0x100000001B3ULL;
+    }
+
+    return hash * 0x100000001B3ULL;
+}
+
+static unsigned long long site_hash(const char* format, const char* location, const char* name, clog_level_t level)
+{
+    unsigned long long hash = (0xCBF29CE484222325ULL ^ (unsigned) level) * 0x100000001B3ULL;
+
+    return hash_string(hash_string(hash_string(hash, format), location), name);
+}
+
+static size_t site_slot(unsigned long long hash, size_t mask)
+{
+    return (size_t) ((hash * 0x9E3779B97F4A7C15ULL) >> 17) & mask;
+}
+
+// Copy the strings of a new site, `format` can't be `NULL`
+static int copy_site(clog_binary_site_t* site, const char* format, const char* location, const char* name)
+{
+    size_t format_size = strlen(format) + 1;
+    size_t location_size = location != NULL ? strlen(location) + 1 : 0;
+    size_t name_size = name != NULL ? strlen(name) + 1 : 0;
+    char* copies = malloc(format_size + location_size + name_size);
+
+    if (copies == NULL)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    memcpy(copies, format, format_size);
+    site->format = copies;
+    site->location = location != NULL ? memcpy(copies + format_size, location, location_size) : NULL;
+    site->name = name != NULL ? memcpy(copies + format_size + location_size, name, name_size) : NULL;
+
+    return CLOGGER_TRUE;
+}
+
+// Caller holds the sink's mutex
+static int grow_sites(clog_binary_sink_t* sink)
+{
+    size_t slots = sink->site_slots > 0 ? sink->site_slots * 2 : CLOGGER_BINARY_SITE_SLOTS;
+    clog_binary_site_t* sites = calloc(slots, sizeof(clog_binary_site_t));
+
+    if (sites == NULL)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    for (size_t i = 0; i < sink->site_slots; i++)
+    {
+        const clog_binary_site_t* site = &sink->sites[i];
+
+        if (site->format == NULL)
+        {
+            continue;
+        }
+
+        size_t slot = site_slot(site->hash, slots - 1);
+
+        while (sites[slot].format != NULL)
+        {
+            slot = (slot + 1) & (slots - 1);
+        }
+
+        sites[slot] = *site;
+    }
+
+    free(sink->sites);
+    sink->sites = sites;
+    sink->site_slots = slots;
+
+    return CLOGGER_TRUE;
+}
+
+// Caller holds the sink's mutex. Find the ID of a call site, writing its dictionary entry the first time it's seen
+static int find_site(clog_binary_sink_t* sink, const char* format, const char* location, const char* name,
+                     clog_level_t level, unsigned int* id)
+{
+    if ((sink->site_count + 1) * 2 > sink->site_slots && !grow_sites(sink))
+    {
+        return CLOGGER_FALSE;
+    }
+
+    unsigned long long hash = site_hash(format, location, name, level);
+    size_t mask = sink->site_slots - 1;
+    size_t slot = site_slot(hash, mask);
+
+    for (; sink->sites[slot].format != NULL; slot = (slot + 1) & mask)
+    {
+        const clog_binary_site_t* site = &sink->sites[slot];
+
+        if (site->hash == hash && site->level == level && strcmp(site->format, format) == 0
+            && same_string(site->location, location) && same_string(site->name, name))
+        {
+            *id = site->id;
+            return CLOGGER_TRUE;
+        }
+    }
+
+    clog_binary_site_t* site = &sink->sites[slot];
+
+    if (!copy_site(site, format, location, name))
+    {
+        return CLOGGER_FALSE;
+    }
+
+    site->hash = hash;
+    site->level = level;
+    site->id = sink->site_count++;
+    *id = site->id;
+
+    unsigned char tag = CLOGGER_BINARY_SITE;
+    unsigned char level_byte = (unsigned char) level;
+
+    return put_bytes(sink, &tag, 1) && put_varint(sink, site->id) && put_bytes(sink, &level_byte, 1)
+           && put_string(sink, name) && put_string(sink, location) && put_string(sink, format);
+}
+
+static int write_entry(clog_binary_sink_t* sink, unsigned char tag, clog_level_t level, clogger_t* logger,
+                       const char* location, const char* format, const struct timespec* timestamp, const void* data,
+                       size_t length)
+{
+    clog_timestamp_precision_t precision = clog_get_timestamp_precision();
+    long long now = timestamp_ns(timestamp);
+    unsigned int id;
+    int result;
+
+    pthread_mutex_lock(&sink->mutex);
+
+    result = find_site(sink, format, location, logger != NULL ? logger->name : NULL, level, &id);
+
+    if (result && precision != sink->precision)
+    {
+        unsigned char entry[2] = {CLOGGER_BINARY_PRECISION, (unsigned char) precision};
+
+        result = put_bytes(sink, entry, sizeof entry);
+        sink->precision = precision;
+    }
+
+    if (result)
+    {
+        // Messages from different threads can reach the sink slightly out of order, so the delta can be negative
+        long long delta = now - sink->last_timestamp_ns;
+        unsigned long long zigzag = ((unsigned long long) delta << 1) ^ (unsigned long long) (delta >> 63);
+
+        result = put_bytes(sink, &tag, 1) && put_varint(sink, id) && put_varint(sink, zigzag)
+                 && put_varint(sink, length) && put_bytes(sink, data, length);
+        sink->last_timestamp_ns = now;
+    }
+
+    if (sink->write_through
+        || (sink->flush_interval_ns > 0 && now_ns() - sink->last_flush_ns >= sink->flush_interval_ns))
+    {
+        result = flush_locked(sink) && result;
+    }
+
+    pthread_mutex_unlock(&sink->mutex);
+
+    return result;
+}
+
+// Header of a new file, see `binary_sink.h`
+static size_t encode_header(unsigned char* buffer, clog_timestamp_precision_t precision, long long opened_ns)
+{
+    static const unsigned char sizes[] = {
+            sizeof(short), sizeof(int), sizeof(long), sizeof(long long), sizeof(intmax_t), sizeof(size_t),
+            sizeof(ptrdiff_t), sizeof(double), sizeof(long double), sizeof(void*)
+    };
+    const uint32_t byte_order = 0x01020304;
+    size_t length = 0;
+
+    memcpy(buffer, "CLOGBIN", 7);
+    length += 7;
+    buffer[length++] = CLOGGER_BINARY_VERSION;
+    memcpy(buffer + length, sizes, sizeof sizes);
+    length += sizeof sizes;
+    memcpy(buffer + length, &byte_order, sizeof byte_order);
+    length += sizeof byte_order;
+    buffer[length++] = (unsigned char) precision;
+    buffer[length++] = 0;
+
+    return length + encode_varint(buffer + length, (unsigned long long) opened_ns);
+}
+
+clog_binary_sink_t* clog_binary_sink_open(const char* file_path, size_t buffer_size, unsigned int flush_interval_ms)
+{
+    clog_binary_sink_t* sink = calloc(1, sizeof(clog_binary_sink_t));
+
+    if (sink == NULL)
+    {
+        return NULL;
+    }
+
+    sink->fd = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (sink->fd < 0)
+    {
+        perror(file_path);
+        clog_error(__FUNCTION__, "Could not open file %s", file_path);
+
+        free(sink);
+        return NULL;
+    }
+
+    sink->write_through = buffer_size == 0;
+    sink->capacity = buffer_size > CLOGGER_BINARY_MIN_BUFFER ? buffer_size : CLOGGER_BINARY_MIN_BUFFER;
+    sink->buffer = malloc(sink->capacity);
+
+    if (sink->buffer == NULL)
+    {
+        close(sink->fd);
+        free(sink);
+        return NULL;
+    }
+
+    struct timespec opened;
+
+    clog_timestamp_now(&opened);
+
+    sink->precision = clog_get_timestamp_precision();
+    sink->last_timestamp_ns = timestamp_ns(&opened);
+    sink->length = encode_header((unsigned char*) sink->buffer, sink->precision, sink->last_timestamp_ns);
+    sink->flush_interval_ns = (long long) flush_interval_ms * 1000000LL;
+    sink->last_flush_ns = now_ns();
+    pthread_mutex_init(&sink->mutex, NULL);
+
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    clog_register_exit_flush();
+
+    sink->next = open_sinks;
+    open_sinks = sink;
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+
+    clog_sink_flush_timer(sink->flush_interval_ns);
+
+    return sink;
+}
+
+int clog_binary_sink_write(clog_binary_sink_t* sink, clog_level_t level, clogger_t* logger, const char* location,
+                           const struct timespec* timestamp, const char* format, va_list args)
+{
+    const clog_format_t* parsed = clog_format_lookup(format);
+
+    if (parsed != NULL)
+    {
+        unsigned char data[CLOGGER_BINARY_ARGS_SIZE];
+        va_list capture_args;
+
+        va_copy(capture_args, args);
+        size_t length = clog_format_capture(parsed, data, sizeof data, capture_args);
+        va_end(capture_args);
+
+        if (length > 0 || parsed->spec_count == 0)
+        {
+            return write_entry(sink, CLOGGER_BINARY_RECORD, level, logger, location, format, timestamp, data, length);
+        }
+    }
+
+    // Can't be deferred, the decoder gets the text instead
+    clog_line_t* line = clog_line_begin();
+
+    clog_line_append_vformat(line, format, args);
+
+    int result = clog_binary_sink_write_text(sink, level, logger, location, timestamp, format, line->data,
+                                             line->length);
+
+    clog_line_reset(line);
+
+    return result;
+}
+
+int clog_binary_sink_write_text(clog_binary_sink_t* sink, clog_level_t level, clogger_t* logger, const char* location,
+                                const struct timespec* timestamp, const char* format, const char* text, size_t length)
+{
+    return write_entry(sink, CLOGGER_BINARY_TEXT, level, logger, location, format, timestamp, text, length);
+}
+
+int clog_binary_sink_write_record(clog_binary_sink_t* sink, const clog_record_t* record)
+{
+    if (record->format != NULL)
+    {
+        return write_entry(sink, CLOGGER_BINARY_RECORD, record->level, record->logger, record->location,
+                           record->format->format, &record->timestamp, record->data, record->length);
+    }
+
+    // Without a parsed format the record doesn't know its format string, the site is keyed on the location alone
+    return write_entry(sink, CLOGGER_BINARY_TEXT, record->level, record->logger, record->location, "",
+                       &record->timestamp, record->data, record->length);
+}
+
+int clog_binary_sink_flush(clog_binary_sink_t* sink)
+{
+    pthread_mutex_lock(&sink->mutex);
+    int result = flush_locked(sink);
+    pthread_mutex_unlock(&sink->mutex);
+
+    return result;
+}
+
+void clog_binary_sink_close(clog_binary_sink_t* sink)
+{
+    clog_dedup_target_t target = {CLOG_DEDUP_BINARY_SINK, sink};
+
+    // Its last run is reported while it can still be written
+    clog_dedup_forget(&target);
+
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    for (clog_binary_sink_t** link = &open_sinks; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == sink)
+        {
+            *link = sink->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+
+    clog_binary_sink_flush(sink);
+    close(sink->fd);
+
+    for (size_t i = 0; i < sink->site_slots; i++)
+    {
+        free(sink->sites[i].format);
+    }
+
+    pthread_mutex_destroy(&sink->mutex);
+    free(sink->sites);
+    free(sink->buffer);
+    free(sink);
+}
+
+void clog_binary_sink_flush_all()
+{
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    for (clog_binary_sink_t* sink = open_sinks; sink != NULL; sink = sink->next)
+    {
+        clog_binary_sink_flush(sink);
+    }
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+}
+
+void clog_binary_sink_flush_expired()
+{
+    long long now = now_ns();
+
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    for (clog_binary_sink_t* sink = open_sinks; sink != NULL; sink = sink->next)
+    {
+        pthread_mutex_lock(&sink->mutex);
+
+        if (sink->flush_interval_ns > 0 && now - sink->last_flush_ns >= sink->flush_interval_ns)
+        {
+            flush_locked(sink);
+        }
+
+        pthread_mutex_unlock(&sink->mutex);
+    }
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+}
+
+int clog_binary_sink_write_record_safe(clog_binary_sink_t* sink, const clog_record_t* record)
+{
+    // Without the heap the site table can't grow, so every message gets a site entry of its own
+    const char* name = record->logger != NULL ? record->logger->name : NULL;
+    const char* format = record->format != NULL ? record->format->format : "";
+    unsigned char tag = record->format != NULL ? CLOGGER_BINARY_RECORD : CLOGGER_BINARY_TEXT;
+    unsigned char site[2] = {CLOGGER_BINARY_SITE, (unsigned char) record->level};
+    clog_timestamp_precision_t precision = clog_get_timestamp_precision();
+    long long now = timestamp_ns(&record->timestamp);
+    long long delta = now - sink->last_timestamp_ns;
+    unsigned long long zigzag = ((unsigned long long) delta << 1) ^ (unsigned long long) (delta >> 63);
+    unsigned int id = sink->site_count++;
+    int result = CLOGGER_TRUE;
+
+    if (precision != sink->precision)
+    {
+        unsigned char entry[2] = {CLOGGER_BINARY_PRECISION, (unsigned char) precision};
+
+        result = put_bytes(sink, entry, sizeof entry);
+        sink->precision = precision;
+    }
+
+    result = result && put_bytes(sink, &site[0], 1) && put_varint(sink, id) && put_bytes(sink, &site[1], 1)
+             && put_string(sink, name) && put_string(sink, record->location) && put_string(sink, format)
+             && put_bytes(sink, &tag, 1) && put_varint(sink, id) && put_varint(sink, zigzag)
+             && put_varint(sink, record->length) && put_bytes(sink, record->data, record->length);
+    sink->last_timestamp_ns = now;
+
+    return flush_locked(sink) && result;
+}
+
+void clog_binary_sink_drain_safe()
+{
+    // An entry cut short at the end of the buffer is skipped by the decoder
+    for (clog_binary_sink_t* sink = open_sinks; sink != NULL; sink = sink->next)
+    {
+        clog_write_all(sink->fd, sink->buffer, sink->length);
+        sink->length = 0;
+    }
+}
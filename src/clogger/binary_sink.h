@@ -0,0 +1,120 @@
+//! @file
+//! @brief Compact binary log files, decoded back into text offline with `clogger-decode`
+//! @details Messages are never formatted. Each call site, i.e. each distinct format string, location, level and
+//! logger, is written to the file once as a dictionary entry. After that a message is just the ID of its site, the
+//! time since the previous message and the raw bytes of its arguments, as captured for the `_async` functions.
+//! `clogger-decode <file>` prints the lines exactly as a `clog_file_sink_t` would have held them.
+//!
+//! The file is made of entries, each starting with a tag byte. Integers are unsigned LEB128 varints, signed ones
+//! zigzag encoded first, and strings are a varint of their length plus one followed by the characters, `0` for `NULL`.
+//! - A header: `CLOGBIN`, the version byte, the sizes of the argument types, a native `0x01020304` marking the byte
+//! order, the timestamp precision and the time the file was opened in nanoseconds since the epoch
+//! - `S` a call site: its ID, level, logger name, location and format string
+//! - `R` a message: its site ID, the time since the previous message in nanoseconds and the captured arguments
+//! - `T` a message whose format can't be deferred: as `R`, with the formatted text in place of the arguments
+//! - `P` the timestamp precision changed: the new `clog_timestamp_precision_t`
+//! @note Arguments are stored as they are in memory, so files can only be decoded on a machine with the same byte order
+//! and type sizes. Timestamps are shown in the decoder's time zone, set `TZ` to match the machine that wrote the file.
+//! Format strings, locations and logger names don't have to be string literals, the sink keeps a copy of those of
+//! every call site.
+
+#ifndef CLOGGER_BINARY_SINK_H
+#define CLOGGER_BINARY_SINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "core.h"
+
+/// @brief Version of the file format, bumped on any incompatible change
+#define CLOGGER_BINARY_VERSION 1
+
+/// @brief Size of the header at the start of a binary log file, before the varint open time
+#define CLOGGER_BINARY_HEADER_SIZE 24
+
+/// @brief Default size of a binary sink's write buffer
+#define CLOGGER_BINARY_SINK_DEFAULT_BUFFER_SIZE 65536
+
+/// @brief Tag of a call site entry
+#define CLOGGER_BINARY_SITE 'S'
+
+/// @brief Tag of a message entry holding captured arguments
+#define CLOGGER_BINARY_RECORD 'R'
+
+/// @brief Tag of a message entry holding formatted text
+#define CLOGGER_BINARY_TEXT 'T'
+
+/// @brief Tag of a timestamp precision entry
+#define CLOGGER_BINARY_PRECISION 'P'
+
+/// @brief A binary log file kept open for the lifetime of the sink, with its own write buffer
+/// @details Attach a sink to a `clogger_t` through its `binary_sink` member to log to it instead of its `file_sink` or
+/// the console. Writes are flushed as with a `clog_file_sink_t`, and every open sink is flushed on `exit()`
+/// once the async backend has written everything queued.
+/// Structured `_kv` messages aren't written to it. Messages written while the process crashes reach the file after
+/// whatever was buffered, each with a call site entry of its own.
+typedef struct clog_binary_sink clog_binary_sink_t;
+
+/// @brief Open a binary sink, truncating the file
+/// @param file_path [in] The file path to log to, e.g. `/logs/log.bin`
+/// @param buffer_size [in] Size of the write buffer in bytes, `0` to write through on every message
+/// @param flush_interval_ms [in] Longest time in milliseconds a message may sit in the buffer, `0` to only flush when
+/// the buffer fills or when asked to
+/// @return Pointer to the sink, or `NULL` on failure
+clog_binary_sink_t* clog_binary_sink_open(const char* file_path, size_t buffer_size, unsigned int flush_interval_ms);
+
+/// @brief Write a message to a binary sink
+/// @note This function isn't typically used by the end user, `clog_messagef()` calls it for loggers with a
+/// `binary_sink`
+/// @param sink [in] Pointer to the sink
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure
+/// @param location [in] Location of the log, can be `NULL`
+/// @param timestamp [in] Time the message was logged
+/// @param format [in] String detailing the format
+/// @param args [in] Variable arguments list to use with the `format` string
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_binary_sink_write(clog_binary_sink_t* sink, clog_level_t level, clogger_t* logger, const char* location,
+                           const struct timespec* timestamp, const char* format, va_list args);
+
+/// @brief Write an already formatted message to a binary sink
+/// @note This function isn't typically used by the end user
+/// @param sink [in] Pointer to the sink
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure
+/// @param location [in] Location of the log, can be `NULL`
+/// @param timestamp [in] Time the message was logged
+/// @param format [in] String the message was formatted from, identifying the call site
+/// @param text [in] The message
+/// @param length [in] Number of characters in `text`
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_binary_sink_write_text(clog_binary_sink_t* sink, clog_level_t level, clogger_t* logger, const char* location,
+                                const struct timespec* timestamp, const char* format, const char* text, size_t length);
+
+/// @brief Write everything buffered in a binary sink to its file
+/// @param sink [in] Pointer to the sink
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_binary_sink_flush(clog_binary_sink_t* sink);
+
+/// @brief Flush and close a binary sink
+/// @warning Detach the sink from every `clogger_t` first
+/// @param sink [in] Pointer to the sink
+void clog_binary_sink_close(clog_binary_sink_t* sink);
+
+/// @brief Flush every open binary sink
+void clog_binary_sink_flush_all();
+
+/// @brief Flush every open binary sink whose flush interval has elapsed
+/// @details Called on a timer and by the idle async backend, as with `clog_file_sink_flush_expired()`
+void clog_binary_sink_flush_expired();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_BINARY_SINK_H
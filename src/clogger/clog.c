@@ -1,145 +1,717 @@
 #include "clog.h"
 #include "console.h"
+#include "line.h"
+#include "record.h"
+#include "layout.h"
+#include "ansi.h"
+#include "timestamp.h"
+#include "file_sink.h"
+#include "binary_sink.h"
+#include "dedup.h"
+#include "error_dispatch.h"
+#include "flight_recorder.h"
+#include "async.h"
+#include "fileio.h"
 #include "clogger_pch.h"
 
-typedef struct thread_args
-{
-    clog_level_t level;
-    const char* location;
-    clogger_t* logger;
-    const char* format;
-    va_list* args;
-} thread_args_t;
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
 
-void format_timestamp(char* buffer)
+void* clog_message_thread(void* args)
 {
-    char timestamp_buffer[10];
-    time_t now = time(NULL);
-    struct tm* timestamp = localtime(&now);
+    clog_record_t* record = (clog_record_t*) args;
 
-    strftime(timestamp_buffer, sizeof timestamp_buffer, "%H:%M:%S", timestamp);
+    clog_record_write(record);
+    free(record);
+    clog_async_detach_end();
 
-    strncpy(buffer, timestamp_buffer, sizeof(timestamp_buffer));
+    pthread_exit(NULL);
+    return NULL;
 }
 
-void* clog_message_thread(void* args)
+typedef struct clog_span
 {
-    thread_args_t* arguments = (thread_args_t*) args;
-
-    clog_messagef(arguments->level, arguments->logger, arguments->location, arguments->format, *arguments->args);
+    const char* text;
+    size_t length;
+} clog_span_t;
+
+#define CLOGGER_SPAN(text) {text, sizeof text - 1}
+
+#define CLOGGER_SEPARATOR " >> "
+
+// Coloured level tags with their separator, byte for byte what `clog_set_console_colour()` would have printed
+static const clog_span_t level_prefixes[] = {
+        [CLOG_LEVEL_MESSAGE] = {"", 0},
+        [CLOG_LEVEL_INFO] = CLOGGER_SPAN(CLOGGER_FG_HBLU "[INFO]" CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_DEBUG] = CLOGGER_SPAN(CLOGGER_FG_HGRN "[DEBUG]" CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_WARNING] = CLOGGER_SPAN(CLOGGER_FG_HYEL "[WARNING]" CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_ERROR] = CLOGGER_SPAN(CLOGGER_FG_HRED "[ERROR]" CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_CRITICAL] = CLOGGER_SPAN(
+                CLOGGER_FG_HWHT CLOGGER_BG_HRED "[CRITICAL]" CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_FATAL_ASSERT] = CLOGGER_SPAN(
+                CLOGGER_FG_HWHT CLOGGER_BG_HRED "[ASSERT FAILED]" CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_NON_FATAL_ASSERT] = CLOGGER_SPAN(
+                CLOGGER_FG_HWHT CLOGGER_BG_YEL "[ASSERT FAILED]" CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR)
+};
+
+// Level tags for plain text output such as files
+static const clog_span_t plain_level_prefixes[] = {
+        [CLOG_LEVEL_MESSAGE] = {"", 0},
+        [CLOG_LEVEL_INFO] = CLOGGER_SPAN("[INFO]" CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_DEBUG] = CLOGGER_SPAN("[DEBUG]" CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_WARNING] = CLOGGER_SPAN("[WARNING]" CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_ERROR] = CLOGGER_SPAN("[ERROR]" CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_CRITICAL] = CLOGGER_SPAN("[CRITICAL]" CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_FATAL_ASSERT] = CLOGGER_SPAN("[ASSERT FAILED]" CLOGGER_SEPARATOR),
+        [CLOG_LEVEL_NON_FATAL_ASSERT] = CLOGGER_SPAN("[ASSERT FAILED]" CLOGGER_SEPARATOR)
+};
+
+static const clog_span_t timestamp_open = CLOGGER_SPAN(CLOGGER_FG_HCYN);
+static const clog_span_t location_open = CLOGGER_SPAN(CLOGGER_FG_HMAG);
+static const clog_span_t field_close = CLOGGER_SPAN(CLOGGER_RESET_CONSOLE CLOGGER_SEPARATOR);
+static const clog_span_t plain_field_close = CLOGGER_SPAN(CLOGGER_SEPARATOR);
+
+static int prefix_cache_is_valid(const clogger_t* logger)
+{
+    const clog_prefix_cache_t* cache = &logger->prefix_cache;
 
-    pthread_exit(NULL);
-    return NULL;
+    return cache->name != NULL && cache->name == logger->name
+           && cache->console_colour.foreground_colour == logger->console_colour.foreground_colour
+           && cache->console_colour.background_colour == logger->console_colour.background_colour
+           && cache->colour_flags == logger->colour_flags;
 }
 
-void clog_messagef(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args)
+void append_prefix(clog_line_t* line, clog_level_t level, clogger_t* logger, const char* location,
+                   const struct timespec* now)
 {
-    char timestamp[10];
-    const char separator[] = " >> ";
+    char* end = clog_line_reserve(line, CLOGGER_TIMESTAMP_SIZE + 64);
 
-    format_timestamp(timestamp);
+    if (end == NULL)
+    {
+        return;
+    }
 
     // Timestamp
-    clog_set_console_colour((clog_console_colour_t) {CYAN, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
-    printf("%s", timestamp);
-    clog_reset_console_colour();
+    memcpy(end, timestamp_open.text, timestamp_open.length);
+    end += timestamp_open.length;
+    end += clog_format_timestamp(end, now);
+    memcpy(end, field_close.text, field_close.length);
+    end += field_close.length;
 
-    printf("%s", separator);
+    line->length = (size_t) (end - line->data);
 
     // Logger name
     if (logger != NULL)
     {
-        clog_set_console_colour(logger->console_colour, logger->colour_flags);
-        printf("%s", logger->name);
-        clog_reset_console_colour();
+        if (prefix_cache_is_valid(logger))
+        {
+            clog_line_append(line, logger->prefix_cache.text, logger->prefix_cache.length);
+        }
+        else
+        {
+            clog_line_append_colour(line, logger->console_colour, logger->colour_flags);
+            clog_line_append_string(line, logger->name != NULL ? logger->name : "");
+            clog_line_append(line, field_close.text, field_close.length);
+        }
+    }
 
-        printf("%s", separator);
+    // Log level
+    if ((unsigned) level < sizeof level_prefixes / sizeof level_prefixes[0])
+    {
+        clog_line_append(line, level_prefixes[level].text, level_prefixes[level].length);
+    }
+
+    // Location
+    if (location)
+    {
+        clog_line_append(line, location_open.text, location_open.length);
+        clog_line_append_string(line, location);
+        clog_line_append(line, field_close.text, field_close.length);
+    }
+}
+
+void append_plain_prefix(clog_line_t* line, clog_level_t level, clogger_t* logger, const char* location,
+                         const struct timespec* now)
+{
+    char* end = clog_line_reserve(line, CLOGGER_TIMESTAMP_SIZE + sizeof CLOGGER_SEPARATOR);
+
+    if (end == NULL)
+    {
+        return;
+    }
+
+    // Timestamp
+    end += clog_format_timestamp(end, now);
+    memcpy(end, CLOGGER_SEPARATOR, sizeof CLOGGER_SEPARATOR - 1);
+    end += sizeof CLOGGER_SEPARATOR - 1;
+
+    line->length = (size_t) (end - line->data);
+
+    // Logger name
+    if (logger != NULL)
+    {
+        clog_line_append_string(line, logger->name != NULL ? logger->name : "");
+        clog_line_append(line, CLOGGER_SEPARATOR, sizeof CLOGGER_SEPARATOR - 1);
     }
 
     // Log level
-    switch (level)
-    {
-        case CLOG_LEVEL_INFO:
-            clog_set_console_colour((clog_console_colour_t) {BLUE, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
-            printf("[INFO]");
-            clog_reset_console_colour();
-
-            printf("%s", separator);
-            break;
-        case CLOG_LEVEL_DEBUG:
-            clog_set_console_colour((clog_console_colour_t) {GREEN, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
-            printf("[DEBUG]");
-            clog_reset_console_colour();
-
-            printf("%s", separator);
-            break;
-        case CLOG_LEVEL_WARNING:
-            clog_set_console_colour((clog_console_colour_t) {YELLOW, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
-            printf("[WARNING]");
-            clog_reset_console_colour();
-
-            printf("%s", separator);
-            break;
-        case CLOG_LEVEL_ERROR:
-            clog_set_console_colour((clog_console_colour_t) {RED, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
-            printf("[ERROR]");
-            clog_reset_console_colour();
-
-            printf("%s", separator);
-            break;
-        case CLOG_LEVEL_CRITICAL:
-            clog_set_console_colour((clog_console_colour_t) {WHITE, RED},
-                                    CLOGGER_FOREGROUND_INTENSE | CLOGGER_BACKGROUND_INTENSE);
-            printf("[CRITICAL]");
-            clog_reset_console_colour();
-
-            printf("%s", separator);
-            break;
-        case CLOG_LEVEL_FATAL_ASSERT:
-            clog_set_console_colour((clog_console_colour_t) {WHITE, RED},
-                                    CLOGGER_FOREGROUND_INTENSE | CLOGGER_BACKGROUND_INTENSE);
-
-            printf("[ASSERT FAILED]");
-            clog_reset_console_colour();
-
-            printf("%s", separator);
-            break;
-        case CLOG_LEVEL_NON_FATAL_ASSERT:
-            clog_set_console_colour((clog_console_colour_t) {WHITE, YELLOW}, CLOGGER_FOREGROUND_INTENSE);
-
-            printf("[ASSERT FAILED]");
-            clog_reset_console_colour();
-
-            printf("%s", separator);
-            break;
-        default:
-            break;
+    if ((unsigned) level < sizeof plain_level_prefixes / sizeof plain_level_prefixes[0])
+    {
+        clog_line_append(line, plain_level_prefixes[level].text, plain_level_prefixes[level].length);
     }
 
     // Location
     if (location)
     {
-        clog_set_console_colour((clog_console_colour_t) {MAGENTA, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
-        printf("%s", location);
-        clog_reset_console_colour();
+        clog_line_append_string(line, location);
+        clog_line_append(line, CLOGGER_SEPARATOR, sizeof CLOGGER_SEPARATOR - 1);
+    }
+}
+
+// Start a line for `logger`, coloured for the console or plain for its file sink
+void begin_line(clog_line_t* line, clog_level_t level, clogger_t* logger, const char* location,
+                const struct timespec* now)
+{
+    if (logger != NULL && logger->file_sink != NULL)
+    {
+        append_plain_prefix(line, level, logger, location, now);
+    }
+    else
+    {
+        append_prefix(line, level, logger, location, now);
+    }
+}
+
+void end_line(clog_line_t* line, clogger_t* logger)
+{
+    clog_line_append(line, "\n", 1);
+
+    if (logger != NULL && logger->file_sink != NULL)
+    {
+        clog_file_sink_write(logger->file_sink, line->data, line->length);
+        clog_line_reset(line);
+    }
+    else
+    {
+        clog_line_write(line, stdout);
+    }
+}
+
+// Render and write a whole line for `logger`, with its layout if it has one
+static void write_line(clog_level_t level, clogger_t* logger, const char* location, const struct timespec* now,
+                       clog_layout_message_t message, const void* context)
+{
+    clog_line_t* line = clog_line_begin();
+    const clog_layout_t* layout = logger != NULL && logger->layout != NULL ? logger->layout : clog_get_layout();
+
+    if (layout != NULL)
+    {
+        clog_layout_render(layout, line, logger != NULL && logger->file_sink != NULL, level, logger, location, now,
+                           message, context);
+    }
+    else
+    {
+        begin_line(line, level, logger, location, now);
+        message(line, context);
+    }
+
+    end_line(line, logger);
+}
+
+static void write_message(clog_level_t level, clogger_t* logger, const char* location, const char* format,
+                          va_list args)
+{
+    struct timespec now;
+    va_list message_args;
+
+    va_copy(message_args, args);
+
+    clog_line_message_t message = {format, &message_args};
+
+    clog_timestamp_now(&now);
+
+    if (logger != NULL && logger->binary_sink != NULL)
+    {
+        clog_binary_sink_write(logger->binary_sink, level, logger, location, &now, format, message_args);
+        va_end(message_args);
+        return;
+    }
+
+    write_line(level, logger, location, &now, clog_line_append_message, &message);
+
+    va_end(message_args);
+}
+
+static void append_span(clog_line_t* line, const void* context)
+{
+    const clog_span_t* span = context;
+
+    clog_line_append(line, span->text, span->length);
+}
+
+// The sink messages of `logger` go to, as far as folding duplicates is concerned
+static clog_dedup_target_t message_target(clogger_t* logger)
+{
+    clog_dedup_target_t target = {CLOG_DEDUP_CONSOLE, NULL};
+
+    if (logger != NULL && logger->binary_sink != NULL)
+    {
+        target.type = CLOG_DEDUP_BINARY_SINK;
+        target.sink = logger->binary_sink;
+    }
+    else if (logger != NULL && logger->file_sink != NULL)
+    {
+        target.type = CLOG_DEDUP_FILE_SINK;
+        target.sink = logger->file_sink;
+    }
+
+    return target;
+}
+
+void clog_messagef(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args)
+{
+    clog_dedup_mode_t dedup = clog_get_dedup();
+
+    if (dedup == CLOG_DEDUP_OFF)
+    {
+        write_message(level, logger, location, format, args);
+        return;
+    }
+
+    clog_dedup_target_t target = message_target(logger);
+    unsigned long long hash = clog_dedup_hash_message(level, logger, location);
+    char text[CLOGGER_LINE_SIZE];
+    clog_span_t span = {text, 0};
+    int formatted = CLOGGER_FALSE;
+    clog_dedup_slot_t* slot;
+
+    if (dedup == CLOG_DEDUP_TEXT)
+    {
+        va_list text_args;
+
+        va_copy(text_args, args);
+        int length = vsnprintf(text, sizeof text, format, text_args);
+        va_end(text_args);
+
+        if (length >= 0)
+        {
+            // Longer messages are compared on their start, and formatted again if written
+            formatted = (size_t) length < sizeof text;
+            span.length = formatted ? (size_t) length : sizeof text - 1;
+        }
+
+        hash = clog_dedup_hash(hash, span.text, span.length);
+    }
+    else
+    {
+        hash = clog_dedup_hash(hash, format, strlen(format));
+    }
+
+    if (!clog_dedup_enter(&target, hash, level, logger, location, &slot))
+    {
+        return;
+    }
+
+    if (formatted && target.type != CLOG_DEDUP_BINARY_SINK)
+    {
+        struct timespec now;
+
+        clog_timestamp_now(&now);
+        write_line(level, logger, location, &now, append_span, &span);
+    }
+    else
+    {
+        write_message(level, logger, location, format, args);
+    }
+
+    clog_dedup_leave(slot);
+}
+
+typedef struct clog_suppressed_message
+{
+    clog_line_message_t message;
+    unsigned long long suppressed;
+} clog_suppressed_message_t;
+
+static void append_suppressed_message(clog_line_t* line, const void* context)
+{
+    const clog_suppressed_message_t* message = context;
+    char note[32];
+    int length = snprintf(note, sizeof note, " (%llu suppressed)", message->suppressed);
+
+    clog_line_append_message(line, &message->message);
+
+    if (length > 0)
+    {
+        clog_line_append(line, note, (size_t) length);
+    }
+}
+
+void clog_messagef_suppressed(clog_level_t level, clogger_t* logger, const char* location,
+                              unsigned long long suppressed, const char* format, va_list args)
+{
+    if (suppressed == 0)
+    {
+        clog_messagef(level, logger, location, format, args);
+        return;
+    }
+
+    struct timespec now;
+    va_list message_args;
+    clog_dedup_slot_t* slot = NULL;
+
+    if (clog_get_dedup() != CLOG_DEDUP_OFF)
+    {
+        // Never folded, or the note would be lost
+        clog_dedup_target_t target = message_target(logger);
+
+        clog_dedup_enter(&target, 0, level, logger, location, &slot);
+    }
+
+    va_copy(message_args, args);
+
+    clog_suppressed_message_t message = {{format, &message_args}, suppressed};
+
+    clog_timestamp_now(&now);
+
+    if (logger != NULL && logger->binary_sink != NULL)
+    {
+        // The note isn't part of the format, so the message goes in as text
+        clog_line_t* line = clog_line_begin();
+
+        append_suppressed_message(line, &message);
+        clog_binary_sink_write_text(logger->binary_sink, level, logger, location, &now, format, line->data,
+                                    line->length);
+        clog_line_reset(line);
+    }
+    else
+    {
+        write_line(level, logger, location, &now, append_suppressed_message, &message);
+    }
+
+    va_end(message_args);
+    clog_dedup_leave(slot);
+}
+
+void clog_record_capture(clog_record_t* record, clog_level_t level, clogger_t* logger, const char* location,
+                         const char* format, va_list args)
+{
+    record->level = level;
+    record->logger = logger;
+    record->location = location;
+    clog_timestamp_now(&record->timestamp);
+    record->format = clog_format_lookup(format);
+
+    if (record->format != NULL)
+    {
+        va_list capture_args;
+
+        va_copy(capture_args, args);
+        record->length = clog_format_capture(record->format, record->data, sizeof record->data, capture_args);
+        va_end(capture_args);
+
+        if (record->length > 0 || record->format->spec_count == 0)
+        {
+            return;
+        }
+
+        // Arguments didn't fit, format them now instead
+        record->format = NULL;
+    }
+
+    char* text = (char*) record->data;
+    int length = vsnprintf(text, sizeof record->data, format, args);
+
+    if (length < 0)
+    {
+        length = 0;
+        text[0] = '\0';
+    }
+    else if ((size_t) length >= sizeof record->data)
+    {
+        length = sizeof record->data - 1;
+    }
+
+    record->length = (size_t) length;
+}
+
+static void append_record_message(clog_line_t* line, const void* context)
+{
+    const clog_record_t* record = context;
+
+    if (record->format != NULL)
+    {
+        size_t available = line->capacity - line->length;
+        size_t length = clog_format_render(record->format, record->data, record->length, line->data + line->length,
+                                           available);
+
+        if (length >= available)
+        {
+            // Didn't fit, grow to the exact size and render again
+            if (clog_line_reserve(line, length + 1) != NULL)
+            {
+                clog_format_render(record->format, record->data, record->length, line->data + line->length,
+                                   length + 1);
+            }
+            else
+            {
+                length = available > 0 ? available - 1 : 0;
+            }
+        }
+
+        line->length += length;
+    }
+    else
+    {
+        clog_line_append(line, (const char*) record->data, record->length);
+    }
+}
+
+static void write_record(const clog_record_t* record)
+{
+    if (record->logger != NULL && record->logger->binary_sink != NULL)
+    {
+        clog_binary_sink_write_record(record->logger->binary_sink, record);
+        return;
+    }
+
+    write_line(record->level, record->logger, record->location, &record->timestamp, append_record_message, record);
+}
+
+void clog_record_write(const clog_record_t* record)
+{
+    clog_dedup_mode_t dedup = clog_get_dedup();
+
+    if (dedup == CLOG_DEDUP_OFF)
+    {
+        write_record(record);
+        return;
+    }
+
+    clog_dedup_target_t target = message_target(record->logger);
+    unsigned long long hash = clog_dedup_hash_message(record->level, record->logger, record->location);
+    clog_dedup_slot_t* slot;
+
+    if (record->format != NULL)
+    {
+        hash = clog_dedup_hash(hash, record->format->format, strlen(record->format->format));
+
+        if (dedup == CLOG_DEDUP_TEXT)
+        {
+            // The captured arguments stand in for the text, so nothing is formatted
+            hash = clog_dedup_hash(hash, record->data, record->length);
+        }
+    }
+    else
+    {
+        // Only the text is left of a message whose format couldn't be deferred
+        hash = clog_dedup_hash(hash, record->data, record->length);
+    }
+
+    if (clog_dedup_enter(&target, hash, record->level, record->logger, record->location, &slot))
+    {
+        write_record(record);
+        clog_dedup_leave(slot);
+    }
+}
+
+static void append_repeated(clog_line_t* line, const void* context)
+{
+    char text[sizeof CLOGGER_DEDUP_SUMMARY_FORMAT + 20];
+    int length = snprintf(text, sizeof text, CLOGGER_DEDUP_SUMMARY_FORMAT, *(const unsigned long long*) context);
+
+    if (length > 0)
+    {
+        clog_line_append(line, text, (size_t) length);
+    }
+}
+
+void clog_dedup_write_summary(const clog_dedup_target_t* target, clog_level_t level, clogger_t* logger,
+                              const char* location, unsigned long long count)
+{
+    struct timespec now;
+    clog_line_t* line = clog_line_begin();
+
+    clog_timestamp_now(&now);
+
+    if (target->type == CLOG_DEDUP_BINARY_SINK)
+    {
+        append_repeated(line, &count);
+        clog_binary_sink_write_text(target->sink, level, logger, location, &now, CLOGGER_DEDUP_SUMMARY_FORMAT,
+                                    line->data, line->length);
+        clog_line_reset(line);
+        return;
+    }
+
+    // Rendered for the sink of the run, which may no longer be attached to `logger`
+    int plain = target->type == CLOG_DEDUP_FILE_SINK;
+    const clog_layout_t* layout = logger != NULL && logger->layout != NULL ? logger->layout : clog_get_layout();
+
+    if (layout != NULL)
+    {
+        clog_layout_render(layout, line, plain, level, logger, location, &now, append_repeated, &count);
+    }
+    else
+    {
+        if (plain)
+        {
+            append_plain_prefix(line, level, logger, location, &now);
+        }
+        else
+        {
+            append_prefix(line, level, logger, location, &now);
+        }
+
+        append_repeated(line, &count);
+    }
+
+    clog_line_append(line, "\n", 1);
 
-        printf("%s", separator);
+    if (plain)
+    {
+        clog_file_sink_write(target->sink, line->data, line->length);
+        clog_line_reset(line);
+    }
+    else
+    {
+        clog_line_write(line, stdout);
+    }
+}
+
+// Append without growing, for the crash path which has no heap to fall back to
+static size_t append_safe(char* buffer, size_t size, size_t length, const char* text, size_t count)
+{
+    size_t room = length < size ? size - length : 0;
+
+    if (count > room)
+    {
+        count = room;
+    }
+
+    memcpy(buffer + length, text, count);
+
+    return length + count;
+}
+
+void clog_record_write_safe(const clog_record_t* record)
+{
+    char line[CLOGGER_LINE_SIZE];
+    char timestamp[CLOGGER_TIMESTAMP_SIZE];
+    clogger_t* logger = record->logger;
+    int plain = logger != NULL && logger->file_sink != NULL;
+    const clog_span_t* prefixes = plain ? plain_level_prefixes : level_prefixes;
+    const clog_span_t* close = plain ? &plain_field_close : &field_close;
+    size_t size = sizeof line - 1; // Room for the newline
+    size_t length = 0;
+
+    if (logger != NULL && logger->binary_sink != NULL)
+    {
+        clog_binary_sink_write_record_safe(logger->binary_sink, record);
+        return;
+    }
+
+    // Same fields as `begin_line()`, a logger without a valid prefix cache loses its colour
+    if (!plain)
+    {
+        length = append_safe(line, size, length, timestamp_open.text, timestamp_open.length);
+    }
+
+    length = append_safe(line, size, length, timestamp, clog_format_timestamp_safe(timestamp, &record->timestamp));
+    length = append_safe(line, size, length, close->text, close->length);
+
+    if (logger != NULL)
+    {
+        if (!plain && prefix_cache_is_valid(logger))
+        {
+            length = append_safe(line, size, length, logger->prefix_cache.text, logger->prefix_cache.length);
+        }
+        else
+        {
+            const char* name = logger->name != NULL ? logger->name : "";
+
+            length = append_safe(line, size, length, name, strlen(name));
+            length = append_safe(line, size, length, close->text, close->length);
+        }
+    }
+
+    if ((unsigned) record->level < sizeof level_prefixes / sizeof level_prefixes[0])
+    {
+        length = append_safe(line, size, length, prefixes[record->level].text, prefixes[record->level].length);
+    }
+
+    if (record->location != NULL)
+    {
+        if (!plain)
+        {
+            length = append_safe(line, size, length, location_open.text, location_open.length);
+        }
+
+        length = append_safe(line, size, length, record->location, strlen(record->location));
+        length = append_safe(line, size, length, close->text, close->length);
+    }
+
+    if (record->format != NULL)
+    {
+        size_t rendered = clog_format_render_safe(record->format, record->data, record->length, line + length,
+                                                  sizeof line - length);
+
+        length += rendered < size - length ? rendered : size - length;
+    }
+    else
+    {
+        length = append_safe(line, size, length, (const char*) record->data, record->length);
     }
 
-    vprintf(format, args);
-    printf("\n");
+    line[length++] = '\n';
+
+    if (plain)
+    {
+        clog_file_sink_write_safe(logger->file_sink, line, length);
+    }
+    else
+    {
+        clog_write_all(STDOUT_FILENO, line, length);
+    }
 }
 
-pthread_t
+clog_ticket_t
 clog_messagef_async(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args)
 {
+    clog_ticket_t ticket;
+
+    if (clog_async_enqueue(level, logger, location, format, args, &ticket))
+    {
+        return ticket;
+    }
+
     pthread_t thread;
+    clog_record_t* record = malloc(sizeof(clog_record_t));
+
+    if (record == NULL)
+    {
+        // Nothing to hand over, log it synchronously
+        clog_messagef(level, logger, location, format, args);
+        return CLOG_TICKET_COMPLETED;
+    }
+
+    // The record owns a copy of the arguments, so it's safe for the thread to outlive the caller's `va_list`
+    clog_record_capture(record, level, logger, location, format, args);
+
+    ticket = clog_async_detach_begin();
 
-    thread_args_t arguments = {level, location, logger, format, (va_list*) &args};
+    if (pthread_create(&thread, NULL, clog_message_thread, record) != 0)
+    {
+        clog_record_write(record);
+        free(record);
+        clog_async_detach_end();
+
+        return CLOG_TICKET_COMPLETED;
+    }
 
-    pthread_create(&thread, NULL, clog_message_thread, &arguments);
+    pthread_detach(thread);
 
-    return thread;
+    return ticket;
 }
 
 void clog_message(const char* location, const char* message, ...)
@@ -183,6 +755,7 @@ void clog_error(const char* location, const char* message, ...)
     va_list args;
 
     va_start(args, message);
+    clog_flight_recorder_dump(CLOGGER_FALSE);
     clog_messagef(CLOG_LEVEL_ERROR, NULL, location, message, args);
     va_end(args);
 }
@@ -192,80 +765,146 @@ void clog_critical(const char* location, const char* message, ...)
     va_list args;
 
     va_start(args, message);
+    clog_flight_recorder_dump(CLOGGER_FALSE);
     clog_messagef(CLOG_LEVEL_CRITICAL, NULL, location, message, args);
     va_end(args);
 }
 
-pthread_t clog_message_async(const char* location, const char* message, ...)
+clog_ticket_t clog_message_async(const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
     va_list args;
 
     va_start(args, message);
-    thread = clog_messagef_async(CLOG_LEVEL_MESSAGE, NULL, location, message, args);
+    ticket = clog_messagef_async(CLOG_LEVEL_MESSAGE, NULL, location, message, args);
     va_end(args);
 
-    return thread;
+    return ticket;
 }
 
-pthread_t clog_info_async(const char* location, const char* message, ...)
+clog_ticket_t clog_info_async(const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
     va_list args;
 
     va_start(args, message);
-    thread = clog_messagef_async(CLOG_LEVEL_INFO, NULL, location, message, args);
+    ticket = clog_messagef_async(CLOG_LEVEL_INFO, NULL, location, message, args);
     va_end(args);
 
-    return thread;
+    return ticket;
 }
 
-pthread_t clog_debug_async(const char* location, const char* message, ...)
+clog_ticket_t clog_debug_async(const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
     va_list args;
 
     va_start(args, message);
-    thread = clog_messagef_async(CLOG_LEVEL_DEBUG, NULL, location, message, args);
+    ticket = clog_messagef_async(CLOG_LEVEL_DEBUG, NULL, location, message, args);
     va_end(args);
 
-    return thread;
+    return ticket;
 }
 
-pthread_t clog_warning_async(const char* location, const char* message, ...)
+clog_ticket_t clog_warning_async(const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
     va_list args;
 
     va_start(args, message);
-    thread = clog_messagef_async(CLOG_LEVEL_WARNING, NULL, location, message, args);
+    ticket = clog_messagef_async(CLOG_LEVEL_WARNING, NULL, location, message, args);
     va_end(args);
 
-    return thread;
+    return ticket;
 }
 
-pthread_t clog_error_async(const char* location, const char* message, ...)
+clog_ticket_t clog_error_async(const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
     va_list args;
 
     va_start(args, message);
-    thread = clog_messagef_async(CLOG_LEVEL_ERROR, NULL, location, message, args);
+    clog_flight_recorder_dump(CLOGGER_TRUE);
+    ticket = clog_messagef_async(CLOG_LEVEL_ERROR, NULL, location, message, args);
     va_end(args);
 
-    return thread;
+    return ticket;
 }
 
-pthread_t clog_critical_async(const char* location, const char* message, ...)
+clog_ticket_t clog_critical_async(const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
     va_list args;
 
     va_start(args, message);
-    thread = clog_messagef_async(CLOG_LEVEL_CRITICAL, NULL, location, message, args);
+    clog_flight_recorder_dump(CLOGGER_TRUE);
+    ticket = clog_messagef_async(CLOG_LEVEL_CRITICAL, NULL, location, message, args);
     va_end(args);
 
-    return thread;
+    return ticket;
+}
+
+void clog_wait(clog_ticket_t ticket)
+{
+    clog_async_wait(ticket, NULL);
+}
+
+static pthread_once_t exit_flush_once = PTHREAD_ONCE_INIT;
+
+// What's still queued goes to the sinks before they're flushed for the last time, whichever was set up first
+static void flush_at_exit()
+{
+    clog_async_stop();
+
+    // Also waits for the threads of detached messages, still writing when the backend wasn't running
+    clog_flush();
+    clog_file_sink_finish_rotations();
+}
+
+static void register_exit_flush()
+{
+    atexit(flush_at_exit);
+}
+
+void clog_register_exit_flush()
+{
+    pthread_once(&exit_flush_once, register_exit_flush);
+}
+
+void clog_flush()
+{
+    clog_async_flush();
+    clog_error_dispatch_flush();
+    clog_dedup_flush_all();
+    clog_file_sink_flush_all();
+    clog_binary_sink_flush_all();
+    fflush(stdout);
+}
+
+int clog_flush_timeout(unsigned int timeout_ms)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    int result = clog_async_flush_until(&deadline);
+
+    clog_error_dispatch_flush();
+    clog_dedup_flush_all();
+
+    clog_file_sink_flush_all();
+    clog_binary_sink_flush_all();
+    fflush(stdout);
+
+    return result;
 }
 
 void clog_trace(const char* function_name, const char* file_name, int line)
@@ -284,24 +923,14 @@ int clog_to_file(const char* file_path, const char* location, const char* messag
 
     if (file_ptr != NULL)
     {
-        char timestamp[10];
-
-        format_timestamp(timestamp);
-
-        fputs(timestamp, file_ptr);
-        fputs(" >> ", file_ptr);
-
-        if (location)
-        {
-            fputs(location, file_ptr);
-            fputs(" >> ", file_ptr);
-        }
+        clog_line_t* line = clog_line_begin();
 
         va_start(args, message);
-        vfprintf(file_ptr, message, args);
+        clog_layout_render_entry(line, location, message, args);
         va_end(args);
 
-        fputs("\n", file_ptr);
+        fwrite(line->data, 1, line->length, file_ptr);
+        clog_line_reset(line);
 
         result = CLOGGER_TRUE;
 
@@ -327,24 +956,14 @@ int clog_append_to_file(const char* file_path, const char* location, const char*
 
     if (file_ptr != NULL)
     {
-        char timestamp[10];
-
-        format_timestamp(timestamp);
-
-        fputs(timestamp, file_ptr);
-        fputs(" >> ", file_ptr);
-
-        if (location)
-        {
-            fputs(location, file_ptr);
-            fputs(" >> ", file_ptr);
-        }
+        clog_line_t* line = clog_line_begin();
 
         va_start(args, message);
-        vfprintf(file_ptr, message, args);
+        clog_layout_render_entry(line, location, message, args);
         va_end(args);
 
-        fputs("\n", file_ptr);
+        fwrite(line->data, 1, line->length, file_ptr);
+        clog_line_reset(line);
 
         result = CLOGGER_TRUE;
 
@@ -359,6 +978,31 @@ int clog_append_to_file(const char* file_path, const char* location, const char*
     return result;
 }
 
+// Create and open the temporary file named by `name_template`, which ends in `XXXXXX`, with the permissions of `original`
+FILE* open_temporary_file(char* name_template, FILE* original)
+{
+#ifdef WIN32
+    (void) original;
+
+    return _mktemp_s(name_template, strlen(name_template) + 1) == 0 ? fopen(name_template, "wb") : NULL;
+#else
+    struct stat original_stat;
+    int fd = mkstemp(name_template);
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    if (fstat(fileno(original), &original_stat) == 0)
+    {
+        fchmod(fd, original_stat.st_mode & 07777);
+    }
+
+    return fdopen(fd, "w");
+#endif
+}
+
 int clog_prepend_to_file(const char* file_path, const char* location, const char* message, ...)
 {
     va_list args;
@@ -368,64 +1012,69 @@ int clog_prepend_to_file(const char* file_path, const char* location, const char
 
     file_ptr = fopen(file_path, "r");
 
-    if (file_ptr != NULL)
-    {
-        // Open a temporary file
-        const char* temp_file_name = "temp";
-        FILE* temp;
-        temp = fopen(temp_file_name, "a+");
-
-        char timestamp[10];
-
-        format_timestamp(timestamp);
+    // A uniquely named temporary file next to the original, so concurrent callers don't clobber each other's
+    char* temp_file_name = malloc(strlen(file_path) + sizeof ".XXXXXX");
+    FILE* temp = NULL;
 
-        fputs(timestamp, temp);
-        fputs(" >> ", temp);
+    if (file_ptr != NULL && temp_file_name != NULL)
+    {
+        strcpy(temp_file_name, file_path);
+        strcat(temp_file_name, ".XXXXXX");
+        temp = open_temporary_file(temp_file_name, file_ptr);
+    }
 
-        if (location)
-        {
-            fputs(location, temp);
-            fputs(" >> ", temp);
-        }
+    if (temp != NULL)
+    {
+        clog_line_t* line = clog_line_begin();
 
         va_start(args, message);
-        vfprintf(temp, message, args);
+        clog_layout_render_entry(line, location, message, args);
         va_end(args);
 
-        fputs("\n", temp);
+        fwrite(line->data, 1, line->length, temp);
+        clog_line_reset(line);
 
         // Copy original contents to temporary file
-        int c;
-        while ((c = fgetc(file_ptr)) != EOF)
+        char buffer[8192];
+        size_t count;
+
+        while ((count = fread(buffer, 1, sizeof buffer, file_ptr)) > 0)
         {
-            fputc(c, temp);
+            fwrite(buffer, 1, count, temp);
         }
 
-        // Close and re-open the file in read mode
-        fclose(temp);
-        temp = fopen(temp_file_name, "r");
+        result = !ferror(file_ptr) && !ferror(temp);
 
         fclose(file_ptr);
-        file_ptr = fopen(file_path, "w+");
+        result = fclose(temp) == 0 && result;
 
-        // Copy contents back to original file
-        while ((c = fgetc(temp)) != EOF)
+        // Swap the temporary file in place of the original rather than copying it all back
+        if (result)
         {
-            fputc(c, file_ptr);
+#ifdef WIN32
+            remove(file_path);
+#endif
+            result = rename(temp_file_name, file_path) == 0;
         }
-        fclose(file_ptr);
 
-        // Delete the temporary file
-        fclose(temp);
-        remove(temp_file_name);
-
-        result = CLOGGER_TRUE;
+        if (!result)
+        {
+            perror(file_path);
+            remove(temp_file_name);
+        }
     }
     else
     {
         perror(file_path);
         clog_error(__FUNCTION__, "Could not open file %s", file_path);
+
+        if (file_ptr != NULL)
+        {
+            fclose(file_ptr);
+        }
     }
 
+    free(temp_file_name);
+
     return result;
 }
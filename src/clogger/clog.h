@@ -22,6 +22,17 @@ extern "C" {
 /// @param args [in] Variable arguments list to use with the `format` string
 void clog_messagef(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args);
 
+/// @brief Variant of `clog_messagef()` noting how many messages were suppressed before this one, e.g. by a rate limit
+/// @note This function isn't typically used by the end user, the rate limited macros call it
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure. Pass `NULL` if not used
+/// @param location [in] Location of the log, usually `__FUNCTION__` though can be `NULL`
+/// @param suppressed [in] Number of messages suppressed, appended to the message as ` (N suppressed)` unless `0`
+/// @param format [in] String detailing the format
+/// @param args [in] Variable arguments list to use with the `format` string
+void clog_messagef_suppressed(clog_level_t level, clogger_t* logger, const char* location,
+                              unsigned long long suppressed, const char* format, va_list args);
+
 /// @brief Asynchronous variant of `clog_messagef()`
 /// @note This function isn't typically used by the end user, it's advisable to use the standard functions
 /// @param level [in] The log level
@@ -29,8 +40,8 @@ void clog_messagef(clog_level_t level, clogger_t* logger, const char* location,
 /// @param location [in] Location of the log, usually `__FUNCTION__` though can be `NULL`
 /// @param format [in] String detailing the format
 /// @param args [in] Variable arguments list to use with the `format` string
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clog_messagef_async(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clog_messagef_async(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args);
 
 /// @brief The generic logging message
 /// @param location [in] Location of the log, usually `__FUNCTION__` though can be `NULL`
@@ -72,43 +83,61 @@ void clog_critical(const char* location, const char* message, ...);
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clog_message_async(const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clog_message_async(const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clog_info()`
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clog_info_async(const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clog_info_async(const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clog_debug()`
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clog_debug_async(const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clog_debug_async(const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clog_warning()`
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clog_warning_async(const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clog_warning_async(const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clog_error()`
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clog_error_async(const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clog_error_async(const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clog_critical()`
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clog_critical_async(const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clog_critical_async(const char* location, const char* message, ...);
+
+/// @brief Wait for an asynchronous message to be written
+/// @details With the async backend (see `clog_async_start()`) running this waits for the backend to reach the message,
+/// otherwise for the threads of every outstanding `_async` call to finish. Completed tickets return at once.
+/// @note In `CLOG_ASYNC_THREAD_BUFFERS` mode, waiting on a ticket from another thread waits for every thread's buffer
+/// @param ticket [in] Ticket returned by an `_async` function
+void clog_wait(clog_ticket_t ticket);
+
+/// @brief Write out every buffered message
+/// @details Waits for the async backend (see `clog_async_start()`) to write everything queued so far, and for the
+/// threads of outstanding `_async` calls, then flushes every open `clog_file_sink_t` and `stdout`
+void clog_flush();
+
+/// @brief Variant of `clog_flush()` that gives up waiting after a while
+/// @details File sinks and `stdout` are flushed either way
+/// @param timeout_ms [in] Longest time to wait in milliseconds
+/// @return `CLOGGER_FALSE` if the timeout passed before every message was written, otherwise `CLOGGER_TRUE`
+int clog_flush_timeout(unsigned int timeout_ms);
 
 /// @brief Log message to file
 /// @param file_path [in] The file path to dump the log message.
@@ -116,6 +145,7 @@ pthread_t clog_critical_async(const char* location, const char* message, ...);
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
+/// @note The file is opened and closed on every call, for frequent logging attach a `clog_file_sink_t` to a `clogger_t`
 /// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
 int clog_to_file(const char* file_path, const char* location, const char* message, ...);
 
@@ -125,12 +155,15 @@ int clog_to_file(const char* file_path, const char* location, const char* messag
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
+/// @note The file is opened and closed on every call, for frequent logging attach a `clog_file_sink_t` to a `clogger_t`
 /// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
 int clog_append_to_file(const char* file_path, const char* location, const char* message, ...);
 
 /// @brief Prepend log message to file
 /// @param file_path [in] The file path to dump the log message.
 /// @warning This should be the path to the actual file e.g. `/logs/log.txt`
+/// @note The whole file is rewritten on every call, and of two concurrent calls only one message may survive. For
+/// frequent logging use a `clog_prepend_sink_t`, which appends in constant time and reads back newest first
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
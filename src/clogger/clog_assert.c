@@ -3,11 +3,23 @@
 #include "core.h"
 #include "console.h"
 #include "clog.h"
+#include "crash.h"
+#include "flight_recorder.h"
 
-int evaluate_assert(int condition, const char* location, const char* message, va_list args)
+// Nothing logged before the failure should be lost with the process
+static void assert_abort()
+{
+    clog_crash_drain();
+    abort();
+}
+
+// Not shared with clog_expect.c, which leaves the flight recorder alone
+static int evaluate_assert(int condition, const char* location, const char* message, va_list args)
 {
     if (!condition)
     {
+        // The context leading up to it goes first
+        clog_flight_recorder_dump(CLOGGER_FALSE);
         clog_messagef(CLOG_LEVEL_FATAL_ASSERT, NULL, location, message, args);
     }
 
@@ -24,7 +36,7 @@ void clog_assert(int condition, const char* location, const char* message, ...)
 
     if (!condition)
     {
-        abort();
+        assert_abort();
     }
 }
 
@@ -50,7 +62,7 @@ void clog_assert_int8_eq(int8_t expected, int8_t actual, const char* location, c
 
         printf(" >> %d\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -76,7 +88,7 @@ void clog_assert_int8_neq(int8_t not_expected, int8_t actual, const char* locati
 
         printf(" >> %d\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -96,7 +108,7 @@ void clog_assert_int8_is_nullptr(const int8_t* value_ptr, const char* location,
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -114,7 +126,7 @@ void clog_assert_int8_is_not_nullptr(const int8_t* value_ptr, const char* locati
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -140,7 +152,7 @@ void clog_assert_uint8_eq(uint8_t expected, uint8_t actual, const char* location
 
         printf(" >> %u\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -166,7 +178,7 @@ void clog_assert_uint8_neq(uint8_t not_expected, uint8_t actual, const char* loc
 
         printf(" >> %u\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -186,7 +198,7 @@ void clog_assert_uint8_is_nullptr(const uint8_t* value_ptr, const char* location
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -204,7 +216,7 @@ void clog_assert_uint8_is_not_nullptr(const uint8_t* value_ptr, const char* loca
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -230,7 +242,7 @@ void clog_assert_int16_eq(int16_t expected, int16_t actual, const char* location
 
         printf(" >> %d\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -256,7 +268,7 @@ void clog_assert_int16_neq(int16_t not_expected, int16_t actual, const char* loc
 
         printf(" >> %d\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -276,7 +288,7 @@ void clog_assert_int16_is_nullptr(const int16_t* value_ptr, const char* location
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -294,7 +306,7 @@ void clog_assert_int16_is_not_nullptr(const int16_t* value_ptr, const char* loca
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -320,7 +332,7 @@ void clog_assert_uint16_eq(uint16_t expected, uint16_t actual, const char* locat
 
         printf(" >> %u\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -346,7 +358,7 @@ void clog_assert_uint16_neq(uint16_t not_expected, uint16_t actual, const char*
 
         printf(" >> %u\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -366,7 +378,7 @@ void clog_assert_uint16_is_nullptr(const uint16_t* value_ptr, const char* locati
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -384,7 +396,7 @@ void clog_assert_uint16_is_not_nullptr(const uint16_t* value_ptr, const char* lo
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -410,7 +422,7 @@ void clog_assert_int32_eq(int32_t expected, int32_t actual, const char* location
 
         printf(" >> %d\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -436,7 +448,7 @@ void clog_assert_int32_neq(int32_t not_expected, int32_t actual, const char* loc
 
         printf(" >> %d\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -456,7 +468,7 @@ void clog_assert_int32_is_nullptr(const int32_t* value_ptr, const char* location
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -474,7 +486,7 @@ void clog_assert_int32_is_not_nullptr(const int32_t* value_ptr, const char* loca
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -500,7 +512,7 @@ void clog_assert_uint32_eq(uint32_t expected, uint32_t actual, const char* locat
 
         printf(" >> %u\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -526,7 +538,7 @@ void clog_assert_uint32_neq(uint32_t not_expected, uint32_t actual, const char*
 
         printf(" >> %u\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -546,7 +558,7 @@ void clog_assert_uint32_is_nullptr(const uint32_t* value_ptr, const char* locati
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -564,7 +576,7 @@ void clog_assert_uint32_is_not_nullptr(const uint32_t* value_ptr, const char* lo
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -590,7 +602,7 @@ void clog_assert_int64_eq(int64_t expected, int64_t actual, const char* location
 
         printf(" >> %ld\n", (long) actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -616,7 +628,7 @@ void clog_assert_int64_neq(int64_t not_expected, int64_t actual, const char* loc
 
         printf(" >> %ld\n", (long) actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -636,7 +648,7 @@ void clog_assert_int64_is_nullptr(const int64_t* value_ptr, const char* location
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -654,7 +666,7 @@ void clog_assert_int64_is_not_nullptr(const int64_t* value_ptr, const char* loca
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -680,7 +692,7 @@ void clog_assert_uint64_eq(uint64_t expected, uint64_t actual, const char* locat
 
         printf(" >> %lu\n", (unsigned long) actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -706,7 +718,7 @@ void clog_assert_uint64_neq(uint64_t not_expected, uint64_t actual, const char*
 
         printf(" >> %lu\n", (unsigned long) actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -726,7 +738,7 @@ void clog_assert_uint64_is_nullptr(const uint64_t* value_ptr, const char* locati
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -744,7 +756,7 @@ void clog_assert_uint64_is_not_nullptr(const uint64_t* value_ptr, const char* lo
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -762,15 +774,15 @@ void clog_assert_size_eq(size_t expected, size_t actual, const char* location, c
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %d\n", expected);
+        printf(" >> %lu\n", (unsigned long) expected);
 
         clog_set_console_colour((clog_console_colour_t) {RED, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %d\n", actual);
+        printf(" >> %lu\n", (unsigned long) actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -788,15 +800,15 @@ void clog_assert_size_neq(size_t not_expected, size_t actual, const char* locati
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> NOT %d\n", not_expected);
+        printf(" >> NOT %lu\n", (unsigned long) not_expected);
 
         clog_set_console_colour((clog_console_colour_t) {RED, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %d\n", actual);
+        printf(" >> %lu\n", (unsigned long) actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -822,7 +834,7 @@ void clog_assert_char_eq(char expected, char actual, const char* location, const
 
         printf(" >> %c\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -848,7 +860,7 @@ void clog_assert_char_neq(char not_expected, char actual, const char* location,
 
         printf(" >> %c\n", actual);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -867,15 +879,15 @@ void clog_assert_str_eq(const char* expected, size_t expected_size, const char*
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %s (%d bytes)\n", expected, expected_size);
+        printf(" >> %s (%lu bytes)\n", expected, (unsigned long) expected_size);
 
         clog_set_console_colour((clog_console_colour_t) {RED, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %s (%d bytes)\n", actual, actual_size);
+        printf(" >> %s (%lu bytes)\n", actual, (unsigned long) actual_size);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -894,15 +906,15 @@ void clog_assert_str_neq(const char* not_expected, size_t not_expected_size, con
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> NOT %s (%d bytes)\n", not_expected, not_expected_size);
+        printf(" >> NOT %s (%lu bytes)\n", not_expected, (unsigned long) not_expected_size);
 
         clog_set_console_colour((clog_console_colour_t) {RED, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %s (%d bytes)\n", actual, actual_size);
+        printf(" >> %s (%lu bytes)\n", actual, (unsigned long) actual_size);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -922,7 +934,7 @@ void clog_assert_str_is_nullptr(const char* value_ptr, const char* location, con
 
         printf(" >> AT ADDRESS %p\n", value_ptr);
 
-        abort();
+        assert_abort();
     }
 }
 
@@ -940,6 +952,6 @@ void clog_assert_str_is_not_nullptr(const char* value_ptr, const char* location,
         printf("[RECEIVED NULLPTR]");
         clog_reset_console_colour();
 
-        abort();
+        assert_abort();
     }
 }
@@ -13,6 +13,8 @@ extern "C" {
 /// @brief Assertion function that terminates the program on failure
 /// @details The assert function works similarly to the traditional std `assert()` function, logging a message if the condition supplied fails, terminating on failure. See the other specialized functions in the `clog_assert` family below for more explicit assert messages.
 /// @note For the non-fatal variant, see `clog_expect()` and the family of `clog_expect` functions
+/// @note Messages still queued for the async backend or buffered in file sinks are written out before terminating, see
+/// `clog_crash_drain()`
 /// @param condition [in] Assertion to be made
 /// @param location [in] Location of the assert
 /// @param message [in] Format-able string message as you would use `printf()` that will print on the condition failure
@@ -741,13 +741,13 @@ int clog_expect_size_eq(size_t expected, size_t actual, const char* location, co
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %d\n", expected);
+        printf(" >> %lu\n", (unsigned long) expected);
 
         clog_set_console_colour((clog_console_colour_t) {YELLOW, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %d\n", actual);
+        printf(" >> %lu\n", (unsigned long) actual);
     }
     va_end(args);
 
@@ -766,13 +766,13 @@ int clog_expect_size_neq(size_t not_expected, size_t actual, const char* locatio
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> NOT %d\n", not_expected);
+        printf(" >> NOT %lu\n", (unsigned long) not_expected);
 
         clog_set_console_colour((clog_console_colour_t) {YELLOW, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %d\n", actual);
+        printf(" >> %lu\n", (unsigned long) actual);
     }
     va_end(args);
 
@@ -842,13 +842,13 @@ int clog_expect_str_eq(const char* expected, size_t expected_size, const char* a
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %s (%d bytes)\n", expected, expected_size);
+        printf(" >> %s (%lu bytes)\n", expected, (unsigned long) expected_size);
 
         clog_set_console_colour((clog_console_colour_t) {YELLOW, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %s (%d bytes)\n", actual, actual_size);
+        printf(" >> %s (%lu bytes)\n", actual, (unsigned long) actual_size);
     }
     va_end(args);
 
@@ -868,13 +868,13 @@ int clog_expect_str_neq(const char* not_expected, size_t not_expected_size, cons
         printf("[EXPECTED RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %s (%d bytes)\n", not_expected, not_expected_size);
+        printf(" >> %s (%lu bytes)\n", not_expected, (unsigned long) not_expected_size);
 
         clog_set_console_colour((clog_console_colour_t) {YELLOW, CLEAR}, CLOGGER_FOREGROUND_INTENSE);
         printf("[ACTUAL RESULT]");
         clog_reset_console_colour();
 
-        printf(" >> %s (%d bytes)\n", actual, actual_size);
+        printf(" >> %s (%lu bytes)\n", actual, (unsigned long) actual_size);
     }
     va_end(args);
 
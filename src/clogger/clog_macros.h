@@ -0,0 +1,105 @@
+//! @file
+//! @brief Logging macros that can be compiled out below a minimum level
+//! @details Define `CLOGGER_MIN_LEVEL` before including `clogger.h` (or on the command line, e.g.
+//! `-DCLOGGER_MIN_LEVEL=CLOGGER_LEVEL_WARNING`) and every macro below that level expands to a statement that is never
+//! executed, so neither the call nor its arguments cost anything. The format string is still type checked.
+//! At or above the minimum level, the `CLOGGER_*` macros check `log_level` inline before evaluating any argument,
+//! unless the flight recorder wants the filtered out messages.
+
+#ifndef CLOGGER_CLOG_MACROS_H
+#define CLOGGER_CLOG_MACROS_H
+
+#include "core.h"
+#include "clog.h"
+#include "clogger.h"
+#include "flight_recorder.h"
+
+#ifndef CLOGGER_MIN_LEVEL
+/// @brief Lowest level the logging macros are compiled in for, one of the `CLOGGER_LEVEL_*` values
+#define CLOGGER_MIN_LEVEL CLOGGER_LEVEL_MESSAGE
+#endif
+
+/// @brief Expands to a statement that type checks `call` but never runs it
+#define CLOGGER_DISCARD(call) do { if (0) { call; } } while (0)
+
+/// @brief Calls a `clogger_*` function only if `logger` would log at `level`, before its arguments are evaluated
+#define CLOGGER_IF_LEVEL(logger, level, function, location, ...) \
+    do \
+    { \
+        clogger_t* clogger_macro_logger_ = (logger); \
+        if (clogger_macro_logger_->log_level <= (level) || clog_flight_recorder_is_enabled()) \
+        { \
+            function(clogger_macro_logger_, location, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_MESSAGE
+/// @brief `clog_message()`, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_MESSAGE`
+#define CLOG_MESSAGE(location, ...) clog_message(location, __VA_ARGS__)
+#else
+#define CLOG_MESSAGE(location, ...) CLOGGER_DISCARD(clog_message(location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_INFO
+/// @brief `clog_info()`, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_INFO`
+#define CLOG_INFO(location, ...) clog_info(location, __VA_ARGS__)
+
+/// @brief `clogger_info()` with an inline level check, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_INFO`
+#define CLOGGER_INFO(logger, location, ...) \
+    CLOGGER_IF_LEVEL(logger, CLOG_LEVEL_INFO, clogger_info, location, __VA_ARGS__)
+#else
+#define CLOG_INFO(location, ...) CLOGGER_DISCARD(clog_info(location, __VA_ARGS__))
+#define CLOGGER_INFO(logger, location, ...) CLOGGER_DISCARD(clogger_info(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_DEBUG
+/// @brief `clog_debug()`, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_DEBUG`
+#define CLOG_DEBUG(location, ...) clog_debug(location, __VA_ARGS__)
+
+/// @brief `clogger_debug()` with an inline level check, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_DEBUG`
+#define CLOGGER_DEBUG(logger, location, ...) \
+    CLOGGER_IF_LEVEL(logger, CLOG_LEVEL_DEBUG, clogger_debug, location, __VA_ARGS__)
+#else
+#define CLOG_DEBUG(location, ...) CLOGGER_DISCARD(clog_debug(location, __VA_ARGS__))
+#define CLOGGER_DEBUG(logger, location, ...) CLOGGER_DISCARD(clogger_debug(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_WARNING
+/// @brief `clog_warning()`, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_WARNING`
+#define CLOG_WARNING(location, ...) clog_warning(location, __VA_ARGS__)
+
+/// @brief `clogger_warning()` with an inline level check, compiled out if `CLOGGER_MIN_LEVEL` is above
+/// `CLOGGER_LEVEL_WARNING`
+#define CLOGGER_WARNING(logger, location, ...) \
+    CLOGGER_IF_LEVEL(logger, CLOG_LEVEL_WARNING, clogger_warning, location, __VA_ARGS__)
+#else
+#define CLOG_WARNING(location, ...) CLOGGER_DISCARD(clog_warning(location, __VA_ARGS__))
+#define CLOGGER_WARNING(logger, location, ...) CLOGGER_DISCARD(clogger_warning(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_ERROR
+/// @brief `clog_error()`, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_ERROR`
+#define CLOG_ERROR(location, ...) clog_error(location, __VA_ARGS__)
+
+/// @brief `clogger_error()` with an inline level check, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_ERROR`
+#define CLOGGER_ERROR(logger, location, ...) \
+    CLOGGER_IF_LEVEL(logger, CLOG_LEVEL_ERROR, clogger_error, location, __VA_ARGS__)
+#else
+#define CLOG_ERROR(location, ...) CLOGGER_DISCARD(clog_error(location, __VA_ARGS__))
+#define CLOGGER_ERROR(logger, location, ...) CLOGGER_DISCARD(clogger_error(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_CRITICAL
+/// @brief `clog_critical()`, compiled out if `CLOGGER_MIN_LEVEL` is above `CLOGGER_LEVEL_CRITICAL`
+#define CLOG_CRITICAL(location, ...) clog_critical(location, __VA_ARGS__)
+
+/// @brief `clogger_critical()` with an inline level check, compiled out if `CLOGGER_MIN_LEVEL` is above
+/// `CLOGGER_LEVEL_CRITICAL`
+#define CLOGGER_CRITICAL(logger, location, ...) \
+    CLOGGER_IF_LEVEL(logger, CLOG_LEVEL_CRITICAL, clogger_critical, location, __VA_ARGS__)
+#else
+#define CLOG_CRITICAL(location, ...) CLOGGER_DISCARD(clog_critical(location, __VA_ARGS__))
+#define CLOGGER_CRITICAL(logger, location, ...) CLOGGER_DISCARD(clogger_critical(logger, location, __VA_ARGS__))
+#endif
+
+#endif //CLOGGER_CLOG_MACROS_H
@@ -1,188 +1,346 @@
 #include "clogger.h"
 #include "clog.h"
+#include "error_dispatch.h"
+#include "flight_recorder.h"
+#include "ansi.h"
 
-// The "do nothing" thread so when the thread is joined, it doesn't crash
-void* thread_do_nothing(void* args) { return NULL; }
+#include <string.h>
 
 clogger_t make_clogger(const char* clogger_name)
 {
-    return (clogger_t) {clogger_name, NULL, {BLUE, CLEAR}, CLOG_LEVEL_WARNING, 0};
+    clogger_t logger = {
+            .name = clogger_name,
+            .console_colour = {BLUE, CLEAR},
+            .log_level = CLOG_LEVEL_WARNING
+    };
+
+    clogger_init(&logger);
+
+    return logger;
+}
+
+void clogger_init(clogger_t* logger)
+{
+    clog_prefix_cache_t* cache = &logger->prefix_cache;
+    const char separator[] = " >> ";
+
+    char colour[CLOGGER_COLOUR_CODE_SIZE];
+    size_t colour_length = clog_format_console_colour(colour, logger->console_colour, logger->colour_flags);
+    size_t name_length = logger->name != NULL ? strlen(logger->name) : 0;
+    size_t length = colour_length + name_length + sizeof CLOGGER_RESET_CONSOLE - 1 + sizeof separator - 1;
+
+    if (logger->name == NULL || length > sizeof cache->text)
+    {
+        // Too long to cache, or no name to tell the cache from an empty one, it'll be rendered on every call
+        cache->name = NULL;
+        return;
+    }
+
+    char* text = cache->text;
+
+    memcpy(text, colour, colour_length);
+    text += colour_length;
+    memcpy(text, logger->name, name_length);
+    text += name_length;
+    memcpy(text, CLOGGER_RESET_CONSOLE, sizeof CLOGGER_RESET_CONSOLE - 1);
+    text += sizeof CLOGGER_RESET_CONSOLE - 1;
+    memcpy(text, separator, sizeof separator - 1);
+
+    cache->name = logger->name;
+    cache->console_colour = logger->console_colour;
+    cache->colour_flags = logger->colour_flags;
+    cache->length = (unsigned short) length;
 }
 
 void clogger_info(clogger_t* logger, const char* location, const char* message, ...)
 {
-    if (logger->log_level <= CLOG_LEVEL_INFO)
+    va_list args;
+
+    if (logger->log_level > CLOG_LEVEL_INFO && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        // Filtered out with nothing to record it, the arguments are never touched
+        return;
+    }
 
-        va_start(args, message);
+    va_start(args, message);
+
+    if (logger->log_level <= CLOG_LEVEL_INFO)
+    {
         clog_messagef(CLOG_LEVEL_INFO, logger, location, message, args);
-        va_end(args);
     }
+    else
+    {
+        clog_flight_record(CLOG_LEVEL_INFO, logger, location, message, args);
+    }
+
+    va_end(args);
 }
 
 void clogger_debug(clogger_t* logger, const char* location, const char* message, ...)
 {
-    if (logger->log_level <= CLOG_LEVEL_DEBUG)
+    va_list args;
+
+    if (logger->log_level > CLOG_LEVEL_DEBUG && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return;
+    }
+
+    va_start(args, message);
 
-        va_start(args, message);
+    if (logger->log_level <= CLOG_LEVEL_DEBUG)
+    {
         clog_messagef(CLOG_LEVEL_DEBUG, logger, location, message, args);
-        va_end(args);
     }
+    else
+    {
+        clog_flight_record(CLOG_LEVEL_DEBUG, logger, location, message, args);
+    }
+
+    va_end(args);
 }
 
 void clogger_warning(clogger_t* logger, const char* location, const char* message, ...)
 {
-    if (logger->log_level <= CLOG_LEVEL_WARNING)
+    va_list args;
+
+    if (logger->log_level > CLOG_LEVEL_WARNING && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return;
+    }
+
+    va_start(args, message);
 
-        va_start(args, message);
+    if (logger->log_level <= CLOG_LEVEL_WARNING)
+    {
         clog_messagef(CLOG_LEVEL_WARNING, logger, location, message, args);
-        va_end(args);
     }
+    else
+    {
+        clog_flight_record(CLOG_LEVEL_WARNING, logger, location, message, args);
+    }
+
+    va_end(args);
 }
 
 void clogger_error(clogger_t* logger, const char* location, const char* message, ...)
 {
-    if (logger->log_level <= CLOG_LEVEL_ERROR)
+    va_list args;
+
+    if (logger->log_level > CLOG_LEVEL_ERROR && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return;
+    }
 
-        va_start(args, message);
+    va_start(args, message);
+
+    if (logger->log_level <= CLOG_LEVEL_ERROR)
+    {
+        // The context leading up to it goes first
+        clog_flight_recorder_dump(CLOGGER_FALSE);
         clog_messagef(CLOG_LEVEL_ERROR, logger, location, message, args);
-        va_end(args);
 
         // Error callback
         if (logger->error_callback)
         {
             logger->error_callback(CLOG_LEVEL_ERROR, logger->name, location);
         }
+
+        if (logger->error_callback_async)
+        {
+            clog_error_dispatch(logger->error_callback_async, CLOG_LEVEL_ERROR, logger->name, location);
+        }
     }
+    else
+    {
+        clog_flight_record(CLOG_LEVEL_ERROR, logger, location, message, args);
+    }
+
+    va_end(args);
 }
 
 void clogger_critical(clogger_t* logger, const char* location, const char* message, ...)
 {
-    if (logger->log_level <= CLOG_LEVEL_CRITICAL)
+    va_list args;
+
+    if (logger->log_level > CLOG_LEVEL_CRITICAL && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return;
+    }
 
-        va_start(args, message);
+    va_start(args, message);
+
+    if (logger->log_level <= CLOG_LEVEL_CRITICAL)
+    {
+        // The context leading up to it goes first
+        clog_flight_recorder_dump(CLOGGER_FALSE);
         clog_messagef(CLOG_LEVEL_CRITICAL, logger, location, message, args);
-        va_end(args);
 
         // Error callback
         if (logger->error_callback)
         {
             logger->error_callback(CLOG_LEVEL_CRITICAL, logger->name, location);
         }
+
+        if (logger->error_callback_async)
+        {
+            clog_error_dispatch(logger->error_callback_async, CLOG_LEVEL_CRITICAL, logger->name, location);
+        }
     }
+    else
+    {
+        clog_flight_record(CLOG_LEVEL_CRITICAL, logger, location, message, args);
+    }
+
+    va_end(args);
 }
 
-pthread_t clogger_info_async(clogger_t* logger, const char* location, const char* message, ...)
+clog_ticket_t clogger_info_async(clogger_t* logger, const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
+    va_list args;
 
-    if (logger->log_level <= CLOG_LEVEL_INFO)
+    if (logger->log_level > CLOG_LEVEL_INFO && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return CLOG_TICKET_COMPLETED;
+    }
+
+    va_start(args, message);
 
-        va_start(args, message);
-        thread = clog_messagef_async(CLOG_LEVEL_INFO, logger, location, message, args);
-        va_end(args);
+    if (logger->log_level <= CLOG_LEVEL_INFO)
+    {
+        ticket = clog_messagef_async(CLOG_LEVEL_INFO, logger, location, message, args);
     }
     else
     {
-        pthread_create(&thread, NULL, thread_do_nothing, NULL);
+        clog_flight_record(CLOG_LEVEL_INFO, logger, location, message, args);
+        ticket = CLOG_TICKET_COMPLETED;
     }
 
-    return thread;
+    va_end(args);
+
+    return ticket;
 }
 
-pthread_t clogger_debug_async(clogger_t* logger, const char* location, const char* message, ...)
+clog_ticket_t clogger_debug_async(clogger_t* logger, const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
+    va_list args;
 
-    if (logger->log_level <= CLOG_LEVEL_DEBUG)
+    if (logger->log_level > CLOG_LEVEL_DEBUG && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return CLOG_TICKET_COMPLETED;
+    }
+
+    va_start(args, message);
 
-        va_start(args, message);
-        thread = clog_messagef_async(CLOG_LEVEL_DEBUG, logger, location, message, args);
-        va_end(args);
+    if (logger->log_level <= CLOG_LEVEL_DEBUG)
+    {
+        ticket = clog_messagef_async(CLOG_LEVEL_DEBUG, logger, location, message, args);
     }
     else
     {
-        pthread_create(&thread, NULL, thread_do_nothing, NULL);
+        clog_flight_record(CLOG_LEVEL_DEBUG, logger, location, message, args);
+        ticket = CLOG_TICKET_COMPLETED;
     }
 
-    return thread;
+    va_end(args);
+
+    return ticket;
 }
 
-pthread_t clogger_warning_async(clogger_t* logger, const char* location, const char* message, ...)
+clog_ticket_t clogger_warning_async(clogger_t* logger, const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
+    va_list args;
 
-    if (logger->log_level <= CLOG_LEVEL_WARNING)
+    if (logger->log_level > CLOG_LEVEL_WARNING && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return CLOG_TICKET_COMPLETED;
+    }
+
+    va_start(args, message);
 
-        va_start(args, message);
-        thread = clog_messagef_async(CLOG_LEVEL_WARNING, logger, location, message, args);
-        va_end(args);
+    if (logger->log_level <= CLOG_LEVEL_WARNING)
+    {
+        ticket = clog_messagef_async(CLOG_LEVEL_WARNING, logger, location, message, args);
     }
     else
     {
-        pthread_create(&thread, NULL, thread_do_nothing, NULL);
+        clog_flight_record(CLOG_LEVEL_WARNING, logger, location, message, args);
+        ticket = CLOG_TICKET_COMPLETED;
     }
 
-    return thread;
+    va_end(args);
+
+    return ticket;
 }
 
-pthread_t clogger_error_async(clogger_t* logger, const char* location, const char* message, ...)
+clog_ticket_t clogger_error_async(clogger_t* logger, const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
+    va_list args;
 
-    if (logger->log_level <= CLOG_LEVEL_ERROR)
+    if (logger->log_level > CLOG_LEVEL_ERROR && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return CLOG_TICKET_COMPLETED;
+    }
 
-        va_start(args, message);
-        thread = clog_messagef_async(CLOG_LEVEL_ERROR, logger, location, message, args);
-        va_end(args);
+    va_start(args, message);
+
+    if (logger->log_level <= CLOG_LEVEL_ERROR)
+    {
+        // The context leading up to it goes first
+        clog_flight_recorder_dump(CLOGGER_TRUE);
+        ticket = clog_messagef_async(CLOG_LEVEL_ERROR, logger, location, message, args);
 
         // Error callback
-        // logger->error_callback_async(&thread ,/*clog_level_error,*/ logger->name, location);
+        if (logger->error_callback_async)
+        {
+            clog_error_dispatch(logger->error_callback_async, CLOG_LEVEL_ERROR, logger->name, location);
+        }
     }
     else
     {
-        pthread_create(&thread, NULL, thread_do_nothing, NULL);
+        clog_flight_record(CLOG_LEVEL_ERROR, logger, location, message, args);
+        ticket = CLOG_TICKET_COMPLETED;
     }
 
-    return thread;
+    va_end(args);
+
+    return ticket;
 }
 
-pthread_t clogger_critical_async(clogger_t* logger, const char* location, const char* message, ...)
+clog_ticket_t clogger_critical_async(clogger_t* logger, const char* location, const char* message, ...)
 {
-    pthread_t thread;
+    clog_ticket_t ticket;
+    va_list args;
 
-    if (logger->log_level <= CLOG_LEVEL_CRITICAL)
+    if (logger->log_level > CLOG_LEVEL_CRITICAL && !clog_flight_recorder_is_enabled())
     {
-        va_list args;
+        return CLOG_TICKET_COMPLETED;
+    }
 
-        va_start(args, message);
-        thread = clog_messagef_async(CLOG_LEVEL_CRITICAL, logger, location, message, args);
-        va_end(args);
+    va_start(args, message);
+
+    if (logger->log_level <= CLOG_LEVEL_CRITICAL)
+    {
+        // The context leading up to it goes first
+        clog_flight_recorder_dump(CLOGGER_TRUE);
+        ticket = clog_messagef_async(CLOG_LEVEL_CRITICAL, logger, location, message, args);
 
         // Error callback
-        // logger->error_callback(clog_level_critical, logger->name, location);
+        if (logger->error_callback_async)
+        {
+            clog_error_dispatch(logger->error_callback_async, CLOG_LEVEL_CRITICAL, logger->name, location);
+        }
     }
     else
     {
-        pthread_create(&thread, NULL, thread_do_nothing, NULL);
+        clog_flight_record(CLOG_LEVEL_CRITICAL, logger, location, message, args);
+        ticket = CLOG_TICKET_COMPLETED;
     }
 
-    return thread;
+    va_end(args);
+
+    return ticket;
 }
@@ -14,10 +14,19 @@ extern "C" {
 #include <pthread.h>
 
 /// @brief Simplified `clogger_t` structure creation function
-/// @param clogger_name [in] Name of the `clogger`
+/// @warning A logger passed to the `_async` functions is read again when its messages are written, so it must outlive
+/// them. Keep it static or on the heap, or call `clog_async_stop()` before it goes out of scope, see
+/// `clog_async_start()`
+/// @param clogger_name [in] Name of the `clogger`, `NULL` for an empty one
 /// @return Initialized `clogger_t`
 clogger_t make_clogger(const char* clogger_name);
 
+/// @brief Build the cached console prefix of a `clogger_t`
+/// @details `make_clogger()` already does this. Call it again after changing the `name`, `console_colour` or
+/// `colour_flags` of a `clogger_t`, or after initializing one by hand, otherwise its prefix is rendered on every call
+/// @param logger [in] Pointer to `clogger_t` data structure
+void clogger_init(clogger_t* logger);
+
 /// @brief `CLOG_LEVEL_INFO` log message, will only call if the `clogger_t` struct is set as such
 /// @param logger [in] Pointer to `clogger_t` data structure
 /// @param location [in] Location of the log
@@ -58,41 +67,41 @@ void clogger_critical(clogger_t* logger, const char* location, const char* messa
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clogger_info_async(clogger_t* logger, const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clogger_info_async(clogger_t* logger, const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clogger_debug()`
 /// @param logger [in] Pointer to `clogger_t` data structure
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clogger_debug_async(clogger_t* logger, const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clogger_debug_async(clogger_t* logger, const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clogger_warning()`
 /// @param logger [in] Pointer to `clogger_t` data structure
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clogger_warning_async(clogger_t* logger, const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clogger_warning_async(clogger_t* logger, const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clogger_error()`
-/// @note Unlike its sync variant, this does not yet support error callback
+/// @note Unlike its sync variant, this only calls the `error_callback_async` of the `clogger_t`
 /// @param logger [in] Pointer to `clogger_t` data structure
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clogger_error_async(clogger_t* logger, const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clogger_error_async(clogger_t* logger, const char* location, const char* message, ...);
 
 /// @brief Asynchronous variant of `clogger_critical()`
 /// @param logger [in] Pointer to `clogger_t` data structure
 /// @param location [in] Location of the log
 /// @param message [in] Format-able string message as you would use `printf()`
 /// @param ... [in] Variable-length args
-/// @return Thread of the function so it can be joined/awaited
-pthread_t clogger_critical_async(clogger_t* logger, const char* location, const char* message, ...);
+/// @return Ticket of the message, see `clog_wait()`
+clog_ticket_t clogger_critical_async(clogger_t* logger, const char* location, const char* message, ...);
 
 #ifdef __cplusplus
 }
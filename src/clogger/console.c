@@ -1,6 +1,72 @@
 #include "console.h"
 #include "ansi.h"
 
+#include <string.h>
+
+static const char* foreground_code(clog_colour_t colour, unsigned short flags)
+{
+    switch (colour)
+    {
+        case BLACK:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HBLK : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_BLK : CLOGGER_FG_BLK;
+        case RED:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HRED : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_RED : CLOGGER_FG_RED;
+        case GREEN:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HGRN : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_GRN : CLOGGER_FG_GRN;
+        case YELLOW:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HYEL : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_YEL : CLOGGER_FG_YEL;
+        case BLUE:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HBLU : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_BLU : CLOGGER_FG_BLU;
+        case MAGENTA:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HMAG : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_MAG : CLOGGER_FG_MAG;
+        case CYAN:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HCYN : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_CYN : CLOGGER_FG_CYN;
+        case WHITE:
+            return CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HWHT : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_WHT : CLOGGER_FG_WHT;
+        default:
+            return "";
+    }
+}
+
+static const char* background_code(clog_colour_t colour, unsigned short flags)
+{
+    switch (colour)
+    {
+        case BLACK:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HBLK : CLOGGER_BG_BLK;
+        case RED:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HRED : CLOGGER_BG_RED;
+        case GREEN:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HGRN : CLOGGER_BG_GRN;
+        case YELLOW:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HYEL : CLOGGER_BG_YEL;
+        case BLUE:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HBLU : CLOGGER_BG_BLU;
+        case MAGENTA:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HMAG : CLOGGER_BG_MAG;
+        case CYAN:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HCYN : CLOGGER_BG_CYN;
+        case WHITE:
+            return CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HWHT : CLOGGER_BG_WHT;
+        default:
+            return "";
+    }
+}
+
+size_t clog_format_console_colour(char* buffer, clog_console_colour_t console_colour, unsigned short flags)
+{
+    const char* foreground = foreground_code(console_colour.foreground_colour, flags);
+    const char* background = background_code(console_colour.background_colour, flags);
+    size_t foreground_length = strlen(foreground);
+    size_t background_length = strlen(background);
+
+    memcpy(buffer, foreground, foreground_length);
+    memcpy(buffer + foreground_length, background, background_length);
+    buffer[foreground_length + background_length] = '\0';
+
+    return foreground_length + background_length;
+}
+
 #ifdef WIN32
 
 #include <windows.h>
@@ -86,65 +152,10 @@ void clog_reset_console_colour()
 
 void clog_set_console_colour(clog_console_colour_t console_colour, unsigned short flags)
 {
-    switch (console_colour.foreground_colour)
-    {
-        case BLACK:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HBLK : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_BLK : CLOGGER_FG_BLK);
-            break;
-        case RED:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HRED : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_RED : CLOGGER_FG_RED);
-            break;
-        case GREEN:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HGRN : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_GRN : CLOGGER_FG_GRN);
-            break;
-        case YELLOW:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HYEL : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_YEL : CLOGGER_FG_YEL);
-            break;
-        case BLUE:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HBLU : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_BLU : CLOGGER_FG_BLU);
-            break;
-        case MAGENTA:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HMAG : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_MAG : CLOGGER_FG_MAG);
-            break;
-        case CYAN:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HCYN : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_CYN : CLOGGER_FG_CYN);
-            break;
-        case WHITE:
-            printf("%s", CLOGGER_FOREGROUND_INTENSE & flags ? CLOGGER_FG_HWHT : CLOGGER_UNDERSCORE & flags ? CLOGGER_FG_UL_WHT : CLOGGER_FG_WHT);
-            break;
-        default:
-            break;
-    }
+    char code[CLOGGER_COLOUR_CODE_SIZE];
 
-    switch (console_colour.background_colour)
-    {
-        case BLACK:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HBLK : CLOGGER_BG_BLK);
-            break;
-        case RED:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HRED : CLOGGER_BG_RED);
-            break;
-        case GREEN:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HGRN : CLOGGER_BG_GRN);
-            break;
-        case YELLOW:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HYEL : CLOGGER_BG_YEL);
-            break;
-        case BLUE:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HBLU : CLOGGER_BG_BLU);
-            break;
-        case MAGENTA:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HMAG : CLOGGER_BG_MAG);
-            break;
-        case CYAN:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HCYN : CLOGGER_BG_CYN);
-            break;
-        case WHITE:
-            printf("%s", CLOGGER_BACKGROUND_INTENSE & flags ? CLOGGER_BG_HWHT : CLOGGER_BG_WHT);
-            break;
-        default:
-            break;
-    }
+    clog_format_console_colour(code, console_colour, flags);
+    fputs(code, stdout);
 }
 
 void clog_reset_console_colour()
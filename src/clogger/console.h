@@ -8,6 +8,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
 #include "core.h"
 
 /// @brief Flag to make the text colour intense/bright
@@ -19,6 +21,16 @@ extern "C" {
 /// @brief Flag to underline the test
 #define CLOGGER_UNDERSCORE          0x8000
 
+/// @brief Size of a buffer large enough to hold any colour escape sequence from `clog_format_console_colour()`
+#define CLOGGER_COLOUR_CODE_SIZE 24
+
+/// @brief Function to get the ANSI escape sequence that sets the text colour in the console
+/// @param buffer [out] Buffer of at least `CLOGGER_COLOUR_CODE_SIZE` characters to receive the null terminated sequence
+/// @param console_colour [in] Colour of the text
+/// @param flags [in] Flags to manipulate the text colour
+/// @return Length of the escape sequence
+size_t clog_format_console_colour(char* buffer, clog_console_colour_t console_colour, unsigned short flags);
+
 /// @brief Function to set the text colour in the console
 /// @param console_colour [in] Colour of the text
 /// @param flags [in] Flags to manipulate the text colour
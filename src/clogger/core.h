@@ -10,6 +10,35 @@
 /// @brief Macro representing `1` or `true`
 #define CLOGGER_TRUE 1
 
+/// @brief Preprocessor value of `CLOG_LEVEL_MESSAGE`, for use in `#if` such as with `CLOGGER_MIN_LEVEL`
+#define CLOGGER_LEVEL_MESSAGE 0
+
+/// @brief Preprocessor value of `CLOG_LEVEL_INFO`
+#define CLOGGER_LEVEL_INFO 1
+
+/// @brief Preprocessor value of `CLOG_LEVEL_DEBUG`
+#define CLOGGER_LEVEL_DEBUG 2
+
+/// @brief Preprocessor value of `CLOG_LEVEL_WARNING`
+#define CLOGGER_LEVEL_WARNING 3
+
+/// @brief Preprocessor value of `CLOG_LEVEL_ERROR`
+#define CLOGGER_LEVEL_ERROR 4
+
+/// @brief Preprocessor value of `CLOG_LEVEL_CRITICAL`
+#define CLOGGER_LEVEL_CRITICAL 5
+
+/// @brief Preprocessor value of `CLOG_LEVEL_FATAL_ASSERT`
+#define CLOGGER_LEVEL_FATAL_ASSERT 6
+
+/// @brief Preprocessor value of `CLOG_LEVEL_NON_FATAL_ASSERT`
+#define CLOGGER_LEVEL_NON_FATAL_ASSERT 7
+
+/// @brief Level above every other, set `CLOGGER_MIN_LEVEL` to this to compile out all the logging macros
+#define CLOGGER_LEVEL_OFF 8
+
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,14 +46,14 @@ extern "C" {
 /// @brief Enum representing the log message level
 typedef enum clog_level
 {
-    CLOG_LEVEL_MESSAGE, ///< Standard level, not of particular interest
-    CLOG_LEVEL_INFO, ///< `INFO` level
-    CLOG_LEVEL_DEBUG, ///< `DEBUG` level
-    CLOG_LEVEL_WARNING, ///< `WARNING` level
-    CLOG_LEVEL_ERROR, ///< `ERROR` level
-    CLOG_LEVEL_CRITICAL, ///< `CRITICAL` level
-    CLOG_LEVEL_FATAL_ASSERT, ///< A failed assertion that should abort the program
-    CLOG_LEVEL_NON_FATAL_ASSERT ///< A failed assertion that should keep calm and carry on
+    CLOG_LEVEL_MESSAGE = CLOGGER_LEVEL_MESSAGE, ///< Standard level, not of particular interest
+    CLOG_LEVEL_INFO = CLOGGER_LEVEL_INFO, ///< `INFO` level
+    CLOG_LEVEL_DEBUG = CLOGGER_LEVEL_DEBUG, ///< `DEBUG` level
+    CLOG_LEVEL_WARNING = CLOGGER_LEVEL_WARNING, ///< `WARNING` level
+    CLOG_LEVEL_ERROR = CLOGGER_LEVEL_ERROR, ///< `ERROR` level
+    CLOG_LEVEL_CRITICAL = CLOGGER_LEVEL_CRITICAL, ///< `CRITICAL` level
+    CLOG_LEVEL_FATAL_ASSERT = CLOGGER_LEVEL_FATAL_ASSERT, ///< A failed assertion that should abort the program
+    CLOG_LEVEL_NON_FATAL_ASSERT = CLOGGER_LEVEL_NON_FATAL_ASSERT ///< A failed assertion that should keep calm and carry on
 } clog_level_t;
 
 /// @brief Enum representing colours
@@ -40,17 +69,58 @@ typedef struct clog_console_colour
     clog_colour_t background_colour; ///< Colour of the text highlight
 } clog_console_colour_t;
 
+/// @brief Ticket handed out by the `_async` functions, identifying a message until it has been written
+/// @details Pass it to `clog_wait()` to wait for the message. Tickets are plain values, there is nothing to release
+typedef unsigned long long clog_ticket_t;
+
+/// @brief A ticket that has already completed, returned for messages that were filtered out, dropped or written on the
+/// spot
+#define CLOG_TICKET_COMPLETED 0ULL
+
+/// @brief What an asynchronous message does when the async backend's queue is full
+typedef enum clog_backpressure
+{
+    CLOG_BACKPRESSURE_BLOCK, ///< Wait for the backend to make room, nothing is lost
+    CLOG_BACKPRESSURE_DROP_NEWEST, ///< Drop the new message, the caller never waits
+    CLOG_BACKPRESSURE_OVERWRITE_OLDEST ///< Drop the oldest queued message to make room for the new one
+} clog_backpressure_t;
+
+/// @brief Size of the console prefix cached in each `clogger_t`, longer names are rendered on every call instead
+#define CLOGGER_PREFIX_CACHE_SIZE 64
+
+/// @brief Data structure caching the rendered console prefix of a `clogger_t`, i.e. its coloured name and separator
+/// @details The cache remembers the name and colours it was built from, so it is simply ignored if they are changed
+/// afterwards. Call `clogger_init()` again to rebuild it.
+typedef struct clog_prefix_cache
+{
+    const char* name; ///< Name the prefix was built from, `NULL` if the cache is empty
+    clog_console_colour_t console_colour; ///< Colour the prefix was built from
+    unsigned short colour_flags; ///< Colour flags the prefix was built from
+    unsigned short length; ///< Length of `text`
+    char text[CLOGGER_PREFIX_CACHE_SIZE]; ///< The rendered prefix, escape sequences included
+} clog_prefix_cache_t;
+
+struct clog_error_event;
+struct clog_layout;
+struct clog_binary_sink;
+
 /// @brief Data structure representing a `clogger`
 /// @details This struct is what allows you to configure multiple "logging" instances, with a configurable name, colour, level etc.
 typedef struct clogger
 {
-    const char* name; ///< Name of the `clogger`, such as the project name or module
+    const char* name; ///< Name of the `clogger`, such as the project name or module, `NULL` for an empty one
     void (* error_callback)(clog_level_t level, const char* clogger_name,
                             const char* location); ///< Function pointer that calls on an `ERROR` or `CRITICAL` level message
-    // void (* error_callback_async)(const clog_thread* thread, const char* clogger_name, const char* location);
     clog_console_colour_t console_colour; ///< Colour dictating how the name should display in the console
     clog_level_t log_level; ///< The minimum level to log messages
     unsigned short colour_flags; ///< Flags to modify the colour
+    struct clog_file_sink* file_sink; ///< Optional `clog_file_sink_t`, when set messages are written to it instead of the console
+    clog_backpressure_t backpressure; ///< What `_async` messages do when the async backend's queue is full
+    void (* error_callback_async)(const struct clog_error_event* events,
+                                  size_t count); ///< Optional batched callback for `ERROR` and `CRITICAL` level messages, called on a dispatcher thread
+    clog_prefix_cache_t prefix_cache; ///< Cached console prefix, built by `clogger_init()`
+    const struct clog_layout* layout; ///< Optional layout from `clog_layout_compile()`, `NULL` to use the one set with `clog_set_layout()`
+    struct clog_binary_sink* binary_sink; ///< Optional `clog_binary_sink_t`, when set messages are written to it unformatted instead of the `file_sink` or the console
 } clogger_t;
 
 #ifdef __cplusplus
@@ -0,0 +1,162 @@
+#include "crash.h"
+#include "core.h"
+#include "record.h"
+#include "fileio.h"
+#include "timestamp.h"
+#include "clogger_pch.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+// Alternate stack for the crash handler, enough for a line buffer on top of whatever the signal frame needs
+#define CLOGGER_CRASH_STACK_SIZE 65536
+
+static atomic_uint budget_ms = CLOGGER_CRASH_DEFAULT_BUDGET_MS;
+static atomic_flag drained = ATOMIC_FLAG_INIT;
+
+#ifndef WIN32
+static const int crash_signals[] = {SIGSEGV, SIGBUS, SIGABRT};
+
+#define CLOGGER_CRASH_SIGNAL_COUNT (sizeof crash_signals / sizeof crash_signals[0])
+
+static struct sigaction previous_actions[CLOGGER_CRASH_SIGNAL_COUNT];
+static int installed = CLOGGER_FALSE;
+static void* alternate_stack = NULL;
+static pthread_mutex_t install_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void drain(int in_signal)
+{
+    struct timespec deadline;
+    unsigned int budget = atomic_load(&budget_ms);
+
+    if (atomic_flag_test_and_set(&drained))
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += budget / 1000;
+    deadline.tv_nsec += (long) (budget % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    // Not safe in a handler, what's left in stdout's own buffer is lost there
+    if (!in_signal)
+    {
+        fflush(stdout);
+    }
+
+    // Buffered lines are older than the queued ones, which go straight to the file after them
+    clog_async_halt_safe(&deadline);
+    clog_file_sink_drain_safe();
+    clog_binary_sink_drain_safe();
+    clog_async_drain_safe(&deadline);
+}
+
+#ifndef WIN32
+static void crash_handler(int signal_number)
+{
+    int saved_errno = errno;
+
+    drain(CLOGGER_TRUE);
+
+    // Hand the signal to whoever had it before, the default action ends the process once we return
+    for (size_t i = 0; i < CLOGGER_CRASH_SIGNAL_COUNT; i++)
+    {
+        if (crash_signals[i] == signal_number)
+        {
+            sigaction(signal_number, &previous_actions[i], NULL);
+        }
+    }
+
+    errno = saved_errno;
+    raise(signal_number);
+}
+#endif
+
+int clog_crash_handlers_install(unsigned int budget)
+{
+    atomic_store(&budget_ms, budget > 0 ? budget : CLOGGER_CRASH_DEFAULT_BUDGET_MS);
+
+    // The handler can't look up the time zone itself
+    clog_timestamp_prepare_safe();
+
+#ifdef WIN32
+    return CLOGGER_FALSE;
+#else
+    int result = CLOGGER_TRUE;
+
+    pthread_mutex_lock(&install_mutex);
+
+    if (!installed)
+    {
+        struct sigaction action;
+
+        if (alternate_stack == NULL)
+        {
+            alternate_stack = malloc(CLOGGER_CRASH_STACK_SIZE);
+
+            if (alternate_stack != NULL)
+            {
+                stack_t stack = {.ss_sp = alternate_stack, .ss_size = CLOGGER_CRASH_STACK_SIZE, .ss_flags = 0};
+
+                sigaltstack(&stack, NULL);
+            }
+        }
+
+        memset(&action, 0, sizeof action);
+        action.sa_handler = crash_handler;
+        action.sa_flags = SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+
+        for (size_t i = 0; i < CLOGGER_CRASH_SIGNAL_COUNT && result; i++)
+        {
+            if (sigaction(crash_signals[i], &action, &previous_actions[i]) != 0)
+            {
+                while (i-- > 0)
+                {
+                    sigaction(crash_signals[i], &previous_actions[i], NULL);
+                }
+
+                result = CLOGGER_FALSE;
+            }
+        }
+
+        installed = result;
+    }
+
+    pthread_mutex_unlock(&install_mutex);
+
+    return result;
+#endif
+}
+
+void clog_crash_handlers_remove()
+{
+#ifndef WIN32
+    pthread_mutex_lock(&install_mutex);
+
+    if (installed)
+    {
+        for (size_t i = 0; i < CLOGGER_CRASH_SIGNAL_COUNT; i++)
+        {
+            sigaction(crash_signals[i], &previous_actions[i], NULL);
+        }
+
+        installed = CLOGGER_FALSE;
+    }
+
+    pthread_mutex_unlock(&install_mutex);
+#endif
+}
+
+void clog_crash_drain()
+{
+    drain(CLOGGER_FALSE);
+}
@@ -0,0 +1,37 @@
+//! @file
+//! @brief Last-gasp output of queued messages when the process dies
+
+#ifndef CLOGGER_CRASH_H
+#define CLOGGER_CRASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief Default time allowed for writing out queued messages when the process dies
+#define CLOGGER_CRASH_DEFAULT_BUDGET_MS 500
+
+/// @brief Write out queued messages on `SIGSEGV`, `SIGBUS` and `SIGABRT` before the process dies
+/// @details The handler runs `clog_crash_drain()` and then re-raises the signal with the handler that was installed
+/// before, so core dumps and other crash reporters still see it. The calling thread also gets an alternate signal
+/// stack, so a stack overflow on it can still be reported. Console output still sitting in `stdout`'s own buffer
+/// can't be saved from a signal handler, only on a failed `clog_assert`.
+/// @param budget_ms [in] Longest time in milliseconds spent writing out messages, `0` for the default
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_crash_handlers_install(unsigned int budget_ms);
+
+/// @brief Put back the signal handlers replaced by `clog_crash_handlers_install()`
+void clog_crash_handlers_remove();
+
+/// @brief Write out everything still queued for the async backend and buffered in file and binary sinks
+/// @details Uses only async-signal-safe calls, writing straight to the file descriptors, and gives up once the budget
+/// from `clog_crash_handlers_install()` has passed. Only the first call does anything, as the backend stops taking
+/// messages from the queue for good. Failed `clog_assert` calls do this before aborting.
+/// @warning The process must be going down, asynchronous logging is left stalled
+void clog_crash_drain();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_CRASH_H
@@ -0,0 +1,334 @@
+#include "dedup.h"
+#include "async.h"
+#include "file_sink.h"
+#include "binary_sink.h"
+#include "clogger_pch.h"
+
+#include <stdatomic.h>
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define CLOGGER_DEDUP_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define CLOGGER_DEDUP_CLOCK CLOCK_MONOTONIC
+#endif
+
+#define CLOGGER_FNV_OFFSET 0xcbf29ce484222325ULL
+#define CLOGGER_FNV_PRIME 0x100000001b3ULL
+
+// Longest logger name and location kept for a summary, terminator included, longer ones are truncated
+#define CLOGGER_DEDUP_NAME_SIZE 64
+#define CLOGGER_DEDUP_LOCATION_SIZE 256
+
+struct clog_dedup_slot
+{
+    clog_dedup_target_t target; // Never changes once the slot is published
+    pthread_mutex_t mutex;
+    clog_dedup_slot_t* next;
+
+    // Guarded by `mutex`
+    unsigned long long hash; // Hash of the last message written, `0` if there's nothing to compare with
+    unsigned long long repeats; // Duplicates folded since the run was last reported
+    long long first_repeat_ns; // When the first of `repeats` was folded
+    clog_level_t level;
+    int has_logger;
+    clogger_t logger; // Copy of the logger of the last message, named `name`
+    char name[CLOGGER_DEDUP_NAME_SIZE];
+    int has_location;
+    char location[CLOGGER_DEDUP_LOCATION_SIZE];
+};
+
+static clog_dedup_slot_t console_slot = {
+        .target = {CLOG_DEDUP_CONSOLE, NULL},
+        .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Slots are never freed, so they can be looked up without a lock. A sink opened at the address of a closed one takes
+// over its slot, which `clog_dedup_forget()` left empty.
+static clog_dedup_slot_t* _Atomic slots = &console_slot;
+static pthread_mutex_t slots_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic int dedup_mode = CLOG_DEDUP_OFF;
+static _Atomic long long dedup_timeout_ns = 0;
+
+static long long now_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOGGER_DEDUP_CLOCK, &now);
+
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static clog_dedup_slot_t* find_slot(const clog_dedup_target_t* target)
+{
+    for (clog_dedup_slot_t* slot = atomic_load_explicit(&slots, memory_order_acquire); slot != NULL; slot = slot->next)
+    {
+        if (slot->target.sink == target->sink && slot->target.type == target->type)
+        {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static clog_dedup_slot_t* find_or_add_slot(const clog_dedup_target_t* target)
+{
+    clog_dedup_slot_t* slot = find_slot(target);
+
+    if (slot != NULL)
+    {
+        return slot;
+    }
+
+    pthread_mutex_lock(&slots_mutex);
+
+    // Another thread may have added it meanwhile
+    slot = find_slot(target);
+
+    if (slot == NULL)
+    {
+        slot = calloc(1, sizeof(clog_dedup_slot_t));
+
+        if (slot != NULL)
+        {
+            slot->target = *target;
+            pthread_mutex_init(&slot->mutex, NULL);
+            slot->next = atomic_load_explicit(&slots, memory_order_relaxed);
+            atomic_store_explicit(&slots, slot, memory_order_release);
+        }
+    }
+
+    pthread_mutex_unlock(&slots_mutex);
+
+    return slot;
+}
+
+// Write out the count of a run, with `slot` locked
+static void report_run(clog_dedup_slot_t* slot)
+{
+    clog_dedup_write_summary(&slot->target, slot->level, slot->has_logger ? &slot->logger : NULL,
+                             slot->has_location ? slot->location : NULL, slot->repeats);
+    slot->repeats = 0;
+}
+
+// Keep what the summary of a run needs from its last message, whose logger and location may be gone by then
+static void remember_message(clog_dedup_slot_t* slot, clog_level_t level, clogger_t* logger, const char* location)
+{
+    slot->level = level;
+    slot->has_logger = logger != NULL;
+    slot->has_location = location != NULL;
+
+    if (logger != NULL)
+    {
+        int cached = logger->prefix_cache.name != NULL && logger->prefix_cache.name == logger->name;
+
+        slot->logger = *logger;
+
+        if (logger->name != NULL)
+        {
+            // The cached prefix still holds the whole name, so it's only kept if the name fits
+            cached = snprintf(slot->name, sizeof slot->name, "%s", logger->name) < (int) sizeof slot->name && cached;
+            slot->logger.name = slot->name;
+        }
+
+        slot->logger.prefix_cache.name = cached ? slot->logger.name : NULL;
+    }
+
+    if (location != NULL)
+    {
+        snprintf(slot->location, sizeof slot->location, "%s", location);
+    }
+}
+
+// Report the pending runs, only those older than the timeout if `expired_only`, and forget the last messages if
+// `reset`
+static void report_runs(int expired_only, int reset)
+{
+    long long timeout = atomic_load_explicit(&dedup_timeout_ns, memory_order_relaxed);
+    long long now = expired_only ? now_ns() : 0;
+
+    if (expired_only && timeout == 0)
+    {
+        return;
+    }
+
+    for (clog_dedup_slot_t* slot = atomic_load_explicit(&slots, memory_order_acquire); slot != NULL; slot = slot->next)
+    {
+        pthread_mutex_lock(&slot->mutex);
+
+        if (slot->repeats > 0 && (!expired_only || now - slot->first_repeat_ns >= timeout))
+        {
+            report_run(slot);
+        }
+
+        if (reset)
+        {
+            slot->hash = 0;
+        }
+
+        pthread_mutex_unlock(&slot->mutex);
+    }
+}
+
+static void flush_at_exit()
+{
+    // Whatever the backend still holds may end or extend a run
+    clog_async_flush();
+    report_runs(CLOGGER_FALSE, CLOGGER_FALSE);
+
+    // The sinks may have been flushed for the last time already
+    clog_file_sink_flush_all();
+    clog_binary_sink_flush_all();
+}
+
+void clog_set_dedup(clog_dedup_mode_t mode, unsigned int timeout_ms)
+{
+    if (atomic_load(&dedup_mode) != CLOG_DEDUP_OFF)
+    {
+        // Messages hashed one way can't be compared with messages hashed another
+        atomic_store(&dedup_mode, CLOG_DEDUP_OFF);
+        report_runs(CLOGGER_FALSE, CLOGGER_TRUE);
+    }
+
+    atomic_store(&dedup_timeout_ns, (long long) timeout_ms * 1000000LL);
+
+    if (mode == CLOG_DEDUP_OFF)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&slots_mutex);
+
+    static int registered_exit = CLOGGER_FALSE;
+
+    if (!registered_exit)
+    {
+        atexit(flush_at_exit);
+        registered_exit = CLOGGER_TRUE;
+    }
+
+    pthread_mutex_unlock(&slots_mutex);
+
+    atomic_store(&dedup_mode, mode);
+}
+
+clog_dedup_mode_t clog_get_dedup()
+{
+    return (clog_dedup_mode_t) atomic_load_explicit(&dedup_mode, memory_order_relaxed);
+}
+
+void clog_dedup_flush_all()
+{
+    report_runs(CLOGGER_FALSE, CLOGGER_FALSE);
+}
+
+void clog_dedup_flush_expired()
+{
+    report_runs(CLOGGER_TRUE, CLOGGER_FALSE);
+}
+
+unsigned long long clog_dedup_hash_message(clog_level_t level, clogger_t* logger, const char* location)
+{
+    unsigned long long hash = clog_dedup_hash(CLOGGER_FNV_OFFSET, &level, sizeof level);
+
+    hash = clog_dedup_hash(hash, &logger, sizeof logger);
+
+    if (location != NULL)
+    {
+        // The terminator keeps the location apart from what follows
+        hash = clog_dedup_hash(hash, location, strlen(location) + 1);
+    }
+
+    return hash;
+}
+
+unsigned long long clog_dedup_hash(unsigned long long hash, const void* data, size_t length)
+{
+    // FNV-1a
+    const unsigned char* bytes = data;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * CLOGGER_FNV_PRIME;
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+int clog_dedup_enter(const clog_dedup_target_t* target, unsigned long long hash, clog_level_t level,
+                     clogger_t* logger, const char* location, clog_dedup_slot_t** slot)
+{
+    clog_dedup_slot_t* run = find_or_add_slot(target);
+
+    *slot = run;
+
+    if (run == NULL)
+    {
+        // Out of memory, the message is written unfolded
+        return CLOGGER_TRUE;
+    }
+
+    pthread_mutex_lock(&run->mutex);
+
+    if (hash != 0 && hash == run->hash)
+    {
+        long long now = now_ns();
+        long long timeout = atomic_load_explicit(&dedup_timeout_ns, memory_order_relaxed);
+
+        if (run->repeats++ == 0)
+        {
+            run->first_repeat_ns = now;
+        }
+
+        if (timeout != 0 && now - run->first_repeat_ns >= timeout)
+        {
+            report_run(run);
+        }
+
+        pthread_mutex_unlock(&run->mutex);
+        *slot = NULL;
+
+        return CLOGGER_FALSE;
+    }
+
+    if (run->repeats > 0)
+    {
+        report_run(run);
+    }
+
+    run->hash = hash;
+    remember_message(run, level, logger, location);
+
+    // Held until the message is written
+    return CLOGGER_TRUE;
+}
+
+void clog_dedup_leave(clog_dedup_slot_t* slot)
+{
+    if (slot != NULL)
+    {
+        pthread_mutex_unlock(&slot->mutex);
+    }
+}
+
+void clog_dedup_forget(const clog_dedup_target_t* target)
+{
+    clog_dedup_slot_t* slot = find_slot(target);
+
+    if (slot == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&slot->mutex);
+
+    if (slot->repeats > 0)
+    {
+        report_run(slot);
+    }
+
+    slot->hash = 0;
+
+    pthread_mutex_unlock(&slot->mutex);
+}
@@ -0,0 +1,130 @@
+//! @file
+//! @brief Folding runs of duplicate messages into a single "Last message repeated N times" line
+//! @details An optional stage in front of the sinks. Each message is hashed from its logger, level, location and
+//! either its format string or its formatted text, and compared with the previous message written to the same sink,
+//! i.e. the console, a `clog_file_sink_t` or a `clog_binary_sink_t`. A message matching the previous one is only
+//! counted. The count is written as `Last message repeated N times`, at the level and location of the message, when a
+//! different message reaches the sink, once the timeout has passed since the first message folded, and on
+//! `clog_flush()` or `exit()`.
+//!
+//! The async backend checks for expired timeouts while idle. Without it a timeout is only noticed by the next message,
+//! call `clog_dedup_flush_expired()` periodically if a run must be reported even when nothing else is logged.
+//! @note The stage keeps a copy of the `logger` and `location` of the last message until its run is reported, the name
+//! and location truncated to 63 and 255 characters. A `layout` of the logger must still live until then. Structured
+//! `_kv` messages and messages written while the process crashes go straight to their sink.
+
+#ifndef CLOGGER_DEDUP_H
+#define CLOGGER_DEDUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "core.h"
+
+/// @brief What makes two messages duplicates
+typedef enum clog_dedup_mode
+{
+    CLOG_DEDUP_OFF, ///< Every message is written, the default
+    CLOG_DEDUP_FORMAT, ///< Same logger, level, location and format string, whatever the arguments, nothing is formatted
+    CLOG_DEDUP_TEXT ///< Same logger, level, location and formatted text, long messages compared on their first
+    ///< `CLOGGER_LINE_SIZE - 1` characters. Deferred messages compare their captured arguments instead.
+} clog_dedup_mode_t;
+
+/// @brief Kind of sink a run of duplicates is tracked for
+/// @note This type isn't typically used by the end user
+typedef enum clog_dedup_sink_type
+{
+    CLOG_DEDUP_CONSOLE, ///< `stdout`
+    CLOG_DEDUP_FILE_SINK, ///< A `clog_file_sink_t`
+    CLOG_DEDUP_BINARY_SINK ///< A `clog_binary_sink_t`
+} clog_dedup_sink_type_t;
+
+/// @brief The sink a message is written to
+/// @note This type isn't typically used by the end user
+typedef struct clog_dedup_target
+{
+    clog_dedup_sink_type_t type; ///< Kind of sink
+    void* sink; ///< Pointer to the sink, `NULL` for the console
+} clog_dedup_target_t;
+
+/// @brief The run of duplicates of one sink
+typedef struct clog_dedup_slot clog_dedup_slot_t;
+
+/// @brief Format string of the line reporting a run of duplicates
+#define CLOGGER_DEDUP_SUMMARY_FORMAT "Last message repeated %llu times"
+
+/// @brief Fold duplicate messages, or stop folding them
+/// @details Turning folding off or changing the mode reports every pending run first
+/// @param mode [in] What makes two messages duplicates
+/// @param timeout_ms [in] Longest time in milliseconds a run goes unreported, `0` to wait for a different message
+void clog_set_dedup(clog_dedup_mode_t mode, unsigned int timeout_ms);
+
+/// @brief Get what makes two messages duplicates
+/// @return The mode, `CLOG_DEDUP_OFF` unless set by `clog_set_dedup()`
+clog_dedup_mode_t clog_get_dedup();
+
+/// @brief Report every pending run of duplicates
+void clog_dedup_flush_all();
+
+/// @brief Report every pending run of duplicates whose timeout has passed
+void clog_dedup_flush_expired();
+
+/// @brief Start hashing a message for `clog_dedup_enter()`
+/// @note This function isn't typically used by the end user
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure, can be `NULL`
+/// @param location [in] Location of the log, can be `NULL`
+/// @return The hash so far, continue it with `clog_dedup_hash()`
+unsigned long long clog_dedup_hash_message(clog_level_t level, clogger_t* logger, const char* location);
+
+/// @brief Continue the hash of a message with its format string or text
+/// @note This function isn't typically used by the end user
+/// @param hash [in] The hash so far
+/// @param data [in] Bytes to hash
+/// @param length [in] Number of bytes to hash
+/// @return The hash, never `0`
+unsigned long long clog_dedup_hash(unsigned long long hash, const void* data, size_t length);
+
+/// @brief Compare a message with the previous one of its sink, counting it if it's a duplicate
+/// @details Reports the pending run of the sink first if the message is different. The caller then writes the message
+/// and calls `clog_dedup_leave()`, so nothing else reaches the sink in between.
+/// @note This function isn't typically used by the end user
+/// @param target [in] The sink the message is written to
+/// @param hash [in] Hash of the message, `0` for a message that is never folded, such as one noting how many messages
+/// were suppressed
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure, can be `NULL`
+/// @param location [in] Location of the log, can be `NULL`
+/// @param slot [out] The run to pass to `clog_dedup_leave()`
+/// @return `CLOGGER_TRUE` if the message must be written, `CLOGGER_FALSE` if it was folded
+int clog_dedup_enter(const clog_dedup_target_t* target, unsigned long long hash, clog_level_t level,
+                     clogger_t* logger, const char* location, clog_dedup_slot_t** slot);
+
+/// @brief Let other messages reach the sink once a message let through by `clog_dedup_enter()` is written
+/// @note This function isn't typically used by the end user
+/// @param slot [in] The run given by `clog_dedup_enter()`
+void clog_dedup_leave(clog_dedup_slot_t* slot);
+
+/// @brief Report the pending run of a sink and forget its last message, before the sink is closed
+/// @note This function isn't typically used by the end user, the sinks call it when closed
+/// @param target [in] The sink
+void clog_dedup_forget(const clog_dedup_target_t* target);
+
+/// @brief Write the line reporting a run of duplicates straight to a sink
+/// @note This function isn't typically used by the end user
+/// @param target [in] The sink
+/// @param level [in] Level of the duplicated message
+/// @param logger [in] Logger of the duplicated message, can be `NULL`
+/// @param location [in] Location of the duplicated message, can be `NULL`
+/// @param count [in] Number of duplicates folded
+void clog_dedup_write_summary(const clog_dedup_target_t* target, clog_level_t level, clogger_t* logger,
+                              const char* location, unsigned long long count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_DEDUP_H
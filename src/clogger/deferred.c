@@ -0,0 +1,747 @@
+#include "deferred.h"
+#include "core.h"
+#include "clogger_pch.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of call sites whose parsed format is cached, further formats are formatted eagerly
+#define CLOGGER_FORMAT_CACHE_SIZE 1024
+
+// How far a lookup probes from the hashed slot before giving up
+#define CLOGGER_FORMAT_CACHE_PROBES 16
+
+// Longest `%s` argument that is captured, calls with longer strings are formatted eagerly
+#define CLOGGER_FORMAT_MAX_STRING 1024
+
+// Marks a captured `NULL` string, printed by `printf()` as `(null)`
+#define CLOGGER_NULL_STRING 0xFFFF
+
+typedef struct clog_format_entry
+{
+    _Atomic(const char*) key;
+    _Atomic(const clog_format_t*) value;
+} clog_format_entry_t;
+
+static clog_format_entry_t format_cache[CLOGGER_FORMAT_CACHE_SIZE];
+
+// Parse a single conversion starting at the `%`, returns the number of characters it spans or 0 if unsupported
+static size_t parse_spec(const char* start, clog_format_spec_t* spec)
+{
+    const char* cursor = start + 1;
+    int length_modifier = 0;
+
+    spec->star_count = 0;
+    spec->precision = -1;
+
+    // Flags
+    while (*cursor && strchr("-+ #0'I", *cursor))
+    {
+        cursor++;
+    }
+
+    // Width
+    if (*cursor == '*')
+    {
+        spec->star_count++;
+        cursor++;
+    }
+    else
+    {
+        while (*cursor >= '0' && *cursor <= '9')
+        {
+            cursor++;
+        }
+    }
+
+    // Precision
+    if (*cursor == '.')
+    {
+        cursor++;
+
+        if (*cursor == '*')
+        {
+            spec->star_count++;
+            cursor++;
+        }
+        else
+        {
+            spec->precision = 0;
+
+            while (*cursor >= '0' && *cursor <= '9')
+            {
+                spec->precision = spec->precision * 10 + (*cursor - '0');
+                cursor++;
+            }
+        }
+    }
+
+    // Length modifier
+    switch (*cursor)
+    {
+        case 'h':
+            cursor += cursor[1] == 'h' ? 2 : 1;
+            break;
+        case 'l':
+            length_modifier = cursor[1] == 'l' ? 'q' : 'l';
+            cursor += cursor[1] == 'l' ? 2 : 1;
+            break;
+        case 'q':
+            length_modifier = 'q';
+            cursor++;
+            break;
+        case 'j':
+        case 'z':
+        case 't':
+        case 'L':
+            length_modifier = *cursor;
+            cursor++;
+            break;
+        default:
+            break;
+    }
+
+    switch (*cursor)
+    {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (length_modifier)
+            {
+                case 'l':
+                    spec->type = CLOG_ARG_LONG;
+                    break;
+                case 'q':
+                    spec->type = CLOG_ARG_LONG_LONG;
+                    break;
+                case 'j':
+                    spec->type = CLOG_ARG_INTMAX;
+                    break;
+                case 'z':
+                    spec->type = CLOG_ARG_SIZE;
+                    break;
+                case 't':
+                    spec->type = CLOG_ARG_PTRDIFF;
+                    break;
+                case 'L':
+                    // Only some C libraries take it for `ll`, leave it to `vsnprintf()`
+                    return 0;
+                default:
+                    spec->type = CLOG_ARG_INT;
+                    break;
+            }
+            break;
+        case 'c':
+            if (length_modifier != 0)
+            {
+                return 0;
+            }
+
+            spec->type = CLOG_ARG_INT;
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec->type = length_modifier == 'L' ? CLOG_ARG_LONG_DOUBLE : CLOG_ARG_DOUBLE;
+            break;
+        case 's':
+            if (length_modifier != 0)
+            {
+                return 0;
+            }
+
+            spec->type = CLOG_ARG_STRING;
+            break;
+        case 'p':
+            spec->type = CLOG_ARG_POINTER;
+            break;
+        default:
+            // `%n` writes through the caller's pointer and `%m` reads the caller's `errno`, neither can wait
+            return 0;
+    }
+
+    cursor++;
+
+    size_t span = (size_t) (cursor - start);
+
+    if (span >= sizeof spec->conversion)
+    {
+        return 0;
+    }
+
+    memcpy(spec->conversion, start, span);
+    spec->conversion[span] = '\0';
+
+    return span;
+}
+
+int clog_format_parse(const char* format, clog_format_t* parsed)
+{
+    size_t literal_start = 0;
+    size_t i = 0;
+
+    parsed->format = format;
+    parsed->spec_count = 0;
+
+    while (format[i] != '\0')
+    {
+        if (format[i] != '%')
+        {
+            i++;
+            continue;
+        }
+
+        if (format[i + 1] == '%')
+        {
+            i += 2;
+            continue;
+        }
+
+        if (parsed->spec_count == CLOGGER_FORMAT_MAX_SPECS)
+        {
+            return CLOGGER_FALSE;
+        }
+
+        clog_format_spec_t* spec = &parsed->specs[parsed->spec_count];
+        size_t span = parse_spec(format + i, spec);
+
+        if (span == 0 || i > UINT16_MAX)
+        {
+            return CLOGGER_FALSE;
+        }
+
+        spec->literal_offset = (unsigned short) literal_start;
+        spec->literal_length = (unsigned short) (i - literal_start);
+        parsed->spec_count++;
+
+        i += span;
+        literal_start = i;
+    }
+
+    if (i > UINT16_MAX)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    parsed->tail_offset = (unsigned short) literal_start;
+    parsed->tail_length = (unsigned short) (i - literal_start);
+
+    return CLOGGER_TRUE;
+}
+
+// The cached parse of `format`, unless the text at that address changed since it was parsed, e.g. a reused buffer
+static const clog_format_t* checked_entry(const clog_format_t* parsed, const char* format)
+{
+    if (parsed == NULL || strcmp(parsed->format, format) != 0)
+    {
+        return NULL;
+    }
+
+    return parsed;
+}
+
+const clog_format_t* clog_format_lookup(const char* format)
+{
+    size_t hash = ((uintptr_t) format >> 3) * 0x9E3779B97F4A7C15ULL;
+
+    for (size_t probe = 0; probe < CLOGGER_FORMAT_CACHE_PROBES; probe++)
+    {
+        clog_format_entry_t* entry = &format_cache[(hash + probe) % CLOGGER_FORMAT_CACHE_SIZE];
+        const char* key = atomic_load_explicit(&entry->key, memory_order_acquire);
+
+        if (key == format)
+        {
+            // A concurrent insert may not have published its value yet, report it as not deferrable this time
+            return checked_entry(atomic_load_explicit(&entry->value, memory_order_acquire), format);
+        }
+
+        if (key == NULL)
+        {
+            // The parsed format keeps a copy of the text, so it never depends on the caller's buffer
+            size_t length = strlen(format);
+            clog_format_t* parsed = malloc(sizeof(clog_format_t) + length + 1);
+
+            if (parsed == NULL)
+            {
+                return NULL;
+            }
+
+            char* copy = (char*) (parsed + 1);
+
+            memcpy(copy, format, length + 1);
+
+            if (!clog_format_parse(copy, parsed))
+            {
+                free(parsed);
+                parsed = NULL;
+            }
+
+            const char* expected = NULL;
+
+            if (atomic_compare_exchange_strong(&entry->key, &expected, format))
+            {
+                // Formats that can't be deferred are cached as `NULL` so they are only parsed once
+                atomic_store_explicit(&entry->value, parsed, memory_order_release);
+                return parsed;
+            }
+
+            free(parsed);
+
+            if (expected == format)
+            {
+                return checked_entry(atomic_load_explicit(&entry->value, memory_order_acquire), format);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+#define CAPTURE_VALUE(type, value) \
+    do \
+    { \
+        type captured = (value); \
+        if (used + sizeof captured > size) return 0; \
+        memcpy(buffer + used, &captured, sizeof captured); \
+        used += sizeof captured; \
+    } while (0)
+
+size_t clog_format_capture(const clog_format_t* format, unsigned char* buffer, size_t size, va_list args)
+{
+    size_t used = 0;
+
+    for (unsigned short i = 0; i < format->spec_count; i++)
+    {
+        const clog_format_spec_t* spec = &format->specs[i];
+        int precision = spec->precision;
+
+        for (unsigned char star = 0; star < spec->star_count; star++)
+        {
+            int value = va_arg(args, int);
+
+            // The last star is the precision when one is present
+            if (star + 1 == spec->star_count && strstr(spec->conversion, ".*"))
+            {
+                precision = value;
+            }
+
+            CAPTURE_VALUE(int, value);
+        }
+
+        switch (spec->type)
+        {
+            case CLOG_ARG_INT:
+                CAPTURE_VALUE(int, va_arg(args, int));
+                break;
+            case CLOG_ARG_LONG:
+                CAPTURE_VALUE(long, va_arg(args, long));
+                break;
+            case CLOG_ARG_LONG_LONG:
+                CAPTURE_VALUE(long long, va_arg(args, long long));
+                break;
+            case CLOG_ARG_INTMAX:
+                CAPTURE_VALUE(intmax_t, va_arg(args, intmax_t));
+                break;
+            case CLOG_ARG_SIZE:
+                CAPTURE_VALUE(size_t, va_arg(args, size_t));
+                break;
+            case CLOG_ARG_PTRDIFF:
+                CAPTURE_VALUE(ptrdiff_t, va_arg(args, ptrdiff_t));
+                break;
+            case CLOG_ARG_DOUBLE:
+                CAPTURE_VALUE(double, va_arg(args, double));
+                break;
+            case CLOG_ARG_LONG_DOUBLE:
+                CAPTURE_VALUE(long double, va_arg(args, long double));
+                break;
+            case CLOG_ARG_POINTER:
+                CAPTURE_VALUE(void*, va_arg(args, void*));
+                break;
+            case CLOG_ARG_STRING:
+            {
+                const char* string = va_arg(args, const char*);
+
+                if (string == NULL)
+                {
+                    CAPTURE_VALUE(unsigned short, CLOGGER_NULL_STRING);
+                    break;
+                }
+
+                // A precision bounds how much of the string may be read, it need not be null terminated
+                size_t length = precision >= 0 ? strnlen(string, (size_t) precision) : strlen(string);
+
+                if (length > CLOGGER_FORMAT_MAX_STRING)
+                {
+                    return 0;
+                }
+
+                CAPTURE_VALUE(unsigned short, (unsigned short) length);
+
+                if (used + length > size)
+                {
+                    return 0;
+                }
+
+                memcpy(buffer + used, string, length);
+                used += length;
+                break;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    return used;
+}
+
+#undef CAPTURE_VALUE
+
+int clog_format_validate(const clog_format_t* format, const unsigned char* data, size_t length)
+{
+    static const unsigned char sizes[] = {
+            [CLOG_ARG_INT] = sizeof(int), [CLOG_ARG_LONG] = sizeof(long), [CLOG_ARG_LONG_LONG] = sizeof(long long),
+            [CLOG_ARG_INTMAX] = sizeof(intmax_t), [CLOG_ARG_SIZE] = sizeof(size_t),
+            [CLOG_ARG_PTRDIFF] = sizeof(ptrdiff_t), [CLOG_ARG_DOUBLE] = sizeof(double),
+            [CLOG_ARG_LONG_DOUBLE] = sizeof(long double), [CLOG_ARG_POINTER] = sizeof(void*),
+            [CLOG_ARG_STRING] = sizeof(unsigned short)
+    };
+    size_t used = 0;
+
+    for (unsigned short i = 0; i < format->spec_count; i++)
+    {
+        const clog_format_spec_t* spec = &format->specs[i];
+        size_t size = spec->star_count * sizeof(int) + sizes[spec->type];
+
+        if (length - used < size)
+        {
+            return CLOGGER_FALSE;
+        }
+
+        used += size;
+
+        if (spec->type == CLOG_ARG_STRING)
+        {
+            unsigned short string_length;
+
+            memcpy(&string_length, data + used - sizeof string_length, sizeof string_length);
+
+            if (string_length != CLOGGER_NULL_STRING)
+            {
+                if (string_length > CLOGGER_FORMAT_MAX_STRING || length - used < string_length)
+                {
+                    return CLOGGER_FALSE;
+                }
+
+                used += string_length;
+            }
+        }
+    }
+
+    return used == length;
+}
+
+// Copy literal format text, collapsing `%%` into `%`
+static size_t render_literal(const char* literal, size_t length, char* buffer, size_t size, size_t written)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (literal[i] == '%' && i + 1 < length && literal[i + 1] == '%')
+        {
+            i++;
+        }
+
+        if (written + 1 < size)
+        {
+            buffer[written] = literal[i];
+        }
+
+        written++;
+    }
+
+    return written;
+}
+
+#define RENDER_VALUE(type) \
+    do \
+    { \
+        type value; \
+        memcpy(&value, data + used, sizeof value); \
+        used += sizeof value; \
+        printed = spec->star_count == 0 ? snprintf(out, remaining, spec->conversion, value) \
+                : spec->star_count == 1 ? snprintf(out, remaining, spec->conversion, stars[0], value) \
+                : snprintf(out, remaining, spec->conversion, stars[0], stars[1], value); \
+    } while (0)
+
+size_t clog_format_render(const clog_format_t* format, const unsigned char* data, size_t length, char* buffer,
+                          size_t size)
+{
+    char string[CLOGGER_FORMAT_MAX_STRING + 1];
+    size_t written = 0;
+    size_t used = 0;
+
+    for (unsigned short i = 0; i < format->spec_count; i++)
+    {
+        const clog_format_spec_t* spec = &format->specs[i];
+        int stars[2] = {0, 0};
+        int printed = 0;
+
+        written = render_literal(format->format + spec->literal_offset, spec->literal_length, buffer, size, written);
+
+        for (unsigned char star = 0; star < spec->star_count; star++)
+        {
+            memcpy(&stars[star], data + used, sizeof(int));
+            used += sizeof(int);
+        }
+
+        char* out = written < size ? buffer + written : NULL;
+        size_t remaining = written < size ? size - written : 0;
+
+        switch (spec->type)
+        {
+            case CLOG_ARG_INT:
+                RENDER_VALUE(int);
+                break;
+            case CLOG_ARG_LONG:
+                RENDER_VALUE(long);
+                break;
+            case CLOG_ARG_LONG_LONG:
+                RENDER_VALUE(long long);
+                break;
+            case CLOG_ARG_INTMAX:
+                RENDER_VALUE(intmax_t);
+                break;
+            case CLOG_ARG_SIZE:
+                RENDER_VALUE(size_t);
+                break;
+            case CLOG_ARG_PTRDIFF:
+                RENDER_VALUE(ptrdiff_t);
+                break;
+            case CLOG_ARG_DOUBLE:
+                RENDER_VALUE(double);
+                break;
+            case CLOG_ARG_LONG_DOUBLE:
+                RENDER_VALUE(long double);
+                break;
+            case CLOG_ARG_POINTER:
+                RENDER_VALUE(void*);
+                break;
+            case CLOG_ARG_STRING:
+            {
+                unsigned short string_length;
+                const char* value = string;
+
+                memcpy(&string_length, data + used, sizeof string_length);
+                used += sizeof string_length;
+
+                if (string_length == CLOGGER_NULL_STRING)
+                {
+                    value = NULL;
+                }
+                else
+                {
+                    memcpy(string, data + used, string_length);
+                    string[string_length] = '\0';
+                    used += string_length;
+                }
+
+                printed = spec->star_count == 0 ? snprintf(out, remaining, spec->conversion, value)
+                        : spec->star_count == 1 ? snprintf(out, remaining, spec->conversion, stars[0], value)
+                        : snprintf(out, remaining, spec->conversion, stars[0], stars[1], value);
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (printed > 0)
+        {
+            written += (size_t) printed;
+        }
+
+        if (used > length)
+        {
+            break;
+        }
+    }
+
+    written = render_literal(format->format + format->tail_offset, format->tail_length, buffer, size, written);
+
+    if (size > 0)
+    {
+        buffer[written < size ? written : size - 1] = '\0';
+    }
+
+    return written;
+}
+
+#undef RENDER_VALUE
+
+static size_t render_char_safe(char character, char* buffer, size_t size, size_t written)
+{
+    if (written + 1 < size)
+    {
+        buffer[written] = character;
+    }
+
+    return written + 1;
+}
+
+// Integer in the base of its conversion, ignoring flags, width and precision
+static size_t render_integer_safe(char conversion, unsigned long long magnitude, int negative, char* buffer,
+                                  size_t size, size_t written)
+{
+    const char* digits = conversion == 'X' ? "0123456789ABCDEF" : "0123456789abcdef";
+    unsigned int base = conversion == 'x' || conversion == 'X' || conversion == 'p' ? 16 : conversion == 'o' ? 8 : 10;
+    char reversed[24];
+    size_t count = 0;
+
+    if (negative)
+    {
+        written = render_char_safe('-', buffer, size, written);
+    }
+
+    if (conversion == 'p')
+    {
+        written = render_char_safe('0', buffer, size, written);
+        written = render_char_safe('x', buffer, size, written);
+    }
+
+    do
+    {
+        reversed[count++] = digits[magnitude % base];
+        magnitude /= base;
+    } while (magnitude > 0);
+
+    while (count > 0)
+    {
+        written = render_char_safe(reversed[--count], buffer, size, written);
+    }
+
+    return written;
+}
+
+#define READ_VALUE(type, into) \
+    do \
+    { \
+        type value; \
+        memcpy(&value, data + used, sizeof value); \
+        used += sizeof value; \
+        into; \
+    } while (0)
+
+size_t clog_format_render_safe(const clog_format_t* format, const unsigned char* data, size_t length, char* buffer,
+                               size_t size)
+{
+    size_t written = 0;
+    size_t used = 0;
+
+    for (unsigned short i = 0; i < format->spec_count; i++)
+    {
+        const clog_format_spec_t* spec = &format->specs[i];
+        char conversion = spec->conversion[strlen(spec->conversion) - 1];
+        int is_unsigned = conversion == 'u' || conversion == 'x' || conversion == 'X' || conversion == 'o';
+        unsigned long long magnitude = 0;
+        long long signed_value = 0;
+
+        written = render_literal(format->format + spec->literal_offset, spec->literal_length, buffer, size, written);
+        used += spec->star_count * sizeof(int);
+
+        switch (spec->type)
+        {
+            case CLOG_ARG_INT:
+                READ_VALUE(int, signed_value = value; magnitude = (unsigned int) value);
+                break;
+            case CLOG_ARG_LONG:
+                READ_VALUE(long, signed_value = value; magnitude = (unsigned long) value);
+                break;
+            case CLOG_ARG_LONG_LONG:
+                READ_VALUE(long long, signed_value = value; magnitude = (unsigned long long) value);
+                break;
+            case CLOG_ARG_INTMAX:
+                READ_VALUE(intmax_t, signed_value = value; magnitude = (uintmax_t) value);
+                break;
+            case CLOG_ARG_SIZE:
+                READ_VALUE(size_t, signed_value = (long long) value; magnitude = value);
+                break;
+            case CLOG_ARG_PTRDIFF:
+                READ_VALUE(ptrdiff_t, signed_value = value; magnitude = (unsigned long long) value);
+                break;
+            case CLOG_ARG_DOUBLE:
+            case CLOG_ARG_LONG_DOUBLE:
+                // No safe way to print these, show the conversion itself
+                used += spec->type == CLOG_ARG_DOUBLE ? sizeof(double) : sizeof(long double);
+                written = render_literal(spec->conversion, strlen(spec->conversion), buffer, size, written);
+                break;
+            case CLOG_ARG_POINTER:
+                READ_VALUE(void*, magnitude = (uintptr_t) value);
+                is_unsigned = CLOGGER_TRUE;
+                break;
+            case CLOG_ARG_STRING:
+            {
+                unsigned short string_length;
+
+                memcpy(&string_length, data + used, sizeof string_length);
+                used += sizeof string_length;
+
+                if (string_length == CLOGGER_NULL_STRING)
+                {
+                    written = render_literal("(null)", 6, buffer, size, written);
+                }
+                else
+                {
+                    for (unsigned short j = 0; j < string_length && used + j < length; j++)
+                    {
+                        written = render_char_safe((char) data[used + j], buffer, size, written);
+                    }
+
+                    used += string_length;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (used > length)
+        {
+            break;
+        }
+
+        if (spec->type <= CLOG_ARG_PTRDIFF || spec->type == CLOG_ARG_POINTER)
+        {
+            if (conversion == 'c')
+            {
+                written = render_char_safe((char) signed_value, buffer, size, written);
+            }
+            else if (is_unsigned || signed_value >= 0)
+            {
+                written = render_integer_safe(conversion, magnitude, CLOGGER_FALSE, buffer, size, written);
+            }
+            else
+            {
+                written = render_integer_safe(conversion, 0ULL - (unsigned long long) signed_value, CLOGGER_TRUE,
+                                              buffer, size, written);
+            }
+        }
+    }
+
+    written = render_literal(format->format + format->tail_offset, format->tail_length, buffer, size, written);
+
+    if (size > 0)
+    {
+        buffer[written < size ? written : size - 1] = '\0';
+    }
+
+    return written;
+}
+
+#undef READ_VALUE
@@ -0,0 +1,118 @@
+//! @file
+//! @brief Internal deferred formatting engine
+//! @details A format string is parsed once per call site into a `clog_format_t`, after which each call only copies
+//! its arguments into a compact binary buffer. The buffer is turned into text later, usually on the backend thread.
+//! @note This header is internal to the library and is not part of the public API
+
+#ifndef CLOGGER_DEFERRED_H
+#define CLOGGER_DEFERRED_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CLOGGER_FORMAT_MAX_SPECS
+/// @brief Maximum number of conversions in a format string that can be deferred
+#define CLOGGER_FORMAT_MAX_SPECS 16
+#endif
+
+/// @brief Maximum length of a single conversion specification, e.g. `%-08.3lf`
+#define CLOGGER_FORMAT_SPEC_SIZE 24
+
+/// @brief Type of the argument consumed by a conversion
+typedef enum clog_arg_type
+{
+    CLOG_ARG_INT, ///< `int`, also used for `char` and `short` as they are promoted
+    CLOG_ARG_LONG, ///< `long`
+    CLOG_ARG_LONG_LONG, ///< `long long`
+    CLOG_ARG_INTMAX, ///< `intmax_t`
+    CLOG_ARG_SIZE, ///< `size_t`
+    CLOG_ARG_PTRDIFF, ///< `ptrdiff_t`
+    CLOG_ARG_DOUBLE, ///< `double`, also used for `float` as it is promoted
+    CLOG_ARG_LONG_DOUBLE, ///< `long double`
+    CLOG_ARG_POINTER, ///< `void*`
+    CLOG_ARG_STRING ///< `const char*`, the characters themselves are copied
+} clog_arg_type_t;
+
+/// @brief A single conversion within a format string
+typedef struct clog_format_spec
+{
+    unsigned short literal_offset; ///< Offset of the literal text preceding the conversion
+    unsigned short literal_length; ///< Length of the literal text preceding the conversion
+    unsigned char type; ///< The `clog_arg_type_t` of the argument
+    unsigned char star_count; ///< Number of `*` width/precision arguments preceding the value
+    int precision; ///< Literal precision, or `-1` if there is none or it is given by `*`
+    char conversion[CLOGGER_FORMAT_SPEC_SIZE]; ///< The conversion specification, null terminated
+} clog_format_spec_t;
+
+/// @brief A parsed format string
+typedef struct clog_format
+{
+    const char* format; ///< The format string, a copy owned by the cache for formats from `clog_format_lookup()`
+    unsigned short spec_count; ///< Number of conversions
+    unsigned short tail_offset; ///< Offset of the literal text after the last conversion
+    unsigned short tail_length; ///< Length of the literal text after the last conversion
+    clog_format_spec_t specs[CLOGGER_FORMAT_MAX_SPECS]; ///< The conversions
+} clog_format_t;
+
+/// @brief Parse a format string without caching it
+/// @note Messages go through `clog_format_lookup()` instead, this is for formats read back from a binary log file
+/// @param format [in] The format string, which must outlive `parsed`
+/// @param parsed [out] The parsed format
+/// @return `CLOGGER_FALSE` if the format can't be deferred, otherwise `CLOGGER_TRUE`
+int clog_format_parse(const char* format, clog_format_t* parsed);
+
+/// @brief Look up the parsed form of a format string, parsing and caching it on first use
+/// @details The cache is keyed on the address of the format and keeps a copy of its text. A hit is checked against
+/// that copy, so a buffer reused for a different format is formatted eagerly rather than with a stale parse.
+/// @param format [in] The format string
+/// @return The parsed format, whose `format` is the cached copy, or `NULL` if the format can't be deferred (e.g. it
+/// uses `%n` or wide strings) or doesn't match the format cached at its address
+const clog_format_t* clog_format_lookup(const char* format);
+
+/// @brief Copy the arguments of a call into a binary buffer
+/// @param format [in] The parsed format
+/// @param buffer [out] Buffer to receive the arguments
+/// @param size [in] Size of `buffer`
+/// @param args [in] Variable arguments list matching the format
+/// @return Number of bytes written, or `0` if the arguments don't fit in `buffer`
+size_t clog_format_capture(const clog_format_t* format, unsigned char* buffer, size_t size, va_list args);
+
+/// @brief Check that a buffer holds exactly the arguments `clog_format_capture()` would have captured for a format
+/// @details `clog_format_render()` trusts its input, check arguments read back from a file with this first
+/// @param format [in] The parsed format
+/// @param data [in] The captured arguments
+/// @param length [in] Number of bytes in `data`
+/// @return `CLOGGER_FALSE` if they don't match the format, otherwise `CLOGGER_TRUE`
+int clog_format_validate(const clog_format_t* format, const unsigned char* data, size_t length);
+
+/// @brief Format captured arguments into text, as `vsnprintf()` would have
+/// @param format [in] The parsed format
+/// @param data [in] Arguments captured by `clog_format_capture()`
+/// @param length [in] Number of bytes in `data`
+/// @param buffer [out] Buffer to receive the text, always null terminated
+/// @param size [in] Size of `buffer`
+/// @return Length of the full text excluding the null terminator, like `snprintf()` it may exceed `size`
+size_t clog_format_render(const clog_format_t* format, const unsigned char* data, size_t length, char* buffer,
+                          size_t size);
+
+/// @brief Format captured arguments into text without `snprintf()`, so it can run in a signal handler
+/// @details Integers, characters, strings and pointers are printed in the base of their conversion, ignoring flags,
+/// width and precision. Floating point values are shown as their conversion specification.
+/// @param format [in] The parsed format
+/// @param data [in] Arguments captured by `clog_format_capture()`
+/// @param length [in] Number of bytes in `data`
+/// @param buffer [out] Buffer to receive the text, always null terminated
+/// @param size [in] Size of `buffer`
+/// @return Length of the full text excluding the null terminator, it may exceed `size`
+size_t clog_format_render_safe(const clog_format_t* format, const unsigned char* data, size_t length, char* buffer,
+                               size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_DEFERRED_H
@@ -0,0 +1,189 @@
+#include "error_dispatch.h"
+#include "timestamp.h"
+#include "clogger_pch.h"
+
+// An event waiting for its callback
+typedef struct clog_error_entry
+{
+    clog_error_callback_async_t callback;
+    clog_error_event_t event;
+} clog_error_entry_t;
+
+typedef struct clog_error_dispatcher
+{
+    clog_error_entry_t* pending;
+    size_t length;
+    size_t capacity;
+    int started;
+    int busy;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+} clog_error_dispatcher_t;
+
+static clog_error_dispatcher_t dispatcher = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .wake = PTHREAD_COND_INITIALIZER,
+        .idle = PTHREAD_COND_INITIALIZER
+};
+
+static int same_string(const char* a, const char* b)
+{
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+// Hand every callback its share of the batch, in the order the events were queued
+static void deliver(clog_error_entry_t* entries, size_t count, clog_error_event_t* events)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        clog_error_callback_async_t callback = entries[i].callback;
+        size_t event_count = 0;
+
+        if (callback == NULL)
+        {
+            continue;
+        }
+
+        for (size_t j = i; j < count; j++)
+        {
+            if (entries[j].callback == callback)
+            {
+                events[event_count++] = entries[j].event;
+                entries[j].callback = NULL;
+            }
+        }
+
+        callback(events, event_count);
+    }
+}
+
+static void* dispatcher_thread(void* args)
+{
+    (void) args;
+
+    clog_error_entry_t* batch = NULL;
+    size_t batch_capacity = 0;
+    clog_error_event_t* events = NULL;
+    size_t events_capacity = 0;
+
+    pthread_mutex_lock(&dispatcher.mutex);
+
+    for (;;)
+    {
+        while (dispatcher.length == 0)
+        {
+            dispatcher.busy = CLOGGER_FALSE;
+            pthread_cond_broadcast(&dispatcher.idle);
+            pthread_cond_wait(&dispatcher.wake, &dispatcher.mutex);
+        }
+
+        // Swap the pending list out, so new events coalesce into a fresh one while the callbacks run
+        clog_error_entry_t* entries = dispatcher.pending;
+        size_t count = dispatcher.length;
+        size_t capacity = dispatcher.capacity;
+
+        dispatcher.pending = batch;
+        dispatcher.capacity = batch_capacity;
+        dispatcher.length = 0;
+        dispatcher.busy = CLOGGER_TRUE;
+
+        batch = entries;
+        batch_capacity = capacity;
+
+        pthread_mutex_unlock(&dispatcher.mutex);
+
+        if (events_capacity < count)
+        {
+            free(events);
+            events = malloc(count * sizeof(clog_error_event_t));
+            events_capacity = events != NULL ? count : 0;
+        }
+
+        if (events != NULL)
+        {
+            deliver(batch, count, events);
+        }
+
+        pthread_mutex_lock(&dispatcher.mutex);
+    }
+
+    return NULL;
+}
+
+void clog_error_dispatch(clog_error_callback_async_t callback, clog_level_t level, const char* clogger_name,
+                         const char* location)
+{
+    clog_error_event_t event = {level, clogger_name, location, {0, 0}, 1};
+
+    clog_timestamp_now(&event.timestamp);
+
+    pthread_mutex_lock(&dispatcher.mutex);
+
+    if (!dispatcher.started)
+    {
+        if (pthread_create(&dispatcher.thread, NULL, dispatcher_thread, NULL) == 0)
+        {
+            pthread_detach(dispatcher.thread);
+            atexit(clog_error_dispatch_flush);
+            dispatcher.started = CLOGGER_TRUE;
+        }
+        else
+        {
+            pthread_mutex_unlock(&dispatcher.mutex);
+            callback(&event, 1);
+            return;
+        }
+    }
+
+    // Still waiting for the callback, count it into the pending event instead
+    for (size_t i = 0; i < dispatcher.length; i++)
+    {
+        clog_error_entry_t* entry = &dispatcher.pending[i];
+
+        if (entry->callback == callback && entry->event.level == level
+            && same_string(entry->event.location, location) && same_string(entry->event.clogger_name, clogger_name))
+        {
+            entry->event.count++;
+            pthread_mutex_unlock(&dispatcher.mutex);
+            return;
+        }
+    }
+
+    if (dispatcher.length == dispatcher.capacity)
+    {
+        size_t capacity = dispatcher.capacity > 0 ? dispatcher.capacity * 2 : 16;
+        clog_error_entry_t* pending = realloc(dispatcher.pending, capacity * sizeof(clog_error_entry_t));
+
+        if (pending == NULL)
+        {
+            pthread_mutex_unlock(&dispatcher.mutex);
+            return;
+        }
+
+        dispatcher.pending = pending;
+        dispatcher.capacity = capacity;
+    }
+
+    dispatcher.pending[dispatcher.length++] = (clog_error_entry_t) {callback, event};
+
+    pthread_cond_signal(&dispatcher.wake);
+    pthread_mutex_unlock(&dispatcher.mutex);
+}
+
+void clog_error_dispatch_flush()
+{
+    pthread_mutex_lock(&dispatcher.mutex);
+
+    // A callback waiting on itself would never return
+    if (dispatcher.started && !pthread_equal(pthread_self(), dispatcher.thread))
+    {
+        while (dispatcher.length > 0 || dispatcher.busy)
+        {
+            pthread_cond_wait(&dispatcher.idle, &dispatcher.mutex);
+        }
+    }
+
+    pthread_mutex_unlock(&dispatcher.mutex);
+}
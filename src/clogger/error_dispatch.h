@@ -0,0 +1,54 @@
+//! @file
+//! @brief Asynchronous, batched delivery of `clogger_t` error callbacks
+
+#ifndef CLOGGER_ERROR_DISPATCH_H
+#define CLOGGER_ERROR_DISPATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <time.h>
+
+#include "core.h"
+
+/// @brief An `ERROR` or `CRITICAL` message, as handed to a `clogger_t`'s `error_callback_async`
+/// @details Messages with the same level, `clogger_t` name and location that fire while the callback is still busy are
+/// coalesced into a single event
+typedef struct clog_error_event
+{
+    clog_level_t level; ///< `CLOG_LEVEL_ERROR` or `CLOG_LEVEL_CRITICAL`
+    const char* clogger_name; ///< Name of the `clogger_t` the message was logged with
+    const char* location; ///< Location of the log
+    struct timespec timestamp; ///< Time of the first message coalesced into the event
+    unsigned int count; ///< Number of messages coalesced into the event
+} clog_error_event_t;
+
+/// @brief Asynchronous error callback, called on the dispatcher thread with a batch of events
+/// @param events [in] The events, only valid during the call
+/// @param count [in] Number of events
+typedef void (* clog_error_callback_async_t)(const clog_error_event_t* events, size_t count);
+
+/// @brief Queue an event for an asynchronous error callback
+/// @details The dispatcher thread is started on the first call. If it can't be started the callback is called right
+/// away instead
+/// @note This function isn't typically used by the end user, `clogger_error()` and `clogger_critical()` and their
+/// `_async` variants call it for a `clogger_t` with an `error_callback_async`
+/// @warning `clogger_name` and `location` must outlive the call, as with the `_async` functions
+/// @param callback [in] The callback to deliver the event to
+/// @param level [in] The log level
+/// @param clogger_name [in] Name of the `clogger_t`
+/// @param location [in] Location of the log
+void clog_error_dispatch(clog_error_callback_async_t callback, clog_level_t level, const char* clogger_name,
+                         const char* location);
+
+/// @brief Wait until every queued error event has been delivered
+/// @note Also done by `clog_flush()` and on `exit()`. Returns at once when called from an error callback
+void clog_error_dispatch_flush();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_ERROR_DISPATCH_H
@@ -0,0 +1,735 @@
+#include "file_sink.h"
+#include "core.h"
+#include "clog.h"
+#include "fileio.h"
+#include "dedup.h"
+#include "binary_sink.h"
+#include "clogger_pch.h"
+
+#include <errno.h>
+
+#ifdef CLOGGER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define CLOGGER_SINK_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define CLOGGER_SINK_CLOCK CLOCK_MONOTONIC
+#endif
+
+#define CLOGGER_NEXT_SUFFIX ".next"
+
+struct clog_file_sink
+{
+    int fd;
+    char* path;
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    long long flush_interval_ns;
+    long long last_flush_ns;
+    pthread_mutex_t mutex;
+    clog_file_sink_t* next;
+
+    // Rotation, guarded by `mutex`
+    int rotating;
+    clog_rotation_config_t rotation;
+    unsigned long long segment_bytes;
+    long long segment_opened_ns;
+    int next_fd;
+    int preparing;
+
+    // Guarded by `rotation_mutex`
+    int pending_jobs;
+};
+
+// Work handed to the rotation thread, so the logging thread only ever swaps file descriptors
+typedef enum clog_rotation_job_type
+{
+    CLOG_ROTATION_PREPARE, // Open the file the sink will swap to
+    CLOG_ROTATION_RETIRE // Close the old file, shift the segments and compress
+} clog_rotation_job_type_t;
+
+typedef struct clog_rotation_job
+{
+    clog_rotation_job_type_t type;
+    clog_file_sink_t* sink;
+    int fd;
+    struct clog_rotation_job* next;
+} clog_rotation_job_t;
+
+static clog_file_sink_t* open_sinks = NULL;
+static pthread_mutex_t open_sinks_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Shortest flush interval of any sink opened so far, how often the worker wakes to flush when it has no job
+static long long timer_interval_ns = 0;
+
+static clog_rotation_job_t* rotation_head = NULL;
+static clog_rotation_job_t* rotation_tail = NULL;
+static int rotation_busy = CLOGGER_FALSE;
+static int rotation_started = CLOGGER_FALSE;
+static pthread_t rotation_thread;
+static pthread_mutex_t rotation_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rotation_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t rotation_idle = PTHREAD_COND_INITIALIZER;
+
+static long long now_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOGGER_SINK_CLOCK, &now);
+
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+int clog_write_all(int fd, const void* data, size_t length)
+{
+    const char* bytes = data;
+
+    while (length > 0)
+    {
+        ssize_t written = write(fd, bytes, length);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return CLOGGER_FALSE;
+        }
+
+        bytes += written;
+        length -= (size_t) written;
+    }
+
+    return CLOGGER_TRUE;
+}
+
+// `<path><suffix>`, or `<path>.<number><suffix>` when `number` isn't 0
+static char* segment_path(const char* path, unsigned int number, const char* suffix)
+{
+    size_t size = strlen(path) + strlen(suffix) + 16;
+    char* result = malloc(size);
+
+    if (result != NULL)
+    {
+        if (number > 0)
+        {
+            snprintf(result, size, "%s.%u%s", path, number, suffix);
+        }
+        else
+        {
+            snprintf(result, size, "%s%s", path, suffix);
+        }
+    }
+
+    return result;
+}
+
+// Returns `CLOGGER_FALSE` if the job couldn't be queued
+static int submit_rotation_job(clog_rotation_job_type_t type, clog_file_sink_t* sink, int fd)
+{
+    clog_rotation_job_t* job = malloc(sizeof(clog_rotation_job_t));
+
+    if (job == NULL)
+    {
+        if (type == CLOG_ROTATION_RETIRE)
+        {
+            close(fd);
+        }
+
+        return CLOGGER_FALSE;
+    }
+
+    *job = (clog_rotation_job_t) {type, sink, fd, NULL};
+
+    pthread_mutex_lock(&rotation_mutex);
+
+    if (rotation_tail != NULL)
+    {
+        rotation_tail->next = job;
+    }
+    else
+    {
+        rotation_head = job;
+    }
+
+    rotation_tail = job;
+    sink->pending_jobs++;
+
+    pthread_cond_signal(&rotation_wake);
+    pthread_mutex_unlock(&rotation_mutex);
+
+    return CLOGGER_TRUE;
+}
+
+#ifdef CLOGGER_HAVE_ZLIB
+static void compress_segment(const char* path)
+{
+    char buffer[65536];
+    char* compressed_path = segment_path(path, 0, ".gz");
+    FILE* input = fopen(path, "rb");
+    gzFile output = compressed_path != NULL ? gzopen(compressed_path, "wb") : NULL;
+    int result = input != NULL && output != NULL;
+
+    while (result)
+    {
+        size_t count = fread(buffer, 1, sizeof buffer, input);
+
+        if (count == 0)
+        {
+            result = !ferror(input);
+            break;
+        }
+
+        result = gzwrite(output, buffer, (unsigned int) count) == (int) count;
+    }
+
+    if (input != NULL)
+    {
+        fclose(input);
+    }
+
+    if (output != NULL)
+    {
+        result = gzclose(output) == Z_OK && result;
+    }
+
+    // Keep whichever copy is complete
+    if (result)
+    {
+        remove(path);
+    }
+    else if (compressed_path != NULL)
+    {
+        remove(compressed_path);
+    }
+
+    free(compressed_path);
+}
+#endif
+
+// Rename segment `from` to `to`, whether or not it was compressed
+static void shift_segment(const char* path, unsigned int from, unsigned int to)
+{
+    const char* suffixes[] = {"", ".gz"};
+
+    for (size_t i = 0; i < sizeof suffixes / sizeof suffixes[0]; i++)
+    {
+        char* source = segment_path(path, from, suffixes[i]);
+        char* destination = segment_path(path, to, suffixes[i]);
+
+        if (source != NULL && destination != NULL)
+        {
+            if (to == 0)
+            {
+                remove(source);
+            }
+            else
+            {
+                rename(source, destination);
+            }
+        }
+
+        free(source);
+        free(destination);
+    }
+}
+
+static void retire_segment(clog_file_sink_t* sink, int fd)
+{
+    clog_rotation_config_t rotation;
+
+    pthread_mutex_lock(&sink->mutex);
+    rotation = sink->rotation;
+    pthread_mutex_unlock(&sink->mutex);
+
+    close(fd);
+
+    char* next_path = segment_path(sink->path, 0, CLOGGER_NEXT_SUFFIX);
+
+    if (next_path == NULL)
+    {
+        return;
+    }
+
+    if (rotation.retention > 0)
+    {
+        char* first_path = segment_path(sink->path, 1, "");
+
+        // Drop the oldest segment and shift the rest up by one
+        shift_segment(sink->path, rotation.retention, 0);
+
+        for (unsigned int i = rotation.retention - 1; i >= 1; i--)
+        {
+            shift_segment(sink->path, i, i + 1);
+        }
+
+        if (first_path != NULL)
+        {
+            rename(sink->path, first_path);
+        }
+
+        rename(next_path, sink->path);
+
+#ifdef CLOGGER_HAVE_ZLIB
+        if (rotation.compress && first_path != NULL)
+        {
+            compress_segment(first_path);
+        }
+#endif
+
+        free(first_path);
+    }
+    else
+    {
+        rename(next_path, sink->path);
+    }
+
+    free(next_path);
+}
+
+static void prepare_segment(clog_file_sink_t* sink)
+{
+    char* next_path = segment_path(sink->path, 0, CLOGGER_NEXT_SUFFIX);
+    int fd = next_path != NULL ? open(next_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644) : -1;
+
+    if (fd < 0 && next_path != NULL)
+    {
+        perror(next_path);
+    }
+
+    pthread_mutex_lock(&sink->mutex);
+    sink->next_fd = fd;
+    sink->preparing = CLOGGER_FALSE;
+    pthread_mutex_unlock(&sink->mutex);
+
+    free(next_path);
+}
+
+// Rotates files and, between jobs, flushes the sinks whose flush interval has elapsed
+static void* rotation_worker(void* args)
+{
+    (void) args;
+
+    pthread_mutex_lock(&rotation_mutex);
+
+    for (;;)
+    {
+        while (rotation_head == NULL)
+        {
+            rotation_busy = CLOGGER_FALSE;
+            pthread_cond_broadcast(&rotation_idle);
+
+            if (timer_interval_ns == 0)
+            {
+                pthread_cond_wait(&rotation_wake, &rotation_mutex);
+                continue;
+            }
+
+            struct timespec deadline;
+
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += (time_t) (timer_interval_ns / 1000000000LL);
+            deadline.tv_nsec += (long) (timer_interval_ns % 1000000000LL);
+
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+
+            if (pthread_cond_timedwait(&rotation_wake, &rotation_mutex, &deadline) == ETIMEDOUT)
+            {
+                // Flushing may queue a rotation job, which takes this lock
+                pthread_mutex_unlock(&rotation_mutex);
+                clog_file_sink_flush_expired();
+                clog_binary_sink_flush_expired();
+                pthread_mutex_lock(&rotation_mutex);
+            }
+        }
+
+        clog_rotation_job_t* job = rotation_head;
+
+        rotation_head = job->next;
+
+        if (rotation_head == NULL)
+        {
+            rotation_tail = NULL;
+        }
+
+        rotation_busy = CLOGGER_TRUE;
+        pthread_mutex_unlock(&rotation_mutex);
+
+        if (job->type == CLOG_ROTATION_PREPARE)
+        {
+            prepare_segment(job->sink);
+        }
+        else
+        {
+            retire_segment(job->sink, job->fd);
+        }
+
+        pthread_mutex_lock(&rotation_mutex);
+        job->sink->pending_jobs--;
+        pthread_cond_broadcast(&rotation_idle);
+        free(job);
+    }
+
+    return NULL;
+}
+
+// Wait until the rotation thread has nothing left to do, for everyone or just `sink`
+static void wait_for_rotation(clog_file_sink_t* sink)
+{
+    pthread_mutex_lock(&rotation_mutex);
+
+    while (sink != NULL ? sink->pending_jobs > 0 : rotation_head != NULL || rotation_busy)
+    {
+        pthread_cond_wait(&rotation_idle, &rotation_mutex);
+    }
+
+    pthread_mutex_unlock(&rotation_mutex);
+}
+
+void clog_file_sink_finish_rotations()
+{
+    wait_for_rotation(NULL);
+}
+
+// Caller holds `rotation_mutex`
+static int start_rotation_worker()
+{
+    if (rotation_started)
+    {
+        return CLOGGER_TRUE;
+    }
+
+    if (pthread_create(&rotation_thread, NULL, rotation_worker, NULL) != 0)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    pthread_detach(rotation_thread);
+    clog_register_exit_flush();
+    rotation_started = CLOGGER_TRUE;
+
+    return CLOGGER_TRUE;
+}
+
+void clog_sink_flush_timer(long long interval_ns)
+{
+    if (interval_ns <= 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&rotation_mutex);
+
+    if (start_rotation_worker() && (timer_interval_ns == 0 || interval_ns < timer_interval_ns))
+    {
+        timer_interval_ns = interval_ns;
+        pthread_cond_signal(&rotation_wake);
+    }
+
+    pthread_mutex_unlock(&rotation_mutex);
+}
+
+// Caller holds the sink's mutex. Swapping file descriptors is the only part of a rotation done here
+static void rotate_if_due(clog_file_sink_t* sink, long long now)
+{
+    int due = sink->rotating
+              && ((sink->rotation.max_bytes > 0 && sink->segment_bytes >= sink->rotation.max_bytes)
+                  || (sink->rotation.interval_s > 0
+                      && now - sink->segment_opened_ns >= (long long) sink->rotation.interval_s * 1000000000LL));
+
+    if (!due)
+    {
+        return;
+    }
+
+    if (sink->next_fd >= 0)
+    {
+        int old_fd = sink->fd;
+
+        sink->fd = sink->next_fd;
+        sink->next_fd = -1;
+        sink->segment_bytes = 0;
+        sink->segment_opened_ns = now;
+
+        submit_rotation_job(CLOG_ROTATION_RETIRE, sink, old_fd);
+
+        // Have the file after this one ready before it's due. Set after queueing is fine, the worker clears the flag
+        // under the sink's mutex, held here. A job that couldn't be queued leaves it clear, to be retried.
+        sink->preparing = submit_rotation_job(CLOG_ROTATION_PREPARE, sink, -1);
+    }
+    else if (!sink->preparing)
+    {
+        // Keep writing to the current file until the next one is ready
+        sink->preparing = submit_rotation_job(CLOG_ROTATION_PREPARE, sink, -1);
+    }
+}
+
+// Caller holds the sink's mutex
+static int write_locked(clog_file_sink_t* sink, const char* data, size_t length)
+{
+    int result = clog_write_all(sink->fd, data, length);
+
+    sink->segment_bytes += length;
+
+    return result;
+}
+
+// Caller holds the sink's mutex
+static int flush_locked(clog_file_sink_t* sink)
+{
+    int result = write_locked(sink, sink->buffer, sink->length);
+
+    sink->length = 0;
+    sink->last_flush_ns = now_ns();
+
+    rotate_if_due(sink, sink->last_flush_ns);
+
+    return result;
+}
+
+clog_file_sink_t* clog_file_sink_open(const char* file_path, size_t buffer_size, unsigned int flush_interval_ms)
+{
+    clog_file_sink_t* sink = calloc(1, sizeof(clog_file_sink_t));
+
+    if (sink == NULL)
+    {
+        return NULL;
+    }
+
+    sink->fd = open(file_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if (sink->fd < 0)
+    {
+        perror(file_path);
+        clog_error(__FUNCTION__, "Could not open file %s", file_path);
+
+        free(sink);
+        return NULL;
+    }
+
+    sink->path = segment_path(file_path, 0, "");
+    sink->buffer = buffer_size > 0 ? malloc(buffer_size) : NULL;
+
+    if (sink->path == NULL || (buffer_size > 0 && sink->buffer == NULL))
+    {
+        close(sink->fd);
+        free(sink->path);
+        free(sink->buffer);
+        free(sink);
+        return NULL;
+    }
+
+    off_t size = lseek(sink->fd, 0, SEEK_END);
+
+    sink->capacity = buffer_size;
+    sink->flush_interval_ns = (long long) flush_interval_ms * 1000000LL;
+    sink->last_flush_ns = now_ns();
+    sink->segment_bytes = size > 0 ? (unsigned long long) size : 0;
+    sink->segment_opened_ns = sink->last_flush_ns;
+    sink->next_fd = -1;
+    pthread_mutex_init(&sink->mutex, NULL);
+
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    clog_register_exit_flush();
+
+    sink->next = open_sinks;
+    open_sinks = sink;
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+
+    clog_sink_flush_timer(sink->flush_interval_ns);
+
+    return sink;
+}
+
+// Caller holds the sink's mutex
+static int flush_is_due(const clog_file_sink_t* sink, long long now)
+{
+    return (sink->flush_interval_ns > 0 && now - sink->last_flush_ns >= sink->flush_interval_ns)
+           || (sink->rotating && sink->rotation.interval_s > 0
+               && now - sink->segment_opened_ns >= (long long) sink->rotation.interval_s * 1000000000LL);
+}
+
+int clog_file_sink_set_rotation(clog_file_sink_t* sink, const clog_rotation_config_t* config)
+{
+    pthread_mutex_lock(&rotation_mutex);
+
+    if (config != NULL && !start_rotation_worker())
+    {
+        pthread_mutex_unlock(&rotation_mutex);
+        return CLOGGER_FALSE;
+    }
+
+    pthread_mutex_unlock(&rotation_mutex);
+
+    if (config != NULL)
+    {
+        // Rotating by age needs the timer as much as a flush interval does
+        clog_sink_flush_timer((long long) config->interval_s * 1000000000LL);
+    }
+
+    pthread_mutex_lock(&sink->mutex);
+
+    sink->rotating = config != NULL;
+
+    if (config != NULL)
+    {
+        sink->rotation = *config;
+
+        if (sink->next_fd < 0 && !sink->preparing)
+        {
+            sink->preparing = submit_rotation_job(CLOG_ROTATION_PREPARE, sink, -1);
+        }
+    }
+
+    pthread_mutex_unlock(&sink->mutex);
+
+    return CLOGGER_TRUE;
+}
+
+int clog_file_sink_write(clog_file_sink_t* sink, const char* data, size_t length)
+{
+    int result = CLOGGER_TRUE;
+
+    pthread_mutex_lock(&sink->mutex);
+
+    if (sink->length + length > sink->capacity)
+    {
+        result = flush_locked(sink);
+    }
+
+    if (length > sink->capacity)
+    {
+        // Too big to buffer, write it straight through
+        result = write_locked(sink, data, length) && result;
+        rotate_if_due(sink, now_ns());
+    }
+    else
+    {
+        memcpy(sink->buffer + sink->length, data, length);
+        sink->length += length;
+
+        if ((sink->flush_interval_ns > 0 || (sink->rotating && sink->rotation.interval_s > 0))
+            && flush_is_due(sink, now_ns()))
+        {
+            result = flush_locked(sink) && result;
+        }
+    }
+
+    pthread_mutex_unlock(&sink->mutex);
+
+    return result;
+}
+
+int clog_file_sink_flush(clog_file_sink_t* sink)
+{
+    pthread_mutex_lock(&sink->mutex);
+    int result = flush_locked(sink);
+    pthread_mutex_unlock(&sink->mutex);
+
+    return result;
+}
+
+void clog_file_sink_close(clog_file_sink_t* sink)
+{
+    clog_dedup_target_t target = {CLOG_DEDUP_FILE_SINK, sink};
+
+    // Its last run is reported while it can still be written
+    clog_dedup_forget(&target);
+
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    for (clog_file_sink_t** link = &open_sinks; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == sink)
+        {
+            *link = sink->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+
+    clog_file_sink_flush(sink);
+    wait_for_rotation(sink);
+
+    close(sink->fd);
+
+    if (sink->next_fd >= 0)
+    {
+        char* next_path = segment_path(sink->path, 0, CLOGGER_NEXT_SUFFIX);
+
+        // Prepared but never swapped to, so it's empty
+        close(sink->next_fd);
+
+        if (next_path != NULL)
+        {
+            remove(next_path);
+        }
+
+        free(next_path);
+    }
+
+    pthread_mutex_destroy(&sink->mutex);
+    free(sink->path);
+    free(sink->buffer);
+    free(sink);
+}
+
+void clog_file_sink_flush_all()
+{
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    for (clog_file_sink_t* sink = open_sinks; sink != NULL; sink = sink->next)
+    {
+        clog_file_sink_flush(sink);
+    }
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+}
+
+void clog_file_sink_flush_expired()
+{
+    long long now = now_ns();
+
+    pthread_mutex_lock(&open_sinks_mutex);
+
+    for (clog_file_sink_t* sink = open_sinks; sink != NULL; sink = sink->next)
+    {
+        pthread_mutex_lock(&sink->mutex);
+
+        if (flush_is_due(sink, now))
+        {
+            flush_locked(sink);
+        }
+
+        pthread_mutex_unlock(&sink->mutex);
+    }
+
+    pthread_mutex_unlock(&open_sinks_mutex);
+}
+
+int clog_file_sink_write_safe(clog_file_sink_t* sink, const char* data, size_t length)
+{
+    return clog_write_all(sink->fd, data, length);
+}
+
+void clog_file_sink_drain_safe()
+{
+    // The lists and buffers may be mid-update on another thread, a torn line beats losing the lot
+    for (clog_file_sink_t* sink = open_sinks; sink != NULL; sink = sink->next)
+    {
+        clog_write_all(sink->fd, sink->buffer, sink->length);
+        sink->length = 0;
+    }
+}
@@ -0,0 +1,79 @@
+//! @file
+//! @brief Persistent, buffered log file output
+
+#ifndef CLOGGER_FILE_SINK_H
+#define CLOGGER_FILE_SINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/// @brief Default size of a file sink's write buffer
+#define CLOGGER_FILE_SINK_DEFAULT_BUFFER_SIZE 65536
+
+/// @brief A log file kept open for the lifetime of the sink, with its own write buffer
+/// @details Writes are collected in the buffer and reach the file when the buffer fills, when the flush interval has
+/// elapsed, on `clog_file_sink_flush()`/`clog_flush()`, or when the sink is closed. Every open sink is also flushed on
+/// `exit()`, after the async backend has written everything queued. The interval is kept by a background thread,
+/// started with the first sink that has one, so buffered lines reach the disk on time even when nothing else is logged.
+/// Attach a sink to a `clogger_t` through its `file_sink` member to log to it.
+typedef struct clog_file_sink clog_file_sink_t;
+
+/// @brief Configuration for rotating the file of a `clog_file_sink_t`
+/// @details When either threshold is reached the sink swaps to a fresh file, which is the only work done on the logging
+/// thread. A background thread then renames the old file to `<file>.1` (shifting older segments to `<file>.2` and so
+/// on), deletes segments beyond the retention count and, if asked to, compresses the segment to `<file>.1.gz`.
+typedef struct clog_rotation_config
+{
+    size_t max_bytes; ///< Rotate once the file holds this many bytes, `0` for no size limit
+    unsigned int interval_s; ///< Rotate once the file is this many seconds old, `0` for no time limit
+    unsigned int retention; ///< Number of rotated segments to keep
+    int compress; ///< `CLOGGER_TRUE` to gzip rotated segments, ignored if the library was built without zlib
+} clog_rotation_config_t;
+
+/// @brief Open a file sink, appending to the file
+/// @param file_path [in] The file path to log to, e.g. `/logs/log.txt`
+/// @param buffer_size [in] Size of the write buffer in bytes, `0` to write through on every message
+/// @param flush_interval_ms [in] Longest time in milliseconds a message may sit in the buffer, `0` to only flush when
+/// the buffer fills or when asked to
+/// @return Pointer to the sink, or `NULL` on failure
+clog_file_sink_t* clog_file_sink_open(const char* file_path, size_t buffer_size, unsigned int flush_interval_ms);
+
+/// @brief Rotate the file of a file sink by size and/or age
+/// @param sink [in] Pointer to the sink
+/// @param config [in] Pointer to the rotation configuration, `NULL` to stop rotating
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_file_sink_set_rotation(clog_file_sink_t* sink, const clog_rotation_config_t* config);
+
+/// @brief Write raw text to a file sink
+/// @param sink [in] Pointer to the sink
+/// @param data [in] Text to write
+/// @param length [in] Number of characters to write
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_file_sink_write(clog_file_sink_t* sink, const char* data, size_t length);
+
+/// @brief Write everything buffered in a file sink to its file
+/// @param sink [in] Pointer to the sink
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_file_sink_flush(clog_file_sink_t* sink);
+
+/// @brief Flush and close a file sink
+/// @warning Detach the sink from every `clogger_t` first
+/// @param sink [in] Pointer to the sink
+void clog_file_sink_close(clog_file_sink_t* sink);
+
+/// @brief Flush every open file sink
+void clog_file_sink_flush_all();
+
+/// @brief Flush every open file sink whose flush interval has elapsed
+/// @details The background thread keeping the flush intervals and the idle async backend both call this, there's
+/// rarely a need to call it directly
+void clog_file_sink_flush_expired();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_FILE_SINK_H
@@ -0,0 +1,68 @@
+//! @file
+//! @brief Internal helpers for writing to file descriptors
+//! @note This header is internal to the library and is not part of the public API
+
+#ifndef CLOGGER_FILEIO_H
+#define CLOGGER_FILEIO_H
+
+#include <fcntl.h>
+#include <stddef.h>
+
+#include "file_sink.h"
+
+#ifdef WIN32
+#include <io.h>
+#define open _open
+#define write _write
+#define close _close
+#define lseek _lseek
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief Write a whole buffer to a file descriptor, retrying short and interrupted writes
+/// @param fd [in] The file descriptor
+/// @param data [in] Bytes to write
+/// @param length [in] Number of bytes to write
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_write_all(int fd, const void* data, size_t length);
+
+/// @brief Have the background sink thread flush sinks whose interval has elapsed at least every `interval_ns`
+/// @details The thread is started on first use and also rotates files. It wakes at the shortest interval asked for.
+/// @param interval_ns [in] Flush interval of a sink in nanoseconds, `0` or less for none
+void clog_sink_flush_timer(long long interval_ns);
+
+/// @brief Have everything still queued or buffered written on `exit()`
+/// @details Registers a single exit hook, however often it's called. The hook stops the async backend once it has
+/// written every queued message, then flushes the sinks and waits for pending rotations, in that order. Every part of
+/// the library that holds messages for later calls this, so the order doesn't depend on which of them was used first.
+void clog_register_exit_flush();
+
+/// @brief Wait until every queued rotation job has finished
+void clog_file_sink_finish_rotations();
+
+/// @brief Write raw text straight to the file of a file sink, bypassing its buffer and its lock
+/// @note Async-signal-safe, only meant for when the process is going down
+/// @param sink [in] Pointer to the sink
+/// @param data [in] Text to write
+/// @param length [in] Number of characters to write
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_file_sink_write_safe(clog_file_sink_t* sink, const char* data, size_t length);
+
+/// @brief Write the buffer of every open file sink to its file without taking any lock
+/// @note Async-signal-safe, only meant for when the process is going down
+void clog_file_sink_drain_safe();
+
+/// @brief Write the buffer of every open binary sink to its file without taking any lock
+/// @note Async-signal-safe, only meant for when the process is going down
+void clog_binary_sink_drain_safe();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_FILEIO_H
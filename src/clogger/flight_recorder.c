@@ -0,0 +1,118 @@
+#include "flight_recorder.h"
+#include "record.h"
+#include "clogger_pch.h"
+
+#include <stdatomic.h>
+
+// The calling thread's ring, `position` counts every message recorded since the last dump
+typedef struct clog_flight_ring
+{
+    clog_record_t* records;
+    size_t mask;
+    size_t position;
+} clog_flight_ring_t;
+
+static atomic_int recording = CLOGGER_FALSE;
+static atomic_size_t ring_capacity = CLOGGER_FLIGHT_RECORDER_DEFAULT_CAPACITY;
+
+static _Thread_local clog_flight_ring_t ring;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static void create_ring_key()
+{
+    // Frees the records when the thread exits
+    pthread_key_create(&ring_key, free);
+}
+
+static int resize_ring(size_t capacity)
+{
+    clog_record_t* records = malloc(capacity * sizeof(clog_record_t));
+
+    if (records == NULL)
+    {
+        return CLOGGER_FALSE;
+    }
+
+    pthread_once(&ring_key_once, create_ring_key);
+
+    free(ring.records);
+    ring.records = records;
+    ring.mask = capacity - 1;
+    ring.position = 0;
+
+    pthread_setspecific(ring_key, records);
+
+    return CLOGGER_TRUE;
+}
+
+void clog_flight_recorder_enable(size_t capacity)
+{
+    size_t rounded = 2;
+
+    while (rounded < (capacity > 0 ? capacity : CLOGGER_FLIGHT_RECORDER_DEFAULT_CAPACITY))
+    {
+        rounded <<= 1;
+    }
+
+    atomic_store(&ring_capacity, rounded);
+    atomic_store(&recording, CLOGGER_TRUE);
+}
+
+void clog_flight_recorder_disable()
+{
+    atomic_store(&recording, CLOGGER_FALSE);
+}
+
+int clog_flight_recorder_is_enabled()
+{
+    return atomic_load_explicit(&recording, memory_order_relaxed);
+}
+
+void clog_flight_record(clog_level_t level, clogger_t* logger, const char* location, const char* format,
+                        va_list args)
+{
+    if (!atomic_load_explicit(&recording, memory_order_relaxed))
+    {
+        return;
+    }
+
+    size_t capacity = atomic_load_explicit(&ring_capacity, memory_order_relaxed);
+
+    // A new capacity takes effect on each thread's next message, dropping what it had recorded
+    if (ring.records == NULL || ring.mask + 1 != capacity)
+    {
+        if (!resize_ring(capacity))
+        {
+            return;
+        }
+    }
+
+    clog_record_capture(&ring.records[ring.position & ring.mask], level, logger, location, format, args);
+    ring.position++;
+}
+
+void clog_flight_recorder_dump(int async)
+{
+    if (ring.position == 0)
+    {
+        return;
+    }
+
+    // Only the last `mask + 1` messages survived
+    size_t start = ring.position > ring.mask ? ring.position - ring.mask - 1 : 0;
+
+    for (size_t position = start; position < ring.position; position++)
+    {
+        const clog_record_t* record = &ring.records[position & ring.mask];
+        clog_ticket_t ticket;
+
+        // Alongside the error that set it off, which takes the priority lane
+        if (!async || !clog_async_enqueue_record(record, CLOGGER_TRUE, &ticket))
+        {
+            clog_record_write(record);
+        }
+    }
+
+    ring.position = 0;
+}
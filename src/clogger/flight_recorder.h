@@ -0,0 +1,55 @@
+//! @file
+//! @brief Per-thread ring of filtered out messages, written out when something goes wrong
+
+#ifndef CLOGGER_FLIGHT_RECORDER_H
+#define CLOGGER_FLIGHT_RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+
+#include "core.h"
+
+/// @brief Default number of messages each thread's flight recorder keeps
+#define CLOGGER_FLIGHT_RECORDER_DEFAULT_CAPACITY 256
+
+/// @brief Start recording the messages a `clogger_t` filters out for being below its `log_level`
+/// @details Each thread keeps its last `capacity` filtered messages in a ring of binary records, the arguments are
+/// copied but not formatted. When the thread logs an `ERROR` or `CRITICAL` message, or fails a `clog_assert`, the ring
+/// is written out first, to the console or file sink of each message's `clogger_t`, giving the context that led up to
+/// it. Messages from other threads aren't included.
+/// @note The `clogger_t` of a recorded message must outlive the recorder, as with the `_async` functions
+/// @param capacity [in] Number of messages each thread keeps, rounded up to a power of two, `0` for the default
+void clog_flight_recorder_enable(size_t capacity);
+
+/// @brief Stop recording filtered out messages, what was recorded so far is kept until the next dump
+void clog_flight_recorder_disable();
+
+/// @brief Check whether filtered out messages are being recorded
+/// @return `CLOGGER_TRUE` if the flight recorder is enabled, otherwise `CLOGGER_FALSE`
+int clog_flight_recorder_is_enabled();
+
+/// @brief Write out and clear the calling thread's flight recorder
+/// @param async [in] `CLOGGER_TRUE` to queue the messages in the async backend's priority lane when it's running, so
+/// they stay ahead of the `_async` error that set off the dump
+void clog_flight_recorder_dump(int async);
+
+/// @brief Record a filtered out message, if the flight recorder is enabled
+/// @note This function isn't typically used by the end user, the `clogger_t` functions call it for the messages they
+/// filter out
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure
+/// @param location [in] Location of the log
+/// @param format [in] String detailing the format
+/// @param args [in] Variable arguments list to use with the `format` string
+void clog_flight_record(clog_level_t level, clogger_t* logger, const char* location, const char* format,
+                        va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_FLIGHT_RECORDER_H
@@ -0,0 +1,331 @@
+#include "kv.h"
+#include "line.h"
+#include "timestamp.h"
+#include "file_sink.h"
+#include "error_dispatch.h"
+#include "flight_recorder.h"
+#include "clogger_pch.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+
+#define CLOGGER_KV_SSE2
+#endif
+
+typedef struct clog_kv_span
+{
+    const char* text;
+    size_t length;
+} clog_kv_span_t;
+
+#define CLOGGER_KV_SPAN(text) {text, sizeof text - 1}
+
+static const clog_kv_span_t level_values[] = {
+        [CLOG_LEVEL_MESSAGE] = CLOGGER_KV_SPAN("\"MESSAGE\""),
+        [CLOG_LEVEL_INFO] = CLOGGER_KV_SPAN("\"INFO\""),
+        [CLOG_LEVEL_DEBUG] = CLOGGER_KV_SPAN("\"DEBUG\""),
+        [CLOG_LEVEL_WARNING] = CLOGGER_KV_SPAN("\"WARNING\""),
+        [CLOG_LEVEL_ERROR] = CLOGGER_KV_SPAN("\"ERROR\""),
+        [CLOG_LEVEL_CRITICAL] = CLOGGER_KV_SPAN("\"CRITICAL\""),
+        [CLOG_LEVEL_FATAL_ASSERT] = CLOGGER_KV_SPAN("\"ASSERT FAILED\""),
+        [CLOG_LEVEL_NON_FATAL_ASSERT] = CLOGGER_KV_SPAN("\"ASSERT FAILED\"")
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int needs_escape(unsigned char character)
+{
+    return character < 0x20 || character == '"' || character == '\\';
+}
+
+// Skip ahead to the first character that needs escaping, 16 at a time where there are that many left
+static size_t find_escape(const char* text, size_t position, size_t length)
+{
+#ifdef CLOGGER_KV_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    while (position + 16 <= length)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (text + position));
+
+        // Unsigned `chunk <= 0x1F` is `max(chunk, 0x1F) == 0x1F`
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                       _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        int mask = _mm_movemask_epi8(special);
+
+        if (mask != 0)
+        {
+            return position + (size_t) __builtin_ctz((unsigned int) mask);
+        }
+
+        position += 16;
+    }
+#endif
+
+    while (position < length && !needs_escape((unsigned char) text[position]))
+    {
+        position++;
+    }
+
+    return position;
+}
+
+// Append a string as a quoted JSON string, copying the runs between escapes as they are
+static void append_string(clog_line_t* line, const char* text)
+{
+    size_t length = strlen(text);
+    size_t start = 0;
+
+    // Room for the quotes and the string as is, each escape makes what more it needs
+    char* end = clog_line_reserve(line, length + 2);
+
+    if (end == NULL)
+    {
+        return;
+    }
+
+    *end++ = '"';
+
+    while (start < length)
+    {
+        size_t position = find_escape(text, start, length);
+
+        memcpy(end, text + start, position - start);
+        end += position - start;
+
+        if (position == length)
+        {
+            break;
+        }
+
+        unsigned char character = (unsigned char) text[position];
+        char escape[6] = {'\\', (char) character};
+        size_t escape_length = 2;
+
+        switch (character)
+        {
+            case '"':
+            case '\\':
+                break;
+            case '\n':
+                escape[1] = 'n';
+                break;
+            case '\r':
+                escape[1] = 'r';
+                break;
+            case '\t':
+                escape[1] = 't';
+                break;
+            case '\b':
+                escape[1] = 'b';
+                break;
+            case '\f':
+                escape[1] = 'f';
+                break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex_digits[character >> 4];
+                escape[5] = hex_digits[character & 0xF];
+                escape_length = 6;
+                break;
+        }
+
+        start = position + 1;
+        line->length = (size_t) (end - line->data);
+        end = clog_line_reserve(line, escape_length + (length - start) + 1);
+
+        if (end == NULL)
+        {
+            return;
+        }
+
+        memcpy(end, escape, escape_length);
+        end += escape_length;
+    }
+
+    *end++ = '"';
+    line->length = (size_t) (end - line->data);
+}
+
+static void append_unsigned(clog_line_t* line, unsigned long long value, int negative)
+{
+    char digits[21];
+    size_t position = sizeof digits;
+
+    do
+    {
+        digits[--position] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    if (negative)
+    {
+        digits[--position] = '-';
+    }
+
+    clog_line_append(line, digits + position, sizeof digits - position);
+}
+
+static void append_value(clog_line_t* line, const clog_kv_t* field)
+{
+    switch (field->type)
+    {
+        case CLOG_KV_TYPE_INT:
+            // Negated as unsigned, so the most negative value doesn't overflow
+            if (field->value.int_value < 0)
+            {
+                append_unsigned(line, 0ULL - (unsigned long long) field->value.int_value, CLOGGER_TRUE);
+            }
+            else
+            {
+                append_unsigned(line, (unsigned long long) field->value.int_value, CLOGGER_FALSE);
+            }
+            break;
+        case CLOG_KV_TYPE_UINT:
+            append_unsigned(line, field->value.uint_value, CLOGGER_FALSE);
+            break;
+        case CLOG_KV_TYPE_DOUBLE:
+        {
+            char number[32];
+            double value = field->value.double_value;
+            int length = isfinite(value) ? snprintf(number, sizeof number, "%.15g", value) : -1;
+
+            // Only as many digits as it takes to read back the same value
+            if (length > 0 && strtod(number, NULL) != value)
+            {
+                length = snprintf(number, sizeof number, "%.17g", value);
+            }
+
+            if (length > 0 && (size_t) length < sizeof number)
+            {
+                clog_line_append(line, number, (size_t) length);
+            }
+            else
+            {
+                clog_line_append(line, "null", 4);
+            }
+            break;
+        }
+        case CLOG_KV_TYPE_BOOL:
+            if (field->value.bool_value)
+            {
+                clog_line_append(line, "true", 4);
+            }
+            else
+            {
+                clog_line_append(line, "false", 5);
+            }
+            break;
+        case CLOG_KV_TYPE_STRING:
+            if (field->value.string_value != NULL)
+            {
+                append_string(line, field->value.string_value);
+            }
+            else
+            {
+                clog_line_append(line, "null", 4);
+            }
+            break;
+        default:
+            clog_line_append(line, "null", 4);
+            break;
+    }
+}
+
+static void write_kv(clog_level_t level, clogger_t* logger, const char* location, const char* message,
+                     va_list fields)
+{
+    clog_line_t* line = clog_line_begin();
+    char timestamp[CLOGGER_TIMESTAMP_SIZE + 2] = {'"'};
+    struct timespec now;
+
+    clog_timestamp_now(&now);
+
+    size_t timestamp_length = clog_format_timestamp(timestamp + 1, &now) + 1;
+
+    timestamp[timestamp_length++] = '"';
+
+    clog_line_append(line, "{\"time\":", 8);
+    clog_line_append(line, timestamp, timestamp_length);
+
+    if ((unsigned) level < sizeof level_values / sizeof level_values[0])
+    {
+        clog_line_append(line, ",\"level\":", 9);
+        clog_line_append(line, level_values[level].text, level_values[level].length);
+    }
+
+    if (logger != NULL)
+    {
+        clog_line_append(line, ",\"logger\":", 10);
+        append_string(line, logger->name != NULL ? logger->name : "");
+    }
+
+    if (location != NULL)
+    {
+        clog_line_append(line, ",\"location\":", 12);
+        append_string(line, location);
+    }
+
+    clog_line_append(line, ",\"msg\":", 7);
+    append_string(line, message != NULL ? message : "");
+
+    for (clog_kv_t field = va_arg(fields, clog_kv_t); field.type != CLOG_KV_TYPE_END; field = va_arg(fields, clog_kv_t))
+    {
+        clog_line_append(line, ",", 1);
+        append_string(line, field.key != NULL ? field.key : "");
+        clog_line_append(line, ":", 1);
+        append_value(line, &field);
+    }
+
+    clog_line_append(line, "}\n", 2);
+
+    if (logger != NULL && logger->file_sink != NULL)
+    {
+        clog_file_sink_write(logger->file_sink, line->data, line->length);
+        clog_line_reset(line);
+    }
+    else
+    {
+        clog_line_write(line, stdout);
+    }
+}
+
+void clog_kv(clog_level_t level, clogger_t* logger, const char* location, const char* message, ...)
+{
+    int error = level == CLOG_LEVEL_ERROR || level == CLOG_LEVEL_CRITICAL;
+    va_list fields;
+
+    if (logger != NULL && logger->log_level > level)
+    {
+        return;
+    }
+
+    // The context leading up to it goes first
+    if (error)
+    {
+        clog_flight_recorder_dump(CLOGGER_FALSE);
+    }
+
+    va_start(fields, message);
+    write_kv(level, logger, location, message, fields);
+    va_end(fields);
+
+    if (error && logger != NULL)
+    {
+        if (logger->error_callback)
+        {
+            logger->error_callback(level, logger->name, location);
+        }
+
+        if (logger->error_callback_async)
+        {
+            clog_error_dispatch(logger->error_callback_async, level, logger->name, location);
+        }
+    }
+}
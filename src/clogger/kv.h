@@ -0,0 +1,192 @@
+//! @file
+//! @brief Structured logging, key-value fields written as JSON Lines
+//! @details Each message is a single JSON object on its own line, e.g.
+//! `{"time":"12:34:56","level":"INFO","logger":"net","location":"poll","msg":"Slow read","latency_us":1200}`.
+//! Fields are encoded straight into the line buffer, with strings escaped 16 characters at a time where SSE2 is
+//! available. Only floating point values go through `printf()`, and nothing is allocated for lines that fit the
+//! buffer. The line goes to the file sink of the `clogger_t` if it has one, otherwise the console.
+
+#ifndef CLOGGER_KV_H
+#define CLOGGER_KV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "core.h"
+
+/// @brief Type of the value held by a `clog_kv_t`
+typedef enum clog_kv_type
+{
+    CLOG_KV_TYPE_END, ///< Marks the end of the fields, see `CLOG_KV_END`
+    CLOG_KV_TYPE_INT, ///< Signed integer
+    CLOG_KV_TYPE_UINT, ///< Unsigned integer
+    CLOG_KV_TYPE_DOUBLE, ///< Floating point number, `null` if it isn't finite
+    CLOG_KV_TYPE_BOOL, ///< `true` or `false`
+    CLOG_KV_TYPE_STRING ///< String, escaped as needed, `null` if it's `NULL`
+} clog_kv_type_t;
+
+/// @brief A key-value field of a structured message
+/// @details Build them with the `CLOG_KV_*` macros. Keys and strings are only read during the call.
+typedef struct clog_kv
+{
+    const char* key; ///< Name of the field
+    clog_kv_type_t type; ///< Which member of `value` is set
+    union
+    {
+        long long int_value; ///< `CLOG_KV_TYPE_INT`
+        unsigned long long uint_value; ///< `CLOG_KV_TYPE_UINT`
+        double double_value; ///< `CLOG_KV_TYPE_DOUBLE`
+        int bool_value; ///< `CLOG_KV_TYPE_BOOL`
+        const char* string_value; ///< `CLOG_KV_TYPE_STRING`
+    } value; ///< The value
+} clog_kv_t;
+
+/// @brief Build a field, use `CLOG_KV_INT()` instead
+static inline clog_kv_t clog_kv_make_int(const char* key, long long value)
+{
+    clog_kv_t kv;
+
+    kv.key = key;
+    kv.type = CLOG_KV_TYPE_INT;
+    kv.value.int_value = value;
+
+    return kv;
+}
+
+/// @brief Build a field, use `CLOG_KV_UINT()` instead
+static inline clog_kv_t clog_kv_make_uint(const char* key, unsigned long long value)
+{
+    clog_kv_t kv;
+
+    kv.key = key;
+    kv.type = CLOG_KV_TYPE_UINT;
+    kv.value.uint_value = value;
+
+    return kv;
+}
+
+/// @brief Build a field, use `CLOG_KV_DOUBLE()` instead
+static inline clog_kv_t clog_kv_make_double(const char* key, double value)
+{
+    clog_kv_t kv;
+
+    kv.key = key;
+    kv.type = CLOG_KV_TYPE_DOUBLE;
+    kv.value.double_value = value;
+
+    return kv;
+}
+
+/// @brief Build a field, use `CLOG_KV_BOOL()` instead
+static inline clog_kv_t clog_kv_make_bool(const char* key, int value)
+{
+    clog_kv_t kv;
+
+    kv.key = key;
+    kv.type = CLOG_KV_TYPE_BOOL;
+    kv.value.bool_value = value != 0;
+
+    return kv;
+}
+
+/// @brief Build a field, use `CLOG_KV_STR()` instead
+static inline clog_kv_t clog_kv_make_string(const char* key, const char* value)
+{
+    clog_kv_t kv;
+
+    kv.key = key;
+    kv.type = CLOG_KV_TYPE_STRING;
+    kv.value.string_value = value;
+
+    return kv;
+}
+
+/// @brief Build a field, use `CLOG_KV_END` instead
+static inline clog_kv_t clog_kv_make_end()
+{
+    clog_kv_t kv;
+
+    kv.key = NULL;
+    kv.type = CLOG_KV_TYPE_END;
+    kv.value.int_value = 0;
+
+    return kv;
+}
+
+/// @brief Signed integer field
+#define CLOG_KV_INT(key, value) clog_kv_make_int(key, (long long) (value))
+
+/// @brief Unsigned integer field
+#define CLOG_KV_UINT(key, value) clog_kv_make_uint(key, (unsigned long long) (value))
+
+/// @brief Floating point field
+#define CLOG_KV_DOUBLE(key, value) clog_kv_make_double(key, (double) (value))
+
+/// @brief Boolean field
+#define CLOG_KV_BOOL(key, value) clog_kv_make_bool(key, (value) ? 1 : 0)
+
+/// @brief String field
+#define CLOG_KV_STR(key, value) clog_kv_make_string(key, value)
+
+/// @brief End of the fields passed to `clog_kv()`, the `_kv` macros add it for you
+#define CLOG_KV_END clog_kv_make_end()
+
+/// @brief Log a structured message
+/// @details With a `clogger_t`, the message is only logged at or above its `log_level`, and `ERROR` and `CRITICAL`
+/// messages call its error callbacks and dump the flight recorder, as with `clogger_error()`
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure, `NULL` to always log to the console
+/// @param location [in] Location of the log, can be `NULL`
+/// @param message [in] The message, as is rather than a format string
+/// @param ... [in] `clog_kv_t` fields, ending with `CLOG_KV_END`
+void clog_kv(clog_level_t level, clogger_t* logger, const char* location, const char* message, ...);
+
+/// @brief `CLOG_LEVEL_INFO` structured message, e.g. `clog_info_kv(__FUNCTION__, "Done", CLOG_KV_INT("items", n))`
+/// @note Takes at least one field
+#define clog_info_kv(location, message, ...) \
+    clog_kv(CLOG_LEVEL_INFO, NULL, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_DEBUG` structured message
+#define clog_debug_kv(location, message, ...) \
+    clog_kv(CLOG_LEVEL_DEBUG, NULL, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_WARNING` structured message
+#define clog_warning_kv(location, message, ...) \
+    clog_kv(CLOG_LEVEL_WARNING, NULL, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_ERROR` structured message
+#define clog_error_kv(location, message, ...) \
+    clog_kv(CLOG_LEVEL_ERROR, NULL, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_CRITICAL` structured message
+#define clog_critical_kv(location, message, ...) \
+    clog_kv(CLOG_LEVEL_CRITICAL, NULL, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_INFO` structured message for a `clogger_t`, e.g.
+/// `clogger_info_kv(&logger, __FUNCTION__, "Slow read", CLOG_KV_INT("latency_us", us), CLOG_KV_STR("path", path))`
+/// @note Takes at least one field
+#define clogger_info_kv(logger, location, message, ...) \
+    clog_kv(CLOG_LEVEL_INFO, logger, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_DEBUG` structured message for a `clogger_t`
+#define clogger_debug_kv(logger, location, message, ...) \
+    clog_kv(CLOG_LEVEL_DEBUG, logger, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_WARNING` structured message for a `clogger_t`
+#define clogger_warning_kv(logger, location, message, ...) \
+    clog_kv(CLOG_LEVEL_WARNING, logger, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_ERROR` structured message for a `clogger_t`
+#define clogger_error_kv(logger, location, message, ...) \
+    clog_kv(CLOG_LEVEL_ERROR, logger, location, message, __VA_ARGS__, CLOG_KV_END)
+
+/// @brief `CLOG_LEVEL_CRITICAL` structured message for a `clogger_t`
+#define clogger_critical_kv(logger, location, message, ...) \
+    clog_kv(CLOG_LEVEL_CRITICAL, logger, location, message, __VA_ARGS__, CLOG_KV_END)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_KV_H
@@ -0,0 +1,468 @@
+#include "layout.h"
+#include "line.h"
+#include "ansi.h"
+#include "timestamp.h"
+#include "clogger_pch.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Length of the `HH:MM:SS` part of a timestamp
+#define CLOGGER_LAYOUT_CLOCK_LENGTH 8
+
+// Literals up to this long are copied as one fixed size block, the text is padded so the copy never reads past it
+#define CLOGGER_LAYOUT_SHORT_LITERAL 16
+
+typedef enum clog_layout_op_type
+{
+    CLOG_LAYOUT_LITERAL,
+    CLOG_LAYOUT_TIMESTAMP,
+    CLOG_LAYOUT_CLOCK,
+    CLOG_LAYOUT_MILLISECONDS,
+    CLOG_LAYOUT_MICROSECONDS,
+    CLOG_LAYOUT_NANOSECONDS,
+    CLOG_LAYOUT_NAME,
+    CLOG_LAYOUT_LEVEL,
+    CLOG_LAYOUT_LOCATION,
+    CLOG_LAYOUT_MESSAGE,
+    CLOG_LAYOUT_GROUP
+} clog_layout_op_type_t;
+
+// Bit of a field that can be empty, i.e. the name, level or location
+#define CLOGGER_LAYOUT_FIELD(type) (1u << ((type) - CLOG_LAYOUT_NAME))
+
+// A field and the literal text that follows it, a literal op is only there for text ahead of the first field
+typedef struct clog_layout_op
+{
+    unsigned char type;
+    unsigned char fields; // Group: the fields inside it that can be empty
+    unsigned short skip; // Group: number of ops inside it
+    unsigned short offset; // Where the literal starts in the layout's text
+    unsigned short length; // Number of characters in the literal
+} clog_layout_op_t;
+
+struct clog_layout
+{
+    const clog_layout_op_t* ops;
+    size_t count;
+    const char* text;
+};
+
+typedef struct clog_layout_field
+{
+    const char* name;
+    size_t length;
+    clog_layout_op_type_t type;
+} clog_layout_field_t;
+
+// Longer names first, so `%ms` isn't taken for `%m` followed by `s`
+static const clog_layout_field_t fields[] = {
+        {"loc", 3, CLOG_LAYOUT_LOCATION},
+        {"ms", 2, CLOG_LAYOUT_MILLISECONDS},
+        {"us", 2, CLOG_LAYOUT_MICROSECONDS},
+        {"ns", 2, CLOG_LAYOUT_NANOSECONDS},
+        {"t", 1, CLOG_LAYOUT_TIMESTAMP},
+        {"T", 1, CLOG_LAYOUT_CLOCK},
+        {"n", 1, CLOG_LAYOUT_NAME},
+        {"L", 1, CLOG_LAYOUT_LEVEL},
+        {"m", 1, CLOG_LAYOUT_MESSAGE}
+};
+
+typedef struct clog_layout_span
+{
+    const char* text;
+    size_t length;
+} clog_layout_span_t;
+
+#define CLOGGER_LAYOUT_SPAN(text) {text, sizeof text - 1}
+
+// Padded like the literals, so they're copied the same way
+static const char level_names[][CLOGGER_LAYOUT_SHORT_LITERAL] = {
+        [CLOG_LEVEL_MESSAGE] = "",
+        [CLOG_LEVEL_INFO] = "INFO",
+        [CLOG_LEVEL_DEBUG] = "DEBUG",
+        [CLOG_LEVEL_WARNING] = "WARNING",
+        [CLOG_LEVEL_ERROR] = "ERROR",
+        [CLOG_LEVEL_CRITICAL] = "CRITICAL",
+        [CLOG_LEVEL_FATAL_ASSERT] = "ASSERT FAILED",
+        [CLOG_LEVEL_NON_FATAL_ASSERT] = "ASSERT FAILED"
+};
+
+static const unsigned char level_name_lengths[] = {
+        [CLOG_LEVEL_MESSAGE] = 0,
+        [CLOG_LEVEL_INFO] = 4,
+        [CLOG_LEVEL_DEBUG] = 5,
+        [CLOG_LEVEL_WARNING] = 7,
+        [CLOG_LEVEL_ERROR] = 5,
+        [CLOG_LEVEL_CRITICAL] = 8,
+        [CLOG_LEVEL_FATAL_ASSERT] = 13,
+        [CLOG_LEVEL_NON_FATAL_ASSERT] = 13
+};
+
+// Same colours as the built-in level tags
+static const clog_layout_span_t level_colours[] = {
+        [CLOG_LEVEL_MESSAGE] = {"", 0},
+        [CLOG_LEVEL_INFO] = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HBLU),
+        [CLOG_LEVEL_DEBUG] = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HGRN),
+        [CLOG_LEVEL_WARNING] = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HYEL),
+        [CLOG_LEVEL_ERROR] = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HRED),
+        [CLOG_LEVEL_CRITICAL] = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HWHT CLOGGER_BG_HRED),
+        [CLOG_LEVEL_FATAL_ASSERT] = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HWHT CLOGGER_BG_HRED),
+        [CLOG_LEVEL_NON_FATAL_ASSERT] = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HWHT CLOGGER_BG_YEL)
+};
+
+static const clog_layout_span_t timestamp_colour = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HCYN);
+static const clog_layout_span_t location_colour = CLOGGER_LAYOUT_SPAN(CLOGGER_FG_HMAG);
+static const clog_layout_span_t reset_colour = CLOGGER_LAYOUT_SPAN(CLOGGER_RESET_CONSOLE);
+
+// `%t >> %{%loc >> %}%m`, what the file functions have always written
+static const clog_layout_op_t entry_ops[] = {
+        {CLOG_LAYOUT_TIMESTAMP, 0, 0, 0, 4},
+        {CLOG_LAYOUT_GROUP, CLOGGER_LAYOUT_FIELD(CLOG_LAYOUT_LOCATION), 1, 0, 0},
+        {CLOG_LAYOUT_LOCATION, 0, 0, 0, 4},
+        {CLOG_LAYOUT_MESSAGE, 0, 0, 0, 0}
+};
+
+static const char entry_text[4 + CLOGGER_LAYOUT_SHORT_LITERAL] = " >> ";
+
+static const clog_layout_t entry_layout = {entry_ops, sizeof entry_ops / sizeof entry_ops[0], entry_text};
+
+static _Atomic(const clog_layout_t*) current_layout = NULL;
+
+static const clog_layout_field_t* match_field(const char* name)
+{
+    for (size_t i = 0; i < sizeof fields / sizeof fields[0]; i++)
+    {
+        if (strncmp(name, fields[i].name, fields[i].length) == 0)
+        {
+            return &fields[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void push_op(clog_layout_op_t* ops, size_t* count, clog_layout_op_type_t type, size_t text_length)
+{
+    ops[(*count)++] = (clog_layout_op_t) {(unsigned char) type, 0, 0, (unsigned short) text_length, 0};
+}
+
+clog_layout_t* clog_layout_compile(const char* pattern)
+{
+    size_t pattern_length = strlen(pattern);
+
+    if (pattern_length > CLOGGER_LAYOUT_MAX_PATTERN)
+    {
+        return NULL;
+    }
+
+    // Never more ops or text than characters in the pattern, so one block holds it all
+    size_t ops_size = (pattern_length + 1) * sizeof(clog_layout_op_t);
+    clog_layout_t* layout = calloc(1, sizeof(clog_layout_t) + ops_size + pattern_length + CLOGGER_LAYOUT_SHORT_LITERAL);
+
+    if (layout == NULL)
+    {
+        return NULL;
+    }
+
+    clog_layout_op_t* ops = (clog_layout_op_t*) (layout + 1);
+    char* text = (char*) ops + ops_size;
+    size_t count = 0;
+    size_t text_length = 0;
+    size_t group = SIZE_MAX; // Index of the open group's op
+    int extend = CLOGGER_FALSE; // Whether literal text can go on the last op
+    const char* cursor = pattern;
+
+    while (*cursor != '\0')
+    {
+        if (*cursor != '%' || cursor[1] == '%')
+        {
+            if (!extend)
+            {
+                push_op(ops, &count, CLOG_LAYOUT_LITERAL, text_length);
+                extend = CLOGGER_TRUE;
+            }
+
+            ops[count - 1].length++;
+            text[text_length++] = *cursor;
+            cursor += *cursor == '%' ? 2 : 1;
+            continue;
+        }
+
+        cursor++;
+
+        if (*cursor == '{' || *cursor == '}')
+        {
+            // Groups don't nest
+            if ((*cursor == '{') != (group == SIZE_MAX))
+            {
+                free(layout);
+                return NULL;
+            }
+
+            // Text right after the group closes mustn't go on an op inside it
+            if (*cursor == '{')
+            {
+                group = count;
+                push_op(ops, &count, CLOG_LAYOUT_GROUP, text_length);
+                extend = CLOGGER_TRUE;
+            }
+            else
+            {
+                ops[group].skip = (unsigned short) (count - group - 1);
+                group = SIZE_MAX;
+                extend = CLOGGER_FALSE;
+            }
+
+            cursor++;
+            continue;
+        }
+
+        const clog_layout_field_t* field = match_field(cursor);
+
+        if (field == NULL)
+        {
+            free(layout);
+            return NULL;
+        }
+
+        if (group != SIZE_MAX && (field->type == CLOG_LAYOUT_NAME || field->type == CLOG_LAYOUT_LEVEL
+                                  || field->type == CLOG_LAYOUT_LOCATION))
+        {
+            ops[group].fields |= CLOGGER_LAYOUT_FIELD(field->type);
+        }
+
+        push_op(ops, &count, field->type, text_length);
+        extend = CLOGGER_TRUE;
+        cursor += field->length;
+    }
+
+    if (group != SIZE_MAX)
+    {
+        free(layout);
+        return NULL;
+    }
+
+    layout->ops = ops;
+    layout->count = count;
+    layout->text = text;
+
+    return layout;
+}
+
+void clog_layout_free(clog_layout_t* layout)
+{
+    free(layout);
+}
+
+void clog_set_layout(const clog_layout_t* layout)
+{
+    atomic_store_explicit(&current_layout, layout, memory_order_release);
+}
+
+const clog_layout_t* clog_get_layout()
+{
+    return atomic_load_explicit(&current_layout, memory_order_acquire);
+}
+
+// Inlined, most appends fit in the line buffer and are a bounds check and a copy
+static inline void append(clog_line_t* line, const char* text, size_t length)
+{
+    if (line->capacity - line->length >= length)
+    {
+        memcpy(line->data + line->length, text, length);
+        line->length += length;
+    }
+    else
+    {
+        clog_line_append(line, text, length);
+    }
+}
+
+// Append up to `CLOGGER_LAYOUT_SHORT_LITERAL` characters from padded text
+static inline void append_short(clog_line_t* line, const char* text, size_t length)
+{
+    if (line->capacity - line->length >= CLOGGER_LAYOUT_SHORT_LITERAL)
+    {
+        // A constant size copy is a couple of moves rather than a call
+        memcpy(line->data + line->length, text, CLOGGER_LAYOUT_SHORT_LITERAL);
+        line->length += length;
+    }
+    else
+    {
+        clog_line_append(line, text, length);
+    }
+}
+
+// Append a field, wrapped in its colour on the console
+static inline void append_field(clog_line_t* line, int plain, const clog_layout_span_t* colour, const char* text,
+                                size_t length)
+{
+    if (!plain)
+    {
+        append(line, colour->text, colour->length);
+    }
+
+    append(line, text, length);
+
+    if (!plain)
+    {
+        append(line, reset_colour.text, reset_colour.length);
+    }
+}
+
+static size_t format_fraction(char* buffer, long nanoseconds, clog_layout_op_type_t type)
+{
+    int width = type == CLOG_LAYOUT_MILLISECONDS ? 3 : type == CLOG_LAYOUT_MICROSECONDS ? 6 : 9;
+    unsigned long value = (unsigned long) nanoseconds;
+
+    for (int i = 9; i > width; i--)
+    {
+        value /= 10;
+    }
+
+    for (int i = width - 1; i >= 0; i--)
+    {
+        buffer[i] = (char) ('0' + value % 10);
+        value /= 10;
+    }
+
+    return (size_t) width;
+}
+
+void clog_layout_render(const clog_layout_t* layout, clog_line_t* line, int plain, clog_level_t level,
+                        clogger_t* logger, const char* location, const struct timespec* timestamp,
+                        clog_layout_message_t message, const void* context)
+{
+    int known_level = (unsigned) level < sizeof level_names / sizeof level_names[0];
+    unsigned int empty = (logger == NULL || logger->name == NULL ? CLOGGER_LAYOUT_FIELD(CLOG_LAYOUT_NAME) : 0)
+                         | (level == CLOG_LEVEL_MESSAGE || !known_level ? CLOGGER_LAYOUT_FIELD(CLOG_LAYOUT_LEVEL) : 0)
+                         | (location == NULL ? CLOGGER_LAYOUT_FIELD(CLOG_LAYOUT_LOCATION) : 0);
+    char fraction[9];
+
+    for (size_t i = 0; i < layout->count; i++)
+    {
+        const clog_layout_op_t* op = &layout->ops[i];
+
+        switch (op->type)
+        {
+            case CLOG_LAYOUT_GROUP:
+                if (op->fields & empty)
+                {
+                    i += op->skip;
+                    continue;
+                }
+                break;
+            case CLOG_LAYOUT_TIMESTAMP:
+            case CLOG_LAYOUT_CLOCK:
+            {
+                if (!plain)
+                {
+                    append(line, timestamp_colour.text, timestamp_colour.length);
+                }
+
+                // Straight into the line, the cached `HH:MM:SS` makes this a copy
+                char* end = clog_line_reserve(line, CLOGGER_TIMESTAMP_SIZE);
+
+                if (end != NULL)
+                {
+                    size_t length = clog_format_timestamp(end, timestamp);
+
+                    line->length += op->type == CLOG_LAYOUT_CLOCK ? CLOGGER_LAYOUT_CLOCK_LENGTH : length;
+                }
+
+                if (!plain)
+                {
+                    append(line, reset_colour.text, reset_colour.length);
+                }
+                break;
+            }
+            case CLOG_LAYOUT_MILLISECONDS:
+            case CLOG_LAYOUT_MICROSECONDS:
+            case CLOG_LAYOUT_NANOSECONDS:
+                append_field(line, plain, &timestamp_colour, fraction,
+                             format_fraction(fraction, timestamp->tv_nsec, (clog_layout_op_type_t) op->type));
+                break;
+            case CLOG_LAYOUT_NAME:
+                if (logger == NULL)
+                {
+                    break;
+                }
+
+                if (!plain)
+                {
+                    clog_line_append_colour(line, logger->console_colour, logger->colour_flags);
+                }
+
+                if (logger->name != NULL)
+                {
+                    append(line, logger->name, strlen(logger->name));
+                }
+
+                if (!plain)
+                {
+                    append(line, reset_colour.text, reset_colour.length);
+                }
+                break;
+            case CLOG_LAYOUT_LEVEL:
+                if (!(empty & CLOGGER_LAYOUT_FIELD(CLOG_LAYOUT_LEVEL)))
+                {
+                    if (!plain)
+                    {
+                        append(line, level_colours[level].text, level_colours[level].length);
+                    }
+
+                    append_short(line, level_names[level], level_name_lengths[level]);
+
+                    if (!plain)
+                    {
+                        append(line, reset_colour.text, reset_colour.length);
+                    }
+                }
+                break;
+            case CLOG_LAYOUT_LOCATION:
+                if (location != NULL)
+                {
+                    append_field(line, plain, &location_colour, location, strlen(location));
+                }
+                break;
+            case CLOG_LAYOUT_MESSAGE:
+                message(line, context);
+                break;
+            default:
+                break;
+        }
+
+        if (op->length == 0)
+        {
+            continue;
+        }
+
+        if (op->length <= CLOGGER_LAYOUT_SHORT_LITERAL)
+        {
+            append_short(line, layout->text + op->offset, op->length);
+        }
+        else
+        {
+            append(line, layout->text + op->offset, op->length);
+        }
+    }
+}
+
+void clog_layout_render_entry(clog_line_t* line, const char* location, const char* format, va_list args)
+{
+    const clog_layout_t* layout = clog_get_layout();
+    struct timespec now;
+    va_list message_args;
+
+    va_copy(message_args, args);
+
+    clog_line_message_t message = {format, &message_args};
+
+    clog_timestamp_now(&now);
+    clog_layout_render(layout != NULL ? layout : &entry_layout, line, CLOGGER_TRUE, CLOG_LEVEL_MESSAGE, NULL, location,
+                       &now, clog_line_append_message, &message);
+    clog_line_append(line, "\n", 1);
+
+    va_end(message_args);
+}
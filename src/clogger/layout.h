@@ -0,0 +1,90 @@
+//! @file
+//! @brief Custom line layouts, compiled once from a pattern string
+
+#ifndef CLOGGER_LAYOUT_H
+#define CLOGGER_LAYOUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "core.h"
+
+/// @brief Longest pattern `clog_layout_compile()` accepts
+#define CLOGGER_LAYOUT_MAX_PATTERN 65535
+
+/// @brief A line layout compiled from a pattern string
+/// @details The pattern is parsed once into a compact list of operations, rendering a line just runs through them, so
+/// a custom layout costs about the same as the built-in one
+typedef struct clog_layout clog_layout_t;
+
+struct clog_line;
+
+/// @brief Function appending the message to a line being rendered with a layout
+typedef void (* clog_layout_message_t)(struct clog_line* line, const void* context);
+
+/// @brief Compile a layout pattern
+/// @details The pattern is copied through as is, apart from these fields:
+/// - `%t` the timestamp at the precision set with `clog_set_timestamp_precision()`, e.g. `12:34:56.789`
+/// - `%T` the time of day, `HH:MM:SS`
+/// - `%ms`, `%us`, `%ns` the fraction of the second, in milli, micro or nanoseconds
+/// - `%n` the name of the `clogger_t`, empty without one
+/// - `%L` the log level, e.g. `WARNING`, empty for `CLOG_LEVEL_MESSAGE`
+/// - `%loc` the location, empty when it's `NULL`
+/// - `%m` the message
+/// - `%{` and `%}` around an optional group, left out entirely when any field in it is empty, e.g. `%{[%L] %}`
+/// - `%%` a percent sign
+///
+/// On the console every field but the message is coloured, as with the built-in layout. The line always ends with a
+/// newline, which isn't part of the pattern.
+/// @param pattern [in] The pattern, e.g. `"%T.%us %{%n %}%{[%L] %}%{%loc: %}%m"`
+/// @return Pointer to the layout, or `NULL` if the pattern is invalid or too long, or on failure
+clog_layout_t* clog_layout_compile(const char* pattern);
+
+/// @brief Free a compiled layout
+/// @warning Make sure no `clogger_t` or `clog_set_layout()` still uses it, and that queued messages were written
+/// @param layout [in] Pointer to the layout
+void clog_layout_free(clog_layout_t* layout);
+
+/// @brief Set the layout for the `clog_*` functions, the file functions and every `clogger_t` without its own `layout`
+/// @note Lines written while the process crashes always use the built-in layout
+/// @param layout [in] Pointer to the layout, `NULL` for the built-in one
+void clog_set_layout(const clog_layout_t* layout);
+
+/// @brief Get the layout set with `clog_set_layout()`
+/// @return Pointer to the layout, or `NULL` for the built-in one
+const clog_layout_t* clog_get_layout();
+
+/// @brief Render the fields of a line with a layout
+/// @note This function isn't typically used by the end user, the logging functions call it for every line
+/// @param layout [in] Pointer to the layout
+/// @param line [in] The line to append to
+/// @param plain [in] `CLOGGER_TRUE` to leave out the console colours
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure, can be `NULL`
+/// @param location [in] Location of the log, can be `NULL`
+/// @param timestamp [in] Time the message was logged
+/// @param message [in] Function appending the message
+/// @param context [in] Passed on to `message`
+void clog_layout_render(const clog_layout_t* layout, struct clog_line* line, int plain, clog_level_t level,
+                        clogger_t* logger, const char* location, const struct timespec* timestamp,
+                        clog_layout_message_t message, const void* context);
+
+/// @brief Render a whole line for the file functions such as `clog_to_file()`, newline included
+/// @details Uses the layout set with `clog_set_layout()`, or the built-in `%t >> %{%loc >> %}%m` without one
+/// @note This function isn't typically used by the end user
+/// @param line [in] The line to append to
+/// @param location [in] Location of the log, can be `NULL`
+/// @param format [in] String detailing the format
+/// @param args [in] Variable arguments list to use with the `format` string
+void clog_layout_render_entry(struct clog_line* line, const char* location, const char* format, va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_LAYOUT_H
@@ -0,0 +1,152 @@
+#include "line.h"
+#include "console.h"
+#include "clogger_pch.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+static _Thread_local char line_storage[CLOGGER_LINE_SIZE];
+static _Thread_local clog_line_t thread_line;
+
+clog_line_t* clog_line_begin()
+{
+    if (thread_line.data == NULL)
+    {
+        thread_line.data = line_storage;
+        thread_line.capacity = sizeof line_storage;
+    }
+
+    thread_line.length = 0;
+
+    return &thread_line;
+}
+
+char* clog_line_reserve(clog_line_t* line, size_t size)
+{
+    if (line->length + size > line->capacity)
+    {
+        size_t capacity = line->capacity * 2;
+
+        while (capacity < line->length + size)
+        {
+            capacity *= 2;
+        }
+
+        char* data = line->data == line_storage ? malloc(capacity) : realloc(line->data, capacity);
+
+        if (data == NULL)
+        {
+            return NULL;
+        }
+
+        if (line->data == line_storage)
+        {
+            memcpy(data, line_storage, line->length);
+        }
+
+        line->data = data;
+        line->capacity = capacity;
+    }
+
+    return line->data + line->length;
+}
+
+void clog_line_append(clog_line_t* line, const char* text, size_t length)
+{
+    char* end = clog_line_reserve(line, length);
+
+    if (end != NULL)
+    {
+        memcpy(end, text, length);
+        line->length += length;
+    }
+}
+
+void clog_line_append_string(clog_line_t* line, const char* text)
+{
+    clog_line_append(line, text, strlen(text));
+}
+
+void clog_line_append_vformat(clog_line_t* line, const char* format, va_list args)
+{
+    va_list retry_args;
+    size_t available = line->capacity - line->length;
+
+    va_copy(retry_args, args);
+
+    int length = vsnprintf(line->data + line->length, available, format, args);
+
+    if (length >= 0 && (size_t) length >= available)
+    {
+        // Didn't fit, grow to the exact size and format again
+        char* end = clog_line_reserve(line, (size_t) length + 1);
+
+        length = end != NULL ? vsnprintf(end, (size_t) length + 1, format, retry_args) : -1;
+    }
+
+    va_end(retry_args);
+
+    if (length > 0)
+    {
+        line->length += (size_t) length;
+    }
+}
+
+void clog_line_append_message(clog_line_t* line, const void* message)
+{
+    const clog_line_message_t* line_message = message;
+    va_list args;
+
+    // A copy each time, a layout can have the message more than once
+    va_copy(args, *line_message->args);
+    clog_line_append_vformat(line, line_message->format, args);
+    va_end(args);
+}
+
+void clog_line_append_colour(clog_line_t* line, clog_console_colour_t console_colour, unsigned short flags)
+{
+    char* end = clog_line_reserve(line, CLOGGER_COLOUR_CODE_SIZE);
+
+    if (end != NULL)
+    {
+        line->length += clog_format_console_colour(end, console_colour, flags);
+    }
+}
+
+void clog_line_write(clog_line_t* line, FILE* stream)
+{
+#ifdef WIN32
+    // Lines carry ANSI escapes rather than console attribute calls, so make sure the console understands them
+    static int virtual_terminal = CLOGGER_FALSE;
+
+    if (!virtual_terminal && stream == stdout)
+    {
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+
+        if (GetConsoleMode(console, &mode))
+        {
+            SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+
+        virtual_terminal = CLOGGER_TRUE;
+    }
+#endif
+
+    fwrite(line->data, 1, line->length, stream);
+
+    clog_line_reset(line);
+}
+
+void clog_line_reset(clog_line_t* line)
+{
+    if (line->data != line_storage)
+    {
+        free(line->data);
+        line->data = line_storage;
+        line->capacity = sizeof line_storage;
+    }
+
+    line->length = 0;
+}
@@ -0,0 +1,89 @@
+//! @file
+//! @brief Internal line buffer, used to assemble a whole log line before writing it in one go
+//! @note This header is internal to the library and is not part of the public API
+
+#ifndef CLOGGER_LINE_H
+#define CLOGGER_LINE_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CLOGGER_LINE_SIZE
+/// @brief Size of the per-thread line buffer, longer lines fall back to the heap
+#define CLOGGER_LINE_SIZE 1024
+#endif
+
+/// @brief A line being assembled
+typedef struct clog_line
+{
+    char* data; ///< The line, not null terminated
+    size_t length; ///< Number of characters in `data`
+    size_t capacity; ///< Size of `data`
+} clog_line_t;
+
+/// @brief Get the calling thread's line buffer, emptied
+/// @return Pointer to the line
+clog_line_t* clog_line_begin();
+
+/// @brief Make room for at least `size` more characters
+/// @param line [in] The line
+/// @param size [in] Number of characters needed
+/// @return Pointer to the end of the line, or `NULL` if the room couldn't be made
+char* clog_line_reserve(clog_line_t* line, size_t size);
+
+/// @brief Append characters to a line
+/// @param line [in] The line
+/// @param text [in] Characters to append
+/// @param length [in] Number of characters to append
+void clog_line_append(clog_line_t* line, const char* text, size_t length);
+
+/// @brief Append a null terminated string to a line
+/// @param line [in] The line
+/// @param text [in] String to append
+void clog_line_append_string(clog_line_t* line, const char* text);
+
+/// @brief Append formatted text to a line, as `vprintf()` would print it
+/// @param line [in] The line
+/// @param format [in] String detailing the format
+/// @param args [in] Variable arguments list to use with the `format` string
+void clog_line_append_vformat(clog_line_t* line, const char* format, va_list args);
+
+/// @brief A formatted message waiting to be appended to a line
+typedef struct clog_line_message
+{
+    const char* format; ///< String detailing the format
+    va_list* args; ///< Variable arguments list to use with the `format` string, left untouched
+} clog_line_message_t;
+
+/// @brief Append a `clog_line_message_t` to a line, as a `clog_layout_message_t`
+/// @param line [in] The line
+/// @param message [in] Pointer to the `clog_line_message_t`
+void clog_line_append_message(struct clog_line* line, const void* message);
+
+/// @brief Append the escape sequence selecting a console colour to a line
+/// @param line [in] The line
+/// @param console_colour [in] Colour of the text
+/// @param flags [in] Flags to manipulate the text colour
+void clog_line_append_colour(clog_line_t* line, clog_console_colour_t console_colour, unsigned short flags);
+
+/// @brief Empty a line and release any memory it grew into
+/// @param line [in] The line
+void clog_line_reset(clog_line_t* line);
+
+/// @brief Write a line to a stream with a single call and release any memory it grew into
+/// @param line [in] The line
+/// @param stream [in] The stream to write to
+void clog_line_write(clog_line_t* line, FILE* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_LINE_H
@@ -0,0 +1,202 @@
+#include "prepend_sink.h"
+#include "core.h"
+#include "clog.h"
+#include "fileio.h"
+#include "line.h"
+#include "layout.h"
+#include "clogger_pch.h"
+
+#include <stdint.h>
+
+struct clog_prepend_sink
+{
+    int fd;
+    int index_fd;
+    uint64_t size;
+    pthread_mutex_t mutex;
+};
+
+static char* index_path(const char* file_path)
+{
+    size_t length = strlen(file_path);
+    char* path = malloc(length + sizeof CLOGGER_PREPEND_INDEX_SUFFIX);
+
+    if (path != NULL)
+    {
+        memcpy(path, file_path, length);
+        memcpy(path + length, CLOGGER_PREPEND_INDEX_SUFFIX, sizeof CLOGGER_PREPEND_INDEX_SUFFIX);
+    }
+
+    return path;
+}
+
+clog_prepend_sink_t* clog_prepend_sink_open(const char* file_path)
+{
+    clog_prepend_sink_t* sink = calloc(1, sizeof(clog_prepend_sink_t));
+    char* path = index_path(file_path);
+
+    if (sink == NULL || path == NULL)
+    {
+        free(sink);
+        free(path);
+        return NULL;
+    }
+
+    sink->fd = open(file_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    sink->index_fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if (sink->fd < 0 || sink->index_fd < 0)
+    {
+        perror(sink->fd < 0 ? file_path : path);
+        clog_error(__FUNCTION__, "Could not open file %s", sink->fd < 0 ? file_path : path);
+
+        if (sink->fd >= 0)
+        {
+            close(sink->fd);
+        }
+
+        if (sink->index_fd >= 0)
+        {
+            close(sink->index_fd);
+        }
+
+        free(sink);
+        free(path);
+        return NULL;
+    }
+
+    free(path);
+
+    off_t size = lseek(sink->fd, 0, SEEK_END);
+    off_t index_size = lseek(sink->index_fd, 0, SEEK_END);
+
+    sink->size = size > 0 ? (uint64_t) size : 0;
+
+    // Whatever was logged before the index existed becomes one message
+    if (sink->size > 0 && index_size == 0)
+    {
+        uint64_t offset = 0;
+        clog_write_all(sink->index_fd, &offset, sizeof offset);
+    }
+
+    pthread_mutex_init(&sink->mutex, NULL);
+
+    return sink;
+}
+
+int clog_prepend_sink_write(clog_prepend_sink_t* sink, const char* data, size_t length)
+{
+    pthread_mutex_lock(&sink->mutex);
+
+    uint64_t offset = sink->size;
+    int result = clog_write_all(sink->fd, data, length);
+
+    // Only index what fully made it into the file
+    if (result)
+    {
+        sink->size += length;
+        result = clog_write_all(sink->index_fd, &offset, sizeof offset);
+    }
+
+    pthread_mutex_unlock(&sink->mutex);
+
+    return result;
+}
+
+void clog_prepend_sink_close(clog_prepend_sink_t* sink)
+{
+    close(sink->fd);
+    close(sink->index_fd);
+
+    pthread_mutex_destroy(&sink->mutex);
+    free(sink);
+}
+
+int clog_prepend_to_sink(clog_prepend_sink_t* sink, const char* location, const char* message, ...)
+{
+    va_list args;
+    clog_line_t* line = clog_line_begin();
+
+    va_start(args, message);
+    clog_layout_render_entry(line, location, message, args);
+    va_end(args);
+
+    int result = clog_prepend_sink_write(sink, line->data, line->length);
+
+    clog_line_reset(line);
+
+    return result;
+}
+
+int clog_prepend_sink_read(const char* file_path, FILE* output)
+{
+    int result = CLOGGER_FALSE;
+    char* path = index_path(file_path);
+    FILE* file_ptr = fopen(file_path, "rb");
+    FILE* index_ptr = path != NULL ? fopen(path, "rb") : NULL;
+
+    if (file_ptr != NULL && index_ptr != NULL)
+    {
+        char buffer[8192];
+        uint64_t end;
+        long count;
+
+        fseek(file_ptr, 0, SEEK_END);
+        end = (uint64_t) ftell(file_ptr);
+
+        fseek(index_ptr, 0, SEEK_END);
+        count = ftell(index_ptr) / (long) sizeof(uint64_t);
+
+        result = CLOGGER_TRUE;
+
+        // Walk the index backwards, each message runs up to where the next one starts
+        for (long i = count - 1; i >= 0 && result; i--)
+        {
+            uint64_t start;
+
+            fseek(index_ptr, i * (long) sizeof(uint64_t), SEEK_SET);
+
+            if (fread(&start, sizeof start, 1, index_ptr) != 1 || start > end)
+            {
+                result = CLOGGER_FALSE;
+                break;
+            }
+
+            fseek(file_ptr, (long) start, SEEK_SET);
+
+            for (uint64_t remaining = end - start; remaining > 0;)
+            {
+                size_t chunk = remaining < sizeof buffer ? (size_t) remaining : sizeof buffer;
+
+                if (fread(buffer, 1, chunk, file_ptr) != chunk || fwrite(buffer, 1, chunk, output) != chunk)
+                {
+                    result = CLOGGER_FALSE;
+                    break;
+                }
+
+                remaining -= chunk;
+            }
+
+            end = start;
+        }
+    }
+    else
+    {
+        perror(file_ptr == NULL ? file_path : path);
+        clog_error(__FUNCTION__, "Could not open file %s", file_ptr == NULL ? file_path : path);
+    }
+
+    if (file_ptr != NULL)
+    {
+        fclose(file_ptr);
+    }
+
+    if (index_ptr != NULL)
+    {
+        fclose(index_ptr);
+    }
+
+    free(path);
+
+    return result;
+}
@@ -0,0 +1,59 @@
+//! @file
+//! @brief "Newest first" log files without rewriting the file on every message
+
+#ifndef CLOGGER_PREPEND_SINK_H
+#define CLOGGER_PREPEND_SINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+
+/// @brief Suffix of the offset index kept next to the log file
+#define CLOGGER_PREPEND_INDEX_SUFFIX ".idx"
+
+/// @brief A log file read newest first, written in constant time
+/// @details Messages are appended to the file as usual, while the offset of each message is appended to a sidecar
+/// index (the file path followed by `CLOGGER_PREPEND_INDEX_SUFFIX`). `clog_prepend_sink_read()` walks the index
+/// backwards, so readers still see the newest message first, while each message only costs one append instead of
+/// rewriting the whole file as `clog_prepend_to_file()` does.
+typedef struct clog_prepend_sink clog_prepend_sink_t;
+
+/// @brief Open a prepend sink
+/// @details A log file that already exists without an index is indexed as a single message
+/// @param file_path [in] The file path to log to, e.g. `/logs/log.txt`
+/// @return Pointer to the sink, or `NULL` on failure
+clog_prepend_sink_t* clog_prepend_sink_open(const char* file_path);
+
+/// @brief Add raw text to a prepend sink as one message
+/// @param sink [in] Pointer to the sink
+/// @param data [in] Text of the message
+/// @param length [in] Number of characters in the message
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_prepend_sink_write(clog_prepend_sink_t* sink, const char* data, size_t length);
+
+/// @brief Close a prepend sink
+/// @param sink [in] Pointer to the sink
+void clog_prepend_sink_close(clog_prepend_sink_t* sink);
+
+/// @brief Log message to a prepend sink, in the same format as `clog_prepend_to_file()`
+/// @param sink [in] Pointer to the sink
+/// @param location [in] Location of the log
+/// @param message [in] Format-able string message as you would use `printf()`
+/// @param ... [in] Variable-length args
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_prepend_to_sink(clog_prepend_sink_t* sink, const char* location, const char* message, ...);
+
+/// @brief Read a log file written by a prepend sink, newest message first
+/// @param file_path [in] The file path of the log, not of its index
+/// @param output [in] Stream to receive the messages, e.g. `stdout`
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_prepend_sink_read(const char* file_path, FILE* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_PREPEND_SINK_H
@@ -0,0 +1,129 @@
+#include "rate_limit.h"
+#include "clog.h"
+#include "error_dispatch.h"
+#include "flight_recorder.h"
+#include "clogger_pch.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define CLOGGER_LIMIT_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define CLOGGER_LIMIT_CLOCK CLOCK_MONOTONIC
+#endif
+
+// The header keeps plain fields so it can be included from C++, they're only ever touched through these
+_Static_assert(sizeof(_Atomic unsigned long long) == sizeof(unsigned long long), "atomic counters must be plain size");
+
+#define CLOGGER_LIMIT_ATOMIC(field) ((_Atomic unsigned long long*) &(field))
+
+static unsigned long long now_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOGGER_LIMIT_CLOCK, &now);
+
+    // Offset so a fresh bucket, whose full time is `0`, is always full
+    return (unsigned long long) now.tv_sec * 1000000000ULL + (unsigned long long) now.tv_nsec + 1000000000ULL;
+}
+
+// Generic cell rate algorithm, a token bucket kept as the single time it'll be full again
+static int allow_rate(clog_limit_t* limit)
+{
+    _Atomic unsigned long long* state = CLOGGER_LIMIT_ATOMIC(limit->state);
+    unsigned long long now = now_ns();
+    unsigned long long full = atomic_load_explicit(state, memory_order_relaxed);
+
+    for (;;)
+    {
+        // More than a burst ahead of now, the bucket is empty
+        if (full > now + limit->second)
+        {
+            return CLOGGER_FALSE;
+        }
+
+        unsigned long long next = (full > now ? full : now) + limit->first;
+
+        if (atomic_compare_exchange_weak_explicit(state, &full, next, memory_order_relaxed, memory_order_relaxed))
+        {
+            return CLOGGER_TRUE;
+        }
+    }
+}
+
+int clog_limit_allow(clog_limit_t* limit, unsigned long long* suppressed)
+{
+    int allowed;
+
+    if (limit->policy == CLOG_LIMIT_POLICY_RATE)
+    {
+        allowed = allow_rate(limit);
+    }
+    else
+    {
+        unsigned long long count = atomic_fetch_add_explicit(CLOGGER_LIMIT_ATOMIC(limit->state), 1,
+                                                             memory_order_relaxed);
+
+        if (limit->policy == CLOG_LIMIT_POLICY_SAMPLE)
+        {
+            allowed = limit->first <= 1 || count % limit->first == 0;
+        }
+        else
+        {
+            allowed = count < limit->first
+                      || (limit->second != 0 && (count - limit->first + 1) % limit->second == 0);
+        }
+    }
+
+    if (!allowed)
+    {
+        atomic_fetch_add_explicit(CLOGGER_LIMIT_ATOMIC(limit->suppressed), 1, memory_order_relaxed);
+        return CLOGGER_FALSE;
+    }
+
+    // Only pay for the exchange once something was actually suppressed
+    if (atomic_load_explicit(CLOGGER_LIMIT_ATOMIC(limit->suppressed), memory_order_relaxed) == 0)
+    {
+        *suppressed = 0;
+    }
+    else
+    {
+        *suppressed = atomic_exchange_explicit(CLOGGER_LIMIT_ATOMIC(limit->suppressed), 0, memory_order_relaxed);
+    }
+
+    return CLOGGER_TRUE;
+}
+
+void clog_limited(clog_level_t level, clogger_t* logger, const char* location, unsigned long long suppressed,
+                  const char* message, ...)
+{
+    va_list args;
+    int error = level == CLOG_LEVEL_ERROR || level == CLOG_LEVEL_CRITICAL;
+
+    va_start(args, message);
+
+    if (error)
+    {
+        // The context leading up to it goes first
+        clog_flight_recorder_dump(CLOGGER_FALSE);
+    }
+
+    clog_messagef_suppressed(level, logger, location, suppressed, message, args);
+
+    if (error && logger != NULL)
+    {
+        // Error callback
+        if (logger->error_callback)
+        {
+            logger->error_callback(level, logger->name, location);
+        }
+
+        if (logger->error_callback_async)
+        {
+            clog_error_dispatch(logger->error_callback_async, level, logger->name, location);
+        }
+    }
+
+    va_end(args);
+}
@@ -0,0 +1,179 @@
+//! @file
+//! @brief Rate limited and sampled logging, per call site
+//! @details Each `*_LIMITED` macro keeps a static `clog_limit_t` for its call site, so a hot loop hitting one site
+//! can't flood the output or starve the rest of the process, while every other site carries on as normal. The limit is
+//! checked with a single atomic operation before any argument is evaluated, and messages it turns away are only
+//! counted. The next message that gets through from the site ends with ` (N suppressed)`.
+//!
+//! The limit is one of:
+//! - `CLOG_LIMIT_RATE(n)` at most `n` messages a second, in bursts of up to `n`
+//! - `CLOG_LIMIT_SAMPLE(n)` one message in every `n`, starting with the first
+//! - `CLOG_LIMIT_FIRST_THEN_EVERY(n, m)` the first `n` messages, then one in every `m`
+//!
+//! e.g. `CLOGGER_WARNING_LIMITED(&logger, CLOG_LIMIT_RATE(100), __FUNCTION__, "Dropped packet %u", id)`
+//! @note For a `clogger_t`, the `log_level` is checked first, so messages it filters out don't use up the limit
+
+#ifndef CLOGGER_RATE_LIMIT_H
+#define CLOGGER_RATE_LIMIT_H
+
+#include "core.h"
+#include "clog.h"
+#include "clogger.h"
+#include "clog_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief How a `clog_limit_t` decides which messages get through
+typedef enum clog_limit_policy
+{
+    CLOG_LIMIT_POLICY_RATE, ///< Token bucket, see `CLOG_LIMIT_RATE()`
+    CLOG_LIMIT_POLICY_SAMPLE, ///< One in N, see `CLOG_LIMIT_SAMPLE()`
+    CLOG_LIMIT_POLICY_FIRST_THEN_EVERY ///< First N then one in M, see `CLOG_LIMIT_FIRST_THEN_EVERY()`
+} clog_limit_policy_t;
+
+/// @brief State of the limit of one call site, initialised with `CLOG_LIMIT_INITIALIZER()`
+/// @details `state` and `suppressed` are only ever accessed atomically by `clog_limit_allow()`
+typedef struct clog_limit
+{
+    clog_limit_policy_t policy; ///< Which of the policies applies
+    unsigned long long first; ///< Nanoseconds between messages for a rate, otherwise the N of the policy
+    unsigned long long second; ///< Nanoseconds a burst may run ahead for a rate, otherwise the M of the policy
+    unsigned long long state; ///< Earliest time the bucket is full again for a rate, otherwise messages seen so far
+    unsigned long long suppressed; ///< Messages turned away since the last one that got through
+} clog_limit_t;
+
+/// @brief At most `n` messages a second, `n` above `0`
+#define CLOG_LIMIT_RATE(n) (CLOG_LIMIT_POLICY_RATE, 1000000000ULL / (n), 1000000000ULL - 1000000000ULL / (n))
+
+/// @brief One message in every `n`, starting with the first
+#define CLOG_LIMIT_SAMPLE(n) (CLOG_LIMIT_POLICY_SAMPLE, (n), 0)
+
+/// @brief The first `n` messages, then one in every `m`, or none at all after the first `n` if `m` is `0`
+#define CLOG_LIMIT_FIRST_THEN_EVERY(n, m) (CLOG_LIMIT_POLICY_FIRST_THEN_EVERY, (n), (m))
+
+/// @brief Initializer of a `clog_limit_t` from one of the `CLOG_LIMIT_*` macros, for limits shared between sites, e.g.
+/// `static clog_limit_t limit = CLOG_LIMIT_INITIALIZER(CLOG_LIMIT_RATE(10));`
+#define CLOG_LIMIT_INITIALIZER(limit) CLOGGER_LIMIT_FIELDS limit
+
+#define CLOGGER_LIMIT_FIELDS(policy, first, second) {policy, first, second, 0, 0}
+
+/// @brief Decide whether a message gets through a limit
+/// @note This function isn't typically used by the end user, the `*_LIMITED` macros call it
+/// @param limit [in] The limit of the call site
+/// @param suppressed [out] Number of messages suppressed since the last one that got through, only set if this one
+/// gets through
+/// @return `CLOGGER_TRUE` if the message gets through, otherwise `CLOGGER_FALSE`
+int clog_limit_allow(clog_limit_t* limit, unsigned long long* suppressed);
+
+/// @brief Log a message that got through a limit, as the `clog_*` or `clogger_*` function of its level would have
+/// @note This function isn't typically used by the end user, the `*_LIMITED` macros call it. It doesn't check the
+/// `log_level` of `logger`.
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure, can be `NULL`
+/// @param location [in] Location of the log
+/// @param suppressed [in] Number of messages suppressed before this one
+/// @param message [in] Format-able string message as you would use `printf()`
+/// @param ... [in] Variable-length args
+void clog_limited(clog_level_t level, clogger_t* logger, const char* location, unsigned long long suppressed,
+                  const char* message, ...);
+
+/// @brief Logs through the limit of the call site, if `logger` is `NULL` or would log at `level`, before the arguments
+/// are evaluated
+#define CLOGGER_LIMITED_CALL(logger, level, limit, location, ...) \
+    do \
+    { \
+        static clog_limit_t clogger_limit_ = CLOG_LIMIT_INITIALIZER(limit); \
+        clogger_t* clogger_limit_logger_ = (logger); \
+        unsigned long long clogger_suppressed_; \
+        if ((clogger_limit_logger_ == NULL || clogger_limit_logger_->log_level <= (level)) \
+            && clog_limit_allow(&clogger_limit_, &clogger_suppressed_)) \
+        { \
+            clog_limited(level, clogger_limit_logger_, location, clogger_suppressed_, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_MESSAGE
+/// @brief `clog_message()` through a per-site limit, e.g. `CLOG_MESSAGE_LIMITED(CLOG_LIMIT_SAMPLE(10), loc, "x")`
+#define CLOG_MESSAGE_LIMITED(limit, location, ...) \
+    CLOGGER_LIMITED_CALL(NULL, CLOG_LEVEL_MESSAGE, limit, location, __VA_ARGS__)
+#else
+#define CLOG_MESSAGE_LIMITED(limit, location, ...) CLOGGER_DISCARD(clog_message(location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_INFO
+/// @brief `clog_info()` through a per-site limit
+#define CLOG_INFO_LIMITED(limit, location, ...) \
+    CLOGGER_LIMITED_CALL(NULL, CLOG_LEVEL_INFO, limit, location, __VA_ARGS__)
+
+/// @brief `clogger_info()` through a per-site limit
+#define CLOGGER_INFO_LIMITED(logger, limit, location, ...) \
+    CLOGGER_LIMITED_CALL(logger, CLOG_LEVEL_INFO, limit, location, __VA_ARGS__)
+#else
+#define CLOG_INFO_LIMITED(limit, location, ...) CLOGGER_DISCARD(clog_info(location, __VA_ARGS__))
+#define CLOGGER_INFO_LIMITED(logger, limit, location, ...) \
+    CLOGGER_DISCARD(clogger_info(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_DEBUG
+/// @brief `clog_debug()` through a per-site limit
+#define CLOG_DEBUG_LIMITED(limit, location, ...) \
+    CLOGGER_LIMITED_CALL(NULL, CLOG_LEVEL_DEBUG, limit, location, __VA_ARGS__)
+
+/// @brief `clogger_debug()` through a per-site limit
+#define CLOGGER_DEBUG_LIMITED(logger, limit, location, ...) \
+    CLOGGER_LIMITED_CALL(logger, CLOG_LEVEL_DEBUG, limit, location, __VA_ARGS__)
+#else
+#define CLOG_DEBUG_LIMITED(limit, location, ...) CLOGGER_DISCARD(clog_debug(location, __VA_ARGS__))
+#define CLOGGER_DEBUG_LIMITED(logger, limit, location, ...) \
+    CLOGGER_DISCARD(clogger_debug(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_WARNING
+/// @brief `clog_warning()` through a per-site limit
+#define CLOG_WARNING_LIMITED(limit, location, ...) \
+    CLOGGER_LIMITED_CALL(NULL, CLOG_LEVEL_WARNING, limit, location, __VA_ARGS__)
+
+/// @brief `clogger_warning()` through a per-site limit
+#define CLOGGER_WARNING_LIMITED(logger, limit, location, ...) \
+    CLOGGER_LIMITED_CALL(logger, CLOG_LEVEL_WARNING, limit, location, __VA_ARGS__)
+#else
+#define CLOG_WARNING_LIMITED(limit, location, ...) CLOGGER_DISCARD(clog_warning(location, __VA_ARGS__))
+#define CLOGGER_WARNING_LIMITED(logger, limit, location, ...) \
+    CLOGGER_DISCARD(clogger_warning(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_ERROR
+/// @brief `clog_error()` through a per-site limit
+#define CLOG_ERROR_LIMITED(limit, location, ...) \
+    CLOGGER_LIMITED_CALL(NULL, CLOG_LEVEL_ERROR, limit, location, __VA_ARGS__)
+
+/// @brief `clogger_error()` through a per-site limit, the error callbacks only see the messages that get through
+#define CLOGGER_ERROR_LIMITED(logger, limit, location, ...) \
+    CLOGGER_LIMITED_CALL(logger, CLOG_LEVEL_ERROR, limit, location, __VA_ARGS__)
+#else
+#define CLOG_ERROR_LIMITED(limit, location, ...) CLOGGER_DISCARD(clog_error(location, __VA_ARGS__))
+#define CLOGGER_ERROR_LIMITED(logger, limit, location, ...) \
+    CLOGGER_DISCARD(clogger_error(logger, location, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_CRITICAL
+/// @brief `clog_critical()` through a per-site limit
+#define CLOG_CRITICAL_LIMITED(limit, location, ...) \
+    CLOGGER_LIMITED_CALL(NULL, CLOG_LEVEL_CRITICAL, limit, location, __VA_ARGS__)
+
+/// @brief `clogger_critical()` through a per-site limit, the error callbacks only see the messages that get through
+#define CLOGGER_CRITICAL_LIMITED(logger, limit, location, ...) \
+    CLOGGER_LIMITED_CALL(logger, CLOG_LEVEL_CRITICAL, limit, location, __VA_ARGS__)
+#else
+#define CLOG_CRITICAL_LIMITED(limit, location, ...) CLOGGER_DISCARD(clog_critical(location, __VA_ARGS__))
+#define CLOGGER_CRITICAL_LIMITED(logger, limit, location, ...) \
+    CLOGGER_DISCARD(clogger_critical(logger, location, __VA_ARGS__))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_RATE_LIMIT_H
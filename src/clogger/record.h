@@ -0,0 +1,128 @@
+//! @file
+//! @brief Internal log record passed between the producers and the logging backend
+//! @note This header is internal to the library and is not part of the public API
+
+#ifndef CLOGGER_RECORD_H
+#define CLOGGER_RECORD_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "core.h"
+#include "deferred.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CLOGGER_RECORD_DATA_SIZE
+/// @brief Size of the payload carried by a `clog_record_t`, longer formatted messages are truncated
+#define CLOGGER_RECORD_DATA_SIZE 256
+#endif
+
+/// @brief A single log message captured by a producer
+/// @details When `format` is set, `data` holds the arguments captured by `clog_format_capture()` and the message is
+/// only formatted when the record is written. Otherwise `data` holds the already formatted text.
+typedef struct clog_record
+{
+    clog_level_t level; ///< The log level
+    clogger_t* logger; ///< The `clogger_t` the message belongs to, can be `NULL`, must outlive the record
+    const char* location; ///< Location of the log, must outlive the record
+    const clog_format_t* format; ///< Parsed format of a deferred message, or `NULL` if `data` is text
+    struct timespec timestamp; ///< Time the message was logged
+    size_t length; ///< Number of bytes used in `data`
+    unsigned char data[CLOGGER_RECORD_DATA_SIZE]; ///< Captured arguments or formatted text
+} clog_record_t;
+
+/// @brief Capture a message into a record, stamping it with the current time
+/// @details The arguments are copied in binary form when the format can be deferred, otherwise they are formatted
+/// into the record straight away
+/// @param record [out] The record to fill
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure, can be `NULL`
+/// @param location [in] Location of the log, can be `NULL`
+/// @param format [in] String detailing the format
+/// @param args [in] Variable arguments list to use with the `format` string
+void clog_record_capture(clog_record_t* record, clog_level_t level, clogger_t* logger, const char* location,
+                         const char* format, va_list args);
+
+/// @brief Write a captured record to the console, exactly as `clog_messagef()` would have
+/// @param record [in] The record to write
+void clog_record_write(const clog_record_t* record);
+
+/// @brief Write a captured record to a binary sink, as is
+/// @param sink [in] Pointer to the sink
+/// @param record [in] The record to write
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_binary_sink_write_record(struct clog_binary_sink* sink, const clog_record_t* record);
+
+/// @brief Write a record to a binary sink and flush it, without taking the sink's lock or touching the heap
+/// @note Async-signal-safe, only meant for when the process is going down, after `clog_binary_sink_drain_safe()`
+/// @param sink [in] Pointer to the sink
+/// @param record [in] The record to write
+/// @return `CLOGGER_FALSE` on failure or `CLOGGER_TRUE` on success
+int clog_binary_sink_write_record_safe(struct clog_binary_sink* sink, const clog_record_t* record);
+
+/// @brief Write a captured record straight to its file descriptor, using only async-signal-safe calls
+/// @details Used when the process is going down. The line is truncated to `CLOGGER_LINE_SIZE` and deferred arguments
+/// are rendered by `clog_format_render_safe()`
+/// @param record [in] The record to write
+void clog_record_write_safe(const clog_record_t* record);
+
+/// @brief Push a message onto the asynchronous backend queue
+/// @details `ERROR`, `CRITICAL` and `FATAL_ASSERT` messages take the priority lane
+/// @note Blocks while the queue is full, unless the backpressure policy says otherwise
+/// @param level [in] The log level
+/// @param logger [in] Pointer to a `clogger_t` data structure, can be `NULL`
+/// @param location [in] Location of the log, can be `NULL`
+/// @param format [in] String detailing the format
+/// @param args [in] Variable arguments list to use with the `format` string
+/// @param ticket [out] Ticket of the message
+/// @return `CLOGGER_FALSE` if the backend is not running, otherwise `CLOGGER_TRUE`
+int clog_async_enqueue(clog_level_t level, clogger_t* logger, const char* location, const char* format, va_list args,
+                       clog_ticket_t* ticket);
+
+/// @brief Push an already captured record onto the asynchronous backend queue
+/// @note Blocks while the queue is full, unless the backpressure policy of the record's logger says otherwise
+/// @param record [in] The record to copy
+/// @param urgent [in] `CLOGGER_TRUE` to put it in the priority lane, whatever its level
+/// @param ticket [out] Ticket of the message
+/// @return `CLOGGER_FALSE` if the backend is not running, otherwise `CLOGGER_TRUE`
+int clog_async_enqueue_record(const clog_record_t* record, int urgent, clog_ticket_t* ticket);
+
+/// @brief Wait for the message of a ticket to be written
+/// @param ticket [in] The ticket
+/// @param deadline [in] `CLOCK_REALTIME` time to give up at, `NULL` to wait for as long as it takes
+/// @return `CLOGGER_FALSE` if the deadline passed first, otherwise `CLOGGER_TRUE`
+int clog_async_wait(clog_ticket_t ticket, const struct timespec* deadline);
+
+/// @brief Wait for every message queued so far and every detached message to be written
+/// @param deadline [in] `CLOCK_REALTIME` time to give up at, `NULL` to wait for as long as it takes
+/// @return `CLOGGER_FALSE` if the deadline passed first, otherwise `CLOGGER_TRUE`
+int clog_async_flush_until(const struct timespec* deadline);
+
+/// @brief Count a message handed to a thread of its own, for when the backend isn't running
+/// @return Ticket of the message
+clog_ticket_t clog_async_detach_begin();
+
+/// @brief Mark a message from `clog_async_detach_begin()` as written
+void clog_async_detach_end();
+
+/// @brief Stop the backend taking records from the queue for good and wait for the one it's writing, using only
+/// async-signal-safe calls
+/// @note Only meant for when the process is going down
+/// @param deadline [in] `CLOCK_MONOTONIC` time to give up waiting at
+void clog_async_halt_safe(const struct timespec* deadline);
+
+/// @brief Write out every record still queued from the calling thread, using only async-signal-safe calls
+/// @details Halts the backend first, see `clog_async_halt_safe()`
+/// @param deadline [in] `CLOCK_MONOTONIC` time to give up at
+/// @return Number of records written
+size_t clog_async_drain_safe(const struct timespec* deadline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_RECORD_H
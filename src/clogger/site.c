@@ -0,0 +1,108 @@
+#include "site.h"
+#include "clogger_pch.h"
+
+#if CLOGGER_HAVE_SITE_SECTION
+#ifdef __APPLE__
+extern clog_site_t* const clog_sites_start[] __asm("section$start$__DATA$clog_sites");
+extern clog_site_t* const clog_sites_stop[] __asm("section$end$__DATA$clog_sites");
+#else
+// Defined by the linker around the section, weak so a program without any site still links
+extern clog_site_t* const __start_clog_sites[] __attribute__((weak, visibility("hidden")));
+extern clog_site_t* const __stop_clog_sites[] __attribute__((weak, visibility("hidden")));
+
+#define clog_sites_start __start_clog_sites
+#define clog_sites_stop __stop_clog_sites
+#endif
+#endif
+
+size_t clog_site_foreach(clog_site_callback_t callback, void* context)
+{
+#if CLOGGER_HAVE_SITE_SECTION
+    size_t count = 0;
+
+    if (clog_sites_start == NULL)
+    {
+        return 0;
+    }
+
+    for (clog_site_t* const* entry = clog_sites_start; entry < clog_sites_stop; entry++)
+    {
+        callback(*entry, context);
+        count++;
+    }
+
+    return count;
+#else
+    (void) callback;
+    (void) context;
+
+    return 0;
+#endif
+}
+
+int clog_site_glob_match(const char* glob, const char* text)
+{
+    // Where to resume after the last `*`, if the rest fails to match
+    const char* star = NULL;
+    const char* resume = NULL;
+
+    while (*text != '\0')
+    {
+        if (*glob == '*')
+        {
+            star = ++glob;
+            resume = text;
+        }
+        else if (*glob == '?' || *glob == *text)
+        {
+            glob++;
+            text++;
+        }
+        else if (star != NULL)
+        {
+            // Let the `*` swallow one more character
+            glob = star;
+            text = ++resume;
+        }
+        else
+        {
+            return CLOGGER_FALSE;
+        }
+    }
+
+    while (*glob == '*')
+    {
+        glob++;
+    }
+
+    return *glob == '\0';
+}
+
+typedef struct clog_site_toggle
+{
+    const char* file_glob;
+    const char* function_glob;
+    unsigned char enabled;
+    size_t matched;
+} clog_site_toggle_t;
+
+static void toggle_site(clog_site_t* site, void* context)
+{
+    clog_site_toggle_t* toggle = context;
+
+    if ((toggle->file_glob == NULL || clog_site_glob_match(toggle->file_glob, site->file))
+        && (toggle->function_glob == NULL || clog_site_glob_match(toggle->function_glob, site->function)))
+    {
+        site->enabled = toggle->enabled;
+        toggle->matched++;
+    }
+}
+
+size_t clog_site_set_enabled(const char* file_glob, const char* function_glob, int enabled)
+{
+    clog_site_toggle_t toggle = {file_glob, function_glob, enabled ? CLOGGER_TRUE : CLOGGER_FALSE, 0};
+
+    clog_site_foreach(toggle_site, &toggle);
+
+    return toggle.matched;
+}
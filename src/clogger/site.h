@@ -0,0 +1,192 @@
+//! @file
+//! @brief Registered call sites that can be switched on and off at runtime
+//! @details Each `CLOG_SITE_*`/`CLOGGER_SITE_*` macro emits a static `clog_site_t` describing the call (file, line,
+//! function, format string and level), with a pointer to it in the `clog_sites` linker section. The macro checks the
+//! site's `enabled` byte inline before evaluating any argument, so a disabled site costs a single load and branch.
+//! `clog_site_set_enabled()` switches sites on and off by file and function glob, much like the kernel's dynamic debug,
+//! e.g. to turn on the debug messages of one module in production without touching the others.
+//!
+//! The function name is used as the location of the message. `DEBUG` sites start disabled unless
+//! `CLOGGER_SITE_DEBUG_ENABLED` is defined to `1`, every other level starts enabled. Sites still obey
+//! `CLOGGER_MIN_LEVEL` and, for a `clogger_t`, its `log_level`.
+//! @note Enumerating sites needs GCC or Clang targeting ELF or Mach-O, elsewhere the macros work but no site is found.
+//! Only the sites linked into the executable are found, not those of shared libraries it loads.
+
+#ifndef CLOGGER_SITE_H
+#define CLOGGER_SITE_H
+
+#include "core.h"
+#include "clog.h"
+#include "clogger.h"
+#include "clog_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__) && (defined(__ELF__) || defined(__APPLE__))
+/// @brief `1` when call sites are collected in a linker section and can be enumerated
+#define CLOGGER_HAVE_SITE_SECTION 1
+#else
+#define CLOGGER_HAVE_SITE_SECTION 0
+#endif
+
+#ifndef CLOGGER_SITE_DEBUG_ENABLED
+/// @brief Whether `DEBUG` sites start enabled, `0` to have them wait for `clog_site_set_enabled()`
+#define CLOGGER_SITE_DEBUG_ENABLED 0
+#endif
+
+/// @brief Static description of a logging call site
+typedef struct clog_site
+{
+    const char* file; ///< Source file, as given by `__FILE__`
+    const char* function; ///< Enclosing function, also the location of its messages
+    const char* format; ///< The format string
+    int line; ///< Line number
+    clog_level_t level; ///< The log level
+    volatile unsigned char enabled; ///< `CLOGGER_TRUE` if the site logs, read inline by the macros
+} clog_site_t;
+
+/// @brief Function called for each site by `clog_site_foreach()`
+typedef void (* clog_site_callback_t)(clog_site_t* site, void* context);
+
+/// @brief Call a function for every call site linked into the executable
+/// @param callback [in] Function to call
+/// @param context [in] Passed on to `callback`
+/// @return Number of sites
+size_t clog_site_foreach(clog_site_callback_t callback, void* context);
+
+/// @brief Enable or disable every call site whose file and function match
+/// @details Globs match the whole string, `*` standing for any run of characters (slashes included) and `?` for any
+/// single one, e.g. `clog_site_set_enabled("*/net/*", NULL, CLOGGER_TRUE)`
+/// @param file_glob [in] Glob the file must match, `NULL` for any file
+/// @param function_glob [in] Glob the function must match, `NULL` for any function
+/// @param enabled [in] `CLOGGER_TRUE` to enable the sites, `CLOGGER_FALSE` to disable them
+/// @return Number of sites that matched
+size_t clog_site_set_enabled(const char* file_glob, const char* function_glob, int enabled);
+
+/// @brief Whether a string matches a glob, as used by `clog_site_set_enabled()`
+/// @param glob [in] The glob
+/// @param text [in] The string
+/// @return `CLOGGER_TRUE` if it matches, otherwise `CLOGGER_FALSE`
+int clog_site_glob_match(const char* glob, const char* text);
+
+/// @brief Expands to the format string, the first of the variable arguments of a site macro
+#define CLOGGER_SITE_FORMAT(format, ...) format
+
+/// @brief Starting value of the `enabled` byte of a site
+#define CLOGGER_SITE_DEFAULT(level) ((level) == CLOG_LEVEL_DEBUG ? CLOGGER_SITE_DEBUG_ENABLED : CLOGGER_TRUE)
+
+#if CLOGGER_HAVE_SITE_SECTION && defined(__APPLE__)
+#define CLOGGER_SITE_SECTION_NAME "__DATA,clog_sites"
+#else
+#define CLOGGER_SITE_SECTION_NAME "clog_sites"
+#endif
+
+#if CLOGGER_HAVE_SITE_SECTION
+/// @brief Puts a pointer to `site` in the `clog_sites` linker section
+#define CLOGGER_SITE_REGISTER(site) \
+    static clog_site_t* const clogger_site_entry_ __attribute__((section(CLOGGER_SITE_SECTION_NAME), used)) = &(site)
+#else
+#define CLOGGER_SITE_REGISTER(site) (void) 0
+#endif
+
+/// @brief Declares the site of the enclosing block as `clogger_site_`
+#define CLOGGER_SITE_DECLARE(level, format) \
+    static clog_site_t clogger_site_ = {__FILE__, __func__, format, __LINE__, level, CLOGGER_SITE_DEFAULT(level)}; \
+    CLOGGER_SITE_REGISTER(clogger_site_)
+
+/// @brief Calls a `clog_*` function only if its site is enabled, before its arguments are evaluated
+#define CLOGGER_SITE_CALL(level, log_function, ...) \
+    do \
+    { \
+        CLOGGER_SITE_DECLARE(level, CLOGGER_SITE_FORMAT(__VA_ARGS__, 0)); \
+        if (clogger_site_.enabled) \
+        { \
+            log_function(clogger_site_.function, __VA_ARGS__); \
+        } \
+    } while (0)
+
+/// @brief Calls a `clogger_*` function only if its site is enabled and `logger` would log at `level`, before its
+/// arguments are evaluated
+#define CLOGGER_SITE_LOGGER_CALL(logger, level, log_function, ...) \
+    do \
+    { \
+        CLOGGER_SITE_DECLARE(level, CLOGGER_SITE_FORMAT(__VA_ARGS__, 0)); \
+        if (clogger_site_.enabled) \
+        { \
+            CLOGGER_IF_LEVEL(logger, level, log_function, clogger_site_.function, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_MESSAGE
+/// @brief `clog_message()` from a registered site, e.g. `CLOG_SITE_MESSAGE("Loaded %d items", count)`
+#define CLOG_SITE_MESSAGE(...) CLOGGER_SITE_CALL(CLOG_LEVEL_MESSAGE, clog_message, __VA_ARGS__)
+#else
+#define CLOG_SITE_MESSAGE(...) CLOGGER_DISCARD(clog_message(__func__, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_INFO
+/// @brief `clog_info()` from a registered site
+#define CLOG_SITE_INFO(...) CLOGGER_SITE_CALL(CLOG_LEVEL_INFO, clog_info, __VA_ARGS__)
+
+/// @brief `clogger_info()` from a registered site
+#define CLOGGER_SITE_INFO(logger, ...) CLOGGER_SITE_LOGGER_CALL(logger, CLOG_LEVEL_INFO, clogger_info, __VA_ARGS__)
+#else
+#define CLOG_SITE_INFO(...) CLOGGER_DISCARD(clog_info(__func__, __VA_ARGS__))
+#define CLOGGER_SITE_INFO(logger, ...) CLOGGER_DISCARD(clogger_info(logger, __func__, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_DEBUG
+/// @brief `clog_debug()` from a registered site, disabled until `clog_site_set_enabled()` unless
+/// `CLOGGER_SITE_DEBUG_ENABLED` is `1`
+#define CLOG_SITE_DEBUG(...) CLOGGER_SITE_CALL(CLOG_LEVEL_DEBUG, clog_debug, __VA_ARGS__)
+
+/// @brief `clogger_debug()` from a registered site, disabled until `clog_site_set_enabled()` unless
+/// `CLOGGER_SITE_DEBUG_ENABLED` is `1`
+#define CLOGGER_SITE_DEBUG(logger, ...) CLOGGER_SITE_LOGGER_CALL(logger, CLOG_LEVEL_DEBUG, clogger_debug, __VA_ARGS__)
+#else
+#define CLOG_SITE_DEBUG(...) CLOGGER_DISCARD(clog_debug(__func__, __VA_ARGS__))
+#define CLOGGER_SITE_DEBUG(logger, ...) CLOGGER_DISCARD(clogger_debug(logger, __func__, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_WARNING
+/// @brief `clog_warning()` from a registered site
+#define CLOG_SITE_WARNING(...) CLOGGER_SITE_CALL(CLOG_LEVEL_WARNING, clog_warning, __VA_ARGS__)
+
+/// @brief `clogger_warning()` from a registered site
+#define CLOGGER_SITE_WARNING(logger, ...) \
+    CLOGGER_SITE_LOGGER_CALL(logger, CLOG_LEVEL_WARNING, clogger_warning, __VA_ARGS__)
+#else
+#define CLOG_SITE_WARNING(...) CLOGGER_DISCARD(clog_warning(__func__, __VA_ARGS__))
+#define CLOGGER_SITE_WARNING(logger, ...) CLOGGER_DISCARD(clogger_warning(logger, __func__, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_ERROR
+/// @brief `clog_error()` from a registered site
+#define CLOG_SITE_ERROR(...) CLOGGER_SITE_CALL(CLOG_LEVEL_ERROR, clog_error, __VA_ARGS__)
+
+/// @brief `clogger_error()` from a registered site
+#define CLOGGER_SITE_ERROR(logger, ...) CLOGGER_SITE_LOGGER_CALL(logger, CLOG_LEVEL_ERROR, clogger_error, __VA_ARGS__)
+#else
+#define CLOG_SITE_ERROR(...) CLOGGER_DISCARD(clog_error(__func__, __VA_ARGS__))
+#define CLOGGER_SITE_ERROR(logger, ...) CLOGGER_DISCARD(clogger_error(logger, __func__, __VA_ARGS__))
+#endif
+
+#if CLOGGER_MIN_LEVEL <= CLOGGER_LEVEL_CRITICAL
+/// @brief `clog_critical()` from a registered site
+#define CLOG_SITE_CRITICAL(...) CLOGGER_SITE_CALL(CLOG_LEVEL_CRITICAL, clog_critical, __VA_ARGS__)
+
+/// @brief `clogger_critical()` from a registered site
+#define CLOGGER_SITE_CRITICAL(logger, ...) \
+    CLOGGER_SITE_LOGGER_CALL(logger, CLOG_LEVEL_CRITICAL, clogger_critical, __VA_ARGS__)
+#else
+#define CLOG_SITE_CRITICAL(...) CLOGGER_DISCARD(clog_critical(__func__, __VA_ARGS__))
+#define CLOGGER_SITE_CRITICAL(logger, ...) CLOGGER_DISCARD(clogger_critical(logger, __func__, __VA_ARGS__))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_SITE_H
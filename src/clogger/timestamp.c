@@ -0,0 +1,143 @@
+#include "timestamp.h"
+#include "clogger_pch.h"
+
+#include <stdatomic.h>
+
+#define CLOGGER_CLOCK_LENGTH 8
+
+static atomic_int timestamp_precision = CLOG_TIMESTAMP_SECONDS;
+
+// `HH:MM:SS` of the last second rendered on this thread
+static _Thread_local time_t cached_second = (time_t) -1;
+static _Thread_local char cached_clock[CLOGGER_CLOCK_LENGTH];
+
+// UTC offset in seconds of the last second rendered on any thread, for `clog_format_timestamp_safe()`
+static atomic_long utc_offset = 0;
+
+static const char digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+// Write `value` as exactly `width` digits, zero padded
+static void write_digits(char* buffer, unsigned long value, int width)
+{
+    while (width >= 2)
+    {
+        width -= 2;
+        memcpy(buffer + width, digit_pairs + (value % 100) * 2, 2);
+        value /= 100;
+    }
+
+    if (width == 1)
+    {
+        buffer[0] = (char) ('0' + value % 10);
+    }
+}
+
+static void render_clock(time_t second)
+{
+    struct tm local;
+
+#ifdef WIN32
+    localtime_s(&local, &second);
+#else
+    localtime_r(&second, &local);
+    atomic_store_explicit(&utc_offset, local.tm_gmtoff, memory_order_relaxed);
+#endif
+
+    write_digits(cached_clock, (unsigned long) local.tm_hour, 2);
+    cached_clock[2] = ':';
+    write_digits(cached_clock + 3, (unsigned long) local.tm_min, 2);
+    cached_clock[5] = ':';
+    write_digits(cached_clock + 6, (unsigned long) local.tm_sec, 2);
+
+    cached_second = second;
+}
+
+void clog_set_timestamp_precision(clog_timestamp_precision_t precision)
+{
+    atomic_store_explicit(&timestamp_precision, precision, memory_order_relaxed);
+}
+
+clog_timestamp_precision_t clog_get_timestamp_precision()
+{
+    return (clog_timestamp_precision_t) atomic_load_explicit(&timestamp_precision, memory_order_relaxed);
+}
+
+void clog_timestamp_now(struct timespec* timestamp)
+{
+    timespec_get(timestamp, TIME_UTC);
+}
+
+// Append the fraction of a second the precision asks for to `HH:MM:SS` and terminate the timestamp
+static size_t render_fraction(char* buffer, const struct timespec* timestamp)
+{
+    size_t length = CLOGGER_CLOCK_LENGTH;
+
+    switch (clog_get_timestamp_precision())
+    {
+        case CLOG_TIMESTAMP_MILLISECONDS:
+            buffer[length++] = '.';
+            write_digits(buffer + length, (unsigned long) timestamp->tv_nsec / 1000000, 3);
+            length += 3;
+            break;
+        case CLOG_TIMESTAMP_MICROSECONDS:
+            buffer[length++] = '.';
+            write_digits(buffer + length, (unsigned long) timestamp->tv_nsec / 1000, 6);
+            length += 6;
+            break;
+        case CLOG_TIMESTAMP_NANOSECONDS:
+            buffer[length++] = '.';
+            write_digits(buffer + length, (unsigned long) timestamp->tv_nsec, 9);
+            length += 9;
+            break;
+        default:
+            break;
+    }
+
+    buffer[length] = '\0';
+
+    return length;
+}
+
+size_t clog_format_timestamp(char* buffer, const struct timespec* timestamp)
+{
+    if (timestamp->tv_sec != cached_second)
+    {
+        render_clock(timestamp->tv_sec);
+    }
+
+    memcpy(buffer, cached_clock, CLOGGER_CLOCK_LENGTH);
+
+    return render_fraction(buffer, timestamp);
+}
+
+size_t clog_format_timestamp_safe(char* buffer, const struct timespec* timestamp)
+{
+    long long local = (long long) timestamp->tv_sec + atomic_load_explicit(&utc_offset, memory_order_relaxed);
+    long long second_of_day = ((local % 86400) + 86400) % 86400;
+
+    write_digits(buffer, (unsigned long) (second_of_day / 3600), 2);
+    buffer[2] = ':';
+    write_digits(buffer + 3, (unsigned long) (second_of_day / 60 % 60), 2);
+    buffer[5] = ':';
+    write_digits(buffer + 6, (unsigned long) (second_of_day % 60), 2);
+
+    return render_fraction(buffer, timestamp);
+}
+
+void clog_timestamp_prepare_safe()
+{
+    struct timespec now;
+
+    clog_timestamp_now(&now);
+    render_clock(now.tv_sec);
+}
@@ -0,0 +1,61 @@
+//! @file
+//! @brief Timestamp capture and rendering
+
+#ifndef CLOGGER_TIMESTAMP_H
+#define CLOGGER_TIMESTAMP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <time.h>
+
+/// @brief Size of a buffer large enough to hold any timestamp from `clog_format_timestamp()`, e.g. `12:34:56.123456789`
+#define CLOGGER_TIMESTAMP_SIZE 20
+
+/// @brief Enum representing how precise the printed timestamps are
+typedef enum clog_timestamp_precision
+{
+    CLOG_TIMESTAMP_SECONDS, ///< `HH:MM:SS`, the default
+    CLOG_TIMESTAMP_MILLISECONDS, ///< `HH:MM:SS.mmm`
+    CLOG_TIMESTAMP_MICROSECONDS, ///< `HH:MM:SS.uuuuuu`
+    CLOG_TIMESTAMP_NANOSECONDS ///< `HH:MM:SS.nnnnnnnnn`
+} clog_timestamp_precision_t;
+
+/// @brief Set how precise the printed timestamps are
+/// @param precision [in] The timestamp precision
+void clog_set_timestamp_precision(clog_timestamp_precision_t precision);
+
+/// @brief Get how precise the printed timestamps are
+/// @return The timestamp precision
+clog_timestamp_precision_t clog_get_timestamp_precision();
+
+/// @brief Get the current wall clock time
+/// @param timestamp [out] Receives the current time
+void clog_timestamp_now(struct timespec* timestamp);
+
+/// @brief Render a timestamp in local time at the configured precision
+/// @details The `HH:MM:SS` part is cached per thread and only rebuilt when the second changes, so this is normally
+/// just a comparison and a copy
+/// @param buffer [out] Buffer of at least `CLOGGER_TIMESTAMP_SIZE` characters to receive the null terminated timestamp
+/// @param timestamp [in] The time to render
+/// @return Length of the rendered timestamp
+size_t clog_format_timestamp(char* buffer, const struct timespec* timestamp);
+
+/// @brief Render a timestamp like `clog_format_timestamp()`, but async-signal-safe
+/// @details Local time comes from the UTC offset of the last timestamp rendered by any thread, so it can be off by the
+/// daylight saving shift when no message has been logged since the change
+/// @param buffer [out] Buffer of at least `CLOGGER_TIMESTAMP_SIZE` characters to receive the null terminated timestamp
+/// @param timestamp [in] The time to render
+/// @return Length of the rendered timestamp
+size_t clog_format_timestamp_safe(char* buffer, const struct timespec* timestamp);
+
+/// @brief Look up the current UTC offset for `clog_format_timestamp_safe()` before anything has been logged
+void clog_timestamp_prepare_safe();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CLOGGER_TIMESTAMP_H
@@ -0,0 +1,210 @@
+// Async backend under contention: with many producers and a small queue, every message must be written exactly once
+// and each thread's messages in the order that thread logged them, in both queue modes. When full queues overwrite
+// their oldest message instead, every message must be written or dropped by the time `clog_flush()` returns.
+
+#include <clogger.h>
+
+#include "clogger/line.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_FILE_PATH "test_async.log"
+
+#define TEST_PRODUCERS 8
+
+#define TEST_MESSAGES 20000
+
+static int failures = 0;
+
+static clogger_t logger;
+
+static void* produce(void* arg)
+{
+    int producer = (int) (size_t) arg;
+
+    for (int i = 0; i < TEST_MESSAGES; i++)
+    {
+        clogger_warning_async(&logger, "queue", "%d %d", producer, i);
+    }
+
+    return NULL;
+}
+
+// Waits for some of its messages along the way, which must return even while other producers overwrite the queue
+static void* produce_waiting(void* arg)
+{
+    int producer = (int) (size_t) arg;
+
+    for (int i = 0; i < TEST_MESSAGES; i++)
+    {
+        clog_ticket_t ticket = clogger_warning_async(&logger, "queue", "%d %d", producer, i);
+
+        if (i % 100 == 0)
+        {
+            clog_wait(ticket);
+        }
+    }
+
+    return NULL;
+}
+
+static void run(clog_async_mode_t mode, const char* name)
+{
+    remove(TEST_FILE_PATH);
+
+    clog_file_sink_t* sink = clog_file_sink_open(TEST_FILE_PATH, CLOGGER_FILE_SINK_DEFAULT_BUFFER_SIZE, 0);
+    clog_async_config_t config = clog_async_default_config();
+
+    // Small enough that the producers keep catching up with the backend and wrapping around
+    config.mode = mode;
+    config.capacity = 64;
+    config.thread_capacity = 64;
+
+    if (!clog_expect(sink != NULL && clog_async_start(&config), __FUNCTION__, "Could not start %s", name))
+    {
+        failures++;
+        return;
+    }
+
+    logger = make_clogger("async");
+    logger.file_sink = sink;
+
+    pthread_t threads[TEST_PRODUCERS];
+
+    for (size_t i = 0; i < TEST_PRODUCERS; i++)
+    {
+        pthread_create(&threads[i], NULL, produce, (void*) i);
+    }
+
+    for (size_t i = 0; i < TEST_PRODUCERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    clog_async_flush();
+    clog_async_stop();
+
+    logger.file_sink = NULL;
+    clog_file_sink_close(sink);
+
+    FILE* file = fopen(TEST_FILE_PATH, "r");
+
+    if (!clog_expect(file != NULL, __FUNCTION__, "Could not read %s", TEST_FILE_PATH))
+    {
+        failures++;
+        return;
+    }
+
+    int next[TEST_PRODUCERS] = {0};
+    int in_order = CLOGGER_TRUE;
+    size_t count = 0;
+    char line[CLOGGER_LINE_SIZE];
+
+    while (fgets(line, sizeof line, file) != NULL)
+    {
+        const char* message = strstr(line, "queue >> ");
+        int producer;
+        int sequence;
+
+        if (message == NULL || sscanf(message, "queue >> %d %d", &producer, &sequence) != 2 || producer < 0
+            || producer >= TEST_PRODUCERS || sequence != next[producer])
+        {
+            in_order = CLOGGER_FALSE;
+            break;
+        }
+
+        next[producer]++;
+        count++;
+    }
+
+    fclose(file);
+
+    failures += !clog_expect(in_order, __FUNCTION__, "%s: line %zu out of order or malformed: %s", name, count, line);
+    failures += !clog_expect_size_eq((size_t) TEST_PRODUCERS * TEST_MESSAGES, count, __FUNCTION__,
+                                     "%s: number of messages written", name);
+    failures += !clog_expect_size_eq(0, clog_async_dropped_count(), __FUNCTION__, "%s: messages dropped", name);
+}
+
+static size_t count_lines()
+{
+    FILE* file = fopen(TEST_FILE_PATH, "r");
+    char line[CLOGGER_LINE_SIZE];
+    size_t count = 0;
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+
+    while (fgets(line, sizeof line, file) != NULL)
+    {
+        count += strstr(line, "queue >> ") != NULL;
+    }
+
+    fclose(file);
+
+    return count;
+}
+
+// Producers evict records while the backend may still be writing earlier ones
+static void run_overwriting(clog_async_mode_t mode, const char* name)
+{
+    remove(TEST_FILE_PATH);
+
+    clog_file_sink_t* sink = clog_file_sink_open(TEST_FILE_PATH, CLOGGER_FILE_SINK_DEFAULT_BUFFER_SIZE, 0);
+    clog_async_config_t config = clog_async_default_config();
+
+    config.mode = mode;
+    config.capacity = 64;
+    config.thread_capacity = 64;
+
+    if (!clog_expect(sink != NULL && clog_async_start(&config), __FUNCTION__, "Could not start %s", name))
+    {
+        failures++;
+        return;
+    }
+
+    logger = make_clogger("async");
+    logger.file_sink = sink;
+    logger.backpressure = CLOG_BACKPRESSURE_OVERWRITE_OLDEST;
+
+    size_t dropped_before = clog_async_dropped_count();
+    pthread_t threads[TEST_PRODUCERS];
+
+    for (size_t i = 0; i < TEST_PRODUCERS; i++)
+    {
+        pthread_create(&threads[i], NULL, produce_waiting, (void*) i);
+    }
+
+    for (size_t i = 0; i < TEST_PRODUCERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Read before stopping the backend, which would write whatever `clog_flush()` missed
+    clog_flush();
+
+    size_t written = count_lines();
+    size_t dropped = clog_async_dropped_count() - dropped_before;
+
+    clog_async_stop();
+
+    logger.file_sink = NULL;
+    clog_file_sink_close(sink);
+
+    failures += !clog_expect_size_eq((size_t) TEST_PRODUCERS * TEST_MESSAGES, written + dropped, __FUNCTION__,
+                                     "%s: messages written or dropped, %zu dropped", name, dropped);
+}
+
+int main()
+{
+    run(CLOG_ASYNC_SHARED_QUEUE, "shared queue");
+    run(CLOG_ASYNC_THREAD_BUFFERS, "thread buffers");
+    run_overwriting(CLOG_ASYNC_SHARED_QUEUE, "shared queue overwriting the oldest");
+    run_overwriting(CLOG_ASYNC_THREAD_BUFFERS, "thread buffers overwriting the oldest");
+
+    return failures > 0;
+}
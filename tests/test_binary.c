@@ -0,0 +1,124 @@
+// Binary sink round trip: messages written to a `clog_binary_sink_t` and decoded with `clogger-decode` must read as
+// they would have in a `clog_file_sink_t`
+//
+// Usage: test_binary <path to clogger-decode>
+
+#include <clogger.h>
+
+#include "clogger/line.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+#define TEST_FILE_PATH "test_binary.bin"
+
+#define TEST_MAX_LINES 16
+
+static int failures = 0;
+
+static char expected[TEST_MAX_LINES][CLOGGER_LINE_SIZE];
+static size_t expected_count = 0;
+
+// Lines are compared without their timestamp, i.e. from the logger name on
+static void expect_line(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(expected[expected_count++], CLOGGER_LINE_SIZE, format, args);
+    va_end(args);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <path to clogger-decode>\n", argv[0]);
+        return 1;
+    }
+
+    clog_binary_sink_t* sink = clog_binary_sink_open(TEST_FILE_PATH, CLOGGER_BINARY_SINK_DEFAULT_BUFFER_SIZE, 0);
+
+    if (!clog_expect(sink != NULL, __FUNCTION__, "Could not open %s", TEST_FILE_PATH))
+    {
+        return 1;
+    }
+
+    clogger_t logger = make_clogger("binary");
+
+    logger.binary_sink = sink;
+
+    clogger_warning(&logger, "round_trip", "%d %u %lld %s %c %.2f", -1, 7U, 123456789012LL, "text", 'x', 2.5);
+    expect_line("binary >> [WARNING] >> round_trip >> -1 7 123456789012 text x 2.50");
+
+    clogger_error(&logger, "round_trip", "[%-6s] [%5d] [%x]", "ab", 42, 0xbeefU);
+    expect_line("binary >> [ERROR] >> round_trip >> [ab    ] [   42] [beef]");
+
+    // Wide strings can't be deferred, the sink stores the formatted text instead
+    clogger_warning(&logger, "round_trip", "%ls", L"wide");
+    expect_line("binary >> [WARNING] >> round_trip >> wide");
+
+    // Sites must be told apart by their text, not by where it's kept
+    char name[16];
+    char location[16];
+    char format[32];
+
+    strcpy(name, "name0");
+
+    clogger_t reused = make_clogger(name);
+
+    reused.binary_sink = sink;
+
+    for (int i = 0; i < 4; i++)
+    {
+        snprintf(name, sizeof name, "name%d", i % 2);
+        snprintf(location, sizeof location, "location%d", i % 3);
+        strcpy(format, i % 2 ? "odd %d" : "even %d");
+
+        clogger_warning(&reused, location, format, i);
+        expect_line("name%d >> [WARNING] >> location%d >> %s %d", i % 2, i % 3, i % 2 ? "odd" : "even", i);
+    }
+
+    reused.binary_sink = NULL;
+    logger.binary_sink = NULL;
+    clog_binary_sink_close(sink);
+
+    char command[4096];
+
+    snprintf(command, sizeof command, "'%s' " TEST_FILE_PATH, argv[1]);
+
+    FILE* decoded = popen(command, "r");
+
+    if (!clog_expect(decoded != NULL, __FUNCTION__, "Could not run %s", command))
+    {
+        return 1;
+    }
+
+    char line[CLOGGER_LINE_SIZE];
+    size_t count = 0;
+
+    while (fgets(line, sizeof line, decoded) != NULL)
+    {
+        const char* fields = strstr(line, " >> ");
+
+        line[strcspn(line, "\n")] = '\0';
+
+        if (!clog_expect(fields != NULL && count < expected_count, __FUNCTION__, "Unexpected line \"%s\"", line))
+        {
+            failures++;
+            continue;
+        }
+
+        fields += 4;
+        failures += !clog_expect_str_eq(expected[count], sizeof expected[count], fields, strlen(fields) + 1,
+                                        __FUNCTION__, "Line %zu", count);
+        count++;
+    }
+
+    failures += !clog_expect(pclose(decoded) == 0, __FUNCTION__, "%s failed", command);
+    failures += !clog_expect_size_eq(expected_count, count, __FUNCTION__, "Number of decoded lines");
+
+    return failures > 0;
+}
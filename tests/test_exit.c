@@ -0,0 +1,160 @@
+// Exiting without `clog_flush()`: everything logged must still reach its sink, whatever was set up first. Each case
+// runs in a child process that logs and calls `exit()`, the parent then reads what it left behind.
+//
+// Usage: test_exit [<path to clogger-decode>], the binary sink is only checked with the decoder
+
+#include <clogger.h>
+
+#include "clogger/line.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TEST_FILE_PATH "test_exit.log"
+
+#define TEST_BINARY_PATH "test_exit.bin"
+
+#define TEST_MESSAGES 2000
+
+static int failures = 0;
+
+// Outlives everything it queues, until the exit hooks have run
+static clogger_t logger;
+
+// The sink is opened after the backend is started, so its own exit hook would otherwise run before the drain
+static void file_sink_after_async()
+{
+    clog_async_start(NULL);
+
+    logger = make_clogger("exit");
+    logger.file_sink = clog_file_sink_open(TEST_FILE_PATH, CLOGGER_FILE_SINK_DEFAULT_BUFFER_SIZE, 0);
+
+    for (int i = 0; i < TEST_MESSAGES; i++)
+    {
+        clogger_warning_async(&logger, "exit", "message %d", i);
+    }
+}
+
+static void binary_sink_after_async()
+{
+    clog_async_start(NULL);
+
+    logger = make_clogger("exit");
+    logger.binary_sink = clog_binary_sink_open(TEST_BINARY_PATH, CLOGGER_BINARY_SINK_DEFAULT_BUFFER_SIZE, 0);
+
+    for (int i = 0; i < TEST_MESSAGES; i++)
+    {
+        clogger_warning_async(&logger, "exit", "message %d", i);
+    }
+}
+
+// Without the backend every message gets a thread of its own, and nothing else has an exit hook
+static void detached_to_console()
+{
+    FILE* output = fopen(TEST_FILE_PATH, "w");
+
+    if (output == NULL)
+    {
+        exit(1);
+    }
+
+    dup2(fileno(output), STDOUT_FILENO);
+    fclose(output);
+
+    logger = make_clogger("exit");
+
+    for (int i = 0; i < TEST_MESSAGES; i++)
+    {
+        clogger_warning_async(&logger, "exit", "message %d", i);
+    }
+}
+
+static size_t count_messages(FILE* file)
+{
+    char line[CLOGGER_LINE_SIZE];
+    size_t count = 0;
+
+    while (fgets(line, sizeof line, file) != NULL)
+    {
+        count += strstr(line, " >> message ") != NULL;
+    }
+
+    return count;
+}
+
+static size_t count_lines(const char* path)
+{
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+
+    size_t count = count_messages(file);
+
+    fclose(file);
+
+    return count;
+}
+
+static const char* decoder = NULL;
+
+static size_t count_decoded(const char* path)
+{
+    char command[4096];
+
+    snprintf(command, sizeof command, "'%s' %s", decoder, path);
+
+    FILE* decoded = popen(command, "r");
+
+    if (decoded == NULL)
+    {
+        return 0;
+    }
+
+    size_t count = count_messages(decoded);
+
+    pclose(decoded);
+
+    return count;
+}
+
+static void run(void (* log_then_exit)(), size_t (* count)(const char* path), const char* path, const char* name)
+{
+    remove(path);
+    fflush(stdout);
+
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        log_then_exit();
+        exit(0);
+    }
+
+    int status = 0;
+
+    failures += !clog_expect(child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status)
+                             && WEXITSTATUS(status) == 0, __FUNCTION__, "%s: child failed", name);
+    failures += !clog_expect_size_eq(TEST_MESSAGES, count(path), __FUNCTION__, "%s: messages written", name);
+
+    remove(path);
+}
+
+int main(int argc, char** argv)
+{
+    run(file_sink_after_async, count_lines, TEST_FILE_PATH, "file sink opened after the backend started");
+    run(detached_to_console, count_lines, TEST_FILE_PATH, "detached messages to the console");
+
+    if (argc > 1)
+    {
+        decoder = argv[1];
+        run(binary_sink_after_async, count_decoded, TEST_BINARY_PATH, "binary sink opened after the backend started");
+    }
+
+    return failures > 0;
+}
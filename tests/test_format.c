@@ -0,0 +1,122 @@
+// Deferred formatting: arguments captured by `clog_format_capture()` and rendered later must give the same text as
+// formatting them on the spot
+
+#include <clogger.h>
+
+#include "clogger/deferred.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+// Capture the arguments as the `_async` functions do, render them as the backend does and compare with `vsnprintf()`
+static void check(const char* format, ...)
+{
+    char expected[256];
+    char actual[256];
+    unsigned char data[512];
+    va_list args;
+    va_list capture_args;
+
+    va_start(args, format);
+    va_copy(capture_args, args);
+    vsnprintf(expected, sizeof expected, format, args);
+    va_end(args);
+
+    const clog_format_t* parsed = clog_format_lookup(format);
+
+    if (!clog_expect(parsed != NULL, __FUNCTION__, "\"%s\" can't be deferred", format))
+    {
+        failures++;
+        va_end(capture_args);
+        return;
+    }
+
+    size_t length = clog_format_capture(parsed, data, sizeof data, capture_args);
+    va_end(capture_args);
+
+    failures += !clog_expect(length > 0 || parsed->spec_count == 0, __FUNCTION__, "Nothing captured for \"%s\"",
+                             format);
+    failures += !clog_expect(clog_format_validate(parsed, data, length), __FUNCTION__,
+                             "Arguments of \"%s\" don't validate", format);
+
+    clog_format_render(parsed, data, length, actual, sizeof actual);
+
+    failures += !clog_expect_str_eq(expected, sizeof expected, actual, sizeof actual, __FUNCTION__,
+                                    "Rendering \"%s\"", format);
+}
+
+// The signal-safe renderer only handles plain conversions, which it must print exactly as `snprintf()` would
+static void check_safe(const char* format, const char* expected, ...)
+{
+    char actual[256];
+    unsigned char data[512];
+    va_list args;
+
+    va_start(args, expected);
+    const clog_format_t* parsed = clog_format_lookup(format);
+    size_t length = parsed != NULL ? clog_format_capture(parsed, data, sizeof data, args) : 0;
+    va_end(args);
+
+    if (!clog_expect(parsed != NULL, __FUNCTION__, "\"%s\" can't be deferred", format))
+    {
+        failures++;
+        return;
+    }
+
+    clog_format_render_safe(parsed, data, length, actual, sizeof actual);
+
+    failures += !clog_expect_str_eq(expected, strlen(expected) + 1, actual, sizeof actual, __FUNCTION__,
+                                    "Safe rendering \"%s\"", format);
+}
+
+int main()
+{
+    int value = 42;
+
+    check("No conversions at all");
+    check("%%d is not a conversion, %d is", -7);
+    check("%d %i %u", -1, 2147483647, 4000000000U);
+    check("%hd %hhu %ld %lu", (short) -300, (unsigned char) 200, -5000000000L, 5000000000UL);
+    check("%lld %llu %jd %zu %td", -9000000000000LL, 18000000000000000000ULL, (intmax_t) -1, (size_t) 123,
+          (ptrdiff_t) -4);
+    check("%x %X %o %#x %08x", 0xbeefU, 0xbeefU, 0755U, 255U, 0xabcU);
+    check("[%c] [%5c] [%-3c]", 'a', 'b', 'c');
+    check("[%s] [%10s] [%-10s] [%.3s]", "text", "right", "left", "truncated");
+    check("%f %8.3f %-10.1f| %e %g %G", 3.14159, -2.5, 0.25, 123456.789, 0.0001, 1e20);
+    check("%Lf", (long double) 1.5);
+    check("%p", (void*) &value);
+    check("[%*d] [%-*d] [%.*f] [%*.*s]", 6, 12, 6, 12, 2, 3.14159, 8, 3, "abcdef");
+    check("%s said %d things about %s", "someone", 3, "something");
+
+    check_safe("%d %u %ld %llu", "-12 34 -56 78", -12, 34U, -56L, 78ULL);
+    check_safe("%x %o %c %s", "ff 17 z text", 255U, 15U, 'z', "text");
+
+    // `%n` can't be captured, the message is formatted on the spot instead
+    failures += !clog_expect(clog_format_lookup("%d%n") == NULL, __FUNCTION__, "%%n was deferred");
+
+    // Nor can `L` on an integer, whose argument type depends on the C library
+    failures += !clog_expect(clog_format_lookup("%Ld") == NULL && clog_format_lookup("%Lu") == NULL, __FUNCTION__,
+                             "%%Ld or %%Lu was deferred");
+
+    // A buffer reused for a different format must never be rendered with the parse of the old one
+    char format[32];
+
+    strcpy(format, "%d apples");
+    const clog_format_t* first = clog_format_lookup(format);
+
+    failures += !clog_expect(first != NULL && strcmp(first->format, "%d apples") == 0, __FUNCTION__,
+                             "First format of a buffer not cached");
+
+    strcpy(format, "%s pears");
+    const clog_format_t* second = clog_format_lookup(format);
+
+    failures += !clog_expect(second == NULL || strcmp(second->format, "%s pears") == 0, __FUNCTION__,
+                             "Stale parse returned for a reused buffer");
+
+    return failures > 0;
+}
@@ -0,0 +1,157 @@
+// File rotation by size: no line may be lost, split or reordered across segments, and only `retention` rotated
+// segments may be kept
+
+#include <clogger.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_FILE_PATH "test_rotation.log"
+
+#define TEST_MAX_BYTES 1024
+
+#define TEST_RETENTION 3
+
+#define TEST_CHUNKS 12
+
+// Each chunk is more than `TEST_MAX_BYTES`, so every chunk rotates once the next segment is ready
+#define TEST_LINES_PER_CHUNK 100
+
+static int failures = 0;
+
+static void segment_path(char* path, size_t size, unsigned int segment)
+{
+    if (segment == 0)
+    {
+        snprintf(path, size, "%s", TEST_FILE_PATH);
+    }
+    else
+    {
+        snprintf(path, size, "%s.%u", TEST_FILE_PATH, segment);
+    }
+}
+
+static void remove_segments()
+{
+    char path[256];
+
+    for (unsigned int segment = 0; segment <= TEST_CHUNKS + 1; segment++)
+    {
+        segment_path(path, sizeof path, segment);
+        remove(path);
+    }
+}
+
+// Give the background thread time to prepare the next segment
+static void pause_briefly()
+{
+    struct timespec delay = {0, 20000000L};
+
+    nanosleep(&delay, NULL);
+}
+
+int main()
+{
+    remove_segments();
+
+    clog_file_sink_t* sink = clog_file_sink_open(TEST_FILE_PATH, 0, 0);
+    clog_rotation_config_t config = {.max_bytes = TEST_MAX_BYTES, .retention = TEST_RETENTION};
+
+    if (!clog_expect(sink != NULL && clog_file_sink_set_rotation(sink, &config), __FUNCTION__,
+                     "Could not open %s with rotation", TEST_FILE_PATH))
+    {
+        return 1;
+    }
+
+    int line_number = 0;
+
+    for (int chunk = 0; chunk < TEST_CHUNKS; chunk++)
+    {
+        pause_briefly();
+
+        for (int i = 0; i < TEST_LINES_PER_CHUNK; i++)
+        {
+            char line[32];
+            int length = snprintf(line, sizeof line, "line %06d\n", line_number++);
+
+            failures += !clog_expect(clog_file_sink_write(sink, line, (size_t) length), __FUNCTION__,
+                                     "Could not write line %d", line_number - 1);
+        }
+    }
+
+    clog_file_sink_close(sink);
+
+    // Oldest segment first, the lines must carry on from one segment to the next up to the last one written
+    char path[256];
+    int first_line = -1;
+    int expected_line = -1;
+    int segments = 0;
+
+    for (int segment = TEST_CHUNKS + 1; segment >= 0; segment--)
+    {
+        segment_path(path, sizeof path, (unsigned int) segment);
+
+        FILE* file = fopen(path, "r");
+
+        if (file == NULL)
+        {
+            continue;
+        }
+
+        char line[64];
+        int number;
+
+        segments++;
+
+        while (fgets(line, sizeof line, file) != NULL)
+        {
+            if (!clog_expect(sscanf(line, "line %d", &number) == 1 && strlen(line) == 12, __FUNCTION__,
+                             "Malformed line in %s: %s", path, line))
+            {
+                failures++;
+                break;
+            }
+
+            if (first_line < 0)
+            {
+                first_line = expected_line = number;
+            }
+
+            if (!clog_expect(number == expected_line, __FUNCTION__, "%s: expected line %d, got %d", path,
+                             expected_line, number))
+            {
+                failures++;
+                break;
+            }
+
+            expected_line++;
+        }
+
+        fclose(file);
+    }
+
+    segment_path(path, sizeof path, TEST_RETENTION + 1);
+
+    FILE* dropped = fopen(path, "r");
+
+    failures += !clog_expect(dropped == NULL, __FUNCTION__, "%s kept beyond the retention", path);
+
+    if (dropped != NULL)
+    {
+        fclose(dropped);
+    }
+
+    failures += !clog_expect(segments >= 2, __FUNCTION__, "Never rotated, %d segment(s)", segments);
+    failures += !clog_expect(expected_line == line_number, __FUNCTION__, "Last line %d of %d", expected_line,
+                             line_number);
+
+    // Only the oldest lines may be missing, and only once a whole segment had to go
+    failures += !clog_expect(segments <= TEST_RETENTION + 1, __FUNCTION__, "%d segments kept", segments);
+    failures += !clog_expect(first_line == 0 || segments == TEST_RETENTION + 1, __FUNCTION__,
+                             "Lines from line %d on lost without dropping a segment", first_line);
+
+    remove_segments();
+
+    return failures > 0;
+}
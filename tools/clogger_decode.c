@@ -0,0 +1,423 @@
+// Turn a binary log file written by a `clog_binary_sink_t` back into text
+//
+// Every message is printed exactly as `clog_messagef()` would have written it to a `clog_file_sink_t`, or with the
+// layout given by `--layout` for files written by loggers with a layout of their own. Timestamps are shown in the local
+// time zone, set `TZ` to match the machine that wrote the file.
+//
+// Usage: clogger-decode [--layout <pattern>] [<file>]
+//
+// Reads standard input without a file. A file cut short part way through an entry, e.g. by a crash, is decoded up to
+// that entry with a warning.
+
+#include <clogger.h>
+
+#include "clogger/deferred.h"
+#include "clogger/line.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Same fields as the built-in plain layout
+#define DECODE_DEFAULT_LAYOUT "%t >> %{%n >> %}%{[%L] >> %}%{%loc >> %}%m"
+
+typedef enum decode_status
+{
+    DECODE_OK,
+    DECODE_END,
+    DECODE_TRUNCATED,
+    DECODE_INVALID,
+    DECODE_UNSUPPORTED // The header was rejected, the reason has been reported
+} decode_status_t;
+
+typedef struct decode_site
+{
+    clog_level_t level;
+    char* name;
+    char* location;
+    char* format;
+    clog_format_t* parsed; // `NULL` if the format can't be deferred, its messages are all text
+    clogger_t logger;
+} decode_site_t;
+
+typedef struct decode_message
+{
+    const clog_format_t* format; // `NULL` if `data` is text
+    const unsigned char* data;
+    size_t length;
+} decode_message_t;
+
+typedef struct decoder
+{
+    FILE* input;
+    clog_layout_t* layout;
+    decode_site_t* sites;
+    size_t site_count;
+    size_t site_capacity;
+    unsigned char* data;
+    size_t data_capacity;
+    long long timestamp_ns;
+} decoder_t;
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [--layout <pattern>] [<file>]\n", program);
+}
+
+static decode_status_t read_bytes(decoder_t* decoder, void* buffer, size_t length)
+{
+    return fread(buffer, 1, length, decoder->input) == length ? DECODE_OK : DECODE_TRUNCATED;
+}
+
+static decode_status_t read_varint(decoder_t* decoder, unsigned long long* value)
+{
+    *value = 0;
+
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = fgetc(decoder->input);
+
+        if (byte == EOF)
+        {
+            return DECODE_TRUNCATED;
+        }
+
+        *value |= (unsigned long long) (byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            return DECODE_OK;
+        }
+    }
+
+    return DECODE_INVALID;
+}
+
+// Read a string, `NULL` when it was written as one
+static decode_status_t read_string(decoder_t* decoder, char** text)
+{
+    unsigned long long length;
+    decode_status_t status = read_varint(decoder, &length);
+
+    *text = NULL;
+
+    if (status != DECODE_OK || length == 0)
+    {
+        return status;
+    }
+
+    if (length > SIZE_MAX / 2 || (*text = malloc((size_t) length)) == NULL)
+    {
+        return DECODE_INVALID;
+    }
+
+    (*text)[length - 1] = '\0';
+
+    return read_bytes(decoder, *text, (size_t) length - 1);
+}
+
+static void free_site(decode_site_t* site)
+{
+    free(site->name);
+    free(site->location);
+    free(site->format);
+    free(site->parsed);
+}
+
+static decode_status_t read_header(decoder_t* decoder)
+{
+    static const unsigned char sizes[] = {
+            sizeof(short), sizeof(int), sizeof(long), sizeof(long long), sizeof(intmax_t), sizeof(size_t),
+            sizeof(ptrdiff_t), sizeof(double), sizeof(long double), sizeof(void*)
+    };
+    unsigned char header[CLOGGER_BINARY_HEADER_SIZE];
+    unsigned long long opened_ns;
+    uint32_t byte_order;
+
+    if (read_bytes(decoder, header, sizeof header) != DECODE_OK || memcmp(header, "CLOGBIN", 7) != 0)
+    {
+        fprintf(stderr, "clogger-decode: Not a clogger binary log file\n");
+        return DECODE_UNSUPPORTED;
+    }
+
+    if (header[7] != CLOGGER_BINARY_VERSION)
+    {
+        fprintf(stderr, "clogger-decode: Unsupported file version %u, expected %u\n", header[7],
+                CLOGGER_BINARY_VERSION);
+        return DECODE_UNSUPPORTED;
+    }
+
+    memcpy(&byte_order, header + 8 + sizeof sizes, sizeof byte_order);
+
+    if (memcmp(header + 8, sizes, sizeof sizes) != 0 || byte_order != 0x01020304)
+    {
+        fprintf(stderr, "clogger-decode: The file was written on a machine with different type sizes or byte order\n");
+        return DECODE_UNSUPPORTED;
+    }
+
+    clog_set_timestamp_precision((clog_timestamp_precision_t) header[8 + sizeof sizes + sizeof byte_order]);
+
+    decode_status_t status = read_varint(decoder, &opened_ns);
+
+    decoder->timestamp_ns = (long long) opened_ns;
+
+    return status;
+}
+
+static decode_status_t read_site(decoder_t* decoder)
+{
+    decode_site_t site = {0};
+    unsigned long long id;
+    decode_status_t status = read_varint(decoder, &id);
+    int level = status == DECODE_OK ? fgetc(decoder->input) : 0;
+
+    if (status != DECODE_OK || level == EOF)
+    {
+        return status != DECODE_OK ? status : DECODE_TRUNCATED;
+    }
+
+    // Sites are numbered in the order they're written
+    if (id != decoder->site_count)
+    {
+        return DECODE_INVALID;
+    }
+
+    site.level = (clog_level_t) level;
+
+    if ((status = read_string(decoder, &site.name)) != DECODE_OK
+        || (status = read_string(decoder, &site.location)) != DECODE_OK
+        || (status = read_string(decoder, &site.format)) != DECODE_OK)
+    {
+        free_site(&site);
+        return status;
+    }
+
+    if (site.format != NULL && (site.parsed = malloc(sizeof(clog_format_t))) != NULL
+        && !clog_format_parse(site.format, site.parsed))
+    {
+        free(site.parsed);
+        site.parsed = NULL;
+    }
+
+    site.logger.name = site.name;
+
+    if (decoder->site_count == decoder->site_capacity)
+    {
+        size_t capacity = decoder->site_capacity > 0 ? decoder->site_capacity * 2 : 64;
+        decode_site_t* sites = realloc(decoder->sites, capacity * sizeof(decode_site_t));
+
+        if (sites == NULL)
+        {
+            free_site(&site);
+            return DECODE_INVALID;
+        }
+
+        decoder->sites = sites;
+        decoder->site_capacity = capacity;
+    }
+
+    decoder->sites[decoder->site_count++] = site;
+
+    return DECODE_OK;
+}
+
+static void append_message(struct clog_line* line, const void* context)
+{
+    const decode_message_t* message = context;
+
+    if (message->format == NULL)
+    {
+        clog_line_append(line, (const char*) message->data, message->length);
+        return;
+    }
+
+    size_t length = clog_format_render(message->format, message->data, message->length, NULL, 0);
+    char* end = clog_line_reserve(line, length + 1);
+
+    if (end != NULL)
+    {
+        clog_format_render(message->format, message->data, message->length, end, length + 1);
+        line->length += length;
+    }
+}
+
+static decode_status_t read_message(decoder_t* decoder, int text)
+{
+    unsigned long long id;
+    unsigned long long zigzag;
+    unsigned long long length;
+    decode_status_t status;
+
+    if ((status = read_varint(decoder, &id)) != DECODE_OK || (status = read_varint(decoder, &zigzag)) != DECODE_OK
+        || (status = read_varint(decoder, &length)) != DECODE_OK)
+    {
+        return status;
+    }
+
+    if (id >= decoder->site_count || length > SIZE_MAX / 2)
+    {
+        return DECODE_INVALID;
+    }
+
+    if (length > decoder->data_capacity)
+    {
+        unsigned char* data = realloc(decoder->data, (size_t) length);
+
+        if (data == NULL)
+        {
+            return DECODE_INVALID;
+        }
+
+        decoder->data = data;
+        decoder->data_capacity = (size_t) length;
+    }
+
+    if ((status = read_bytes(decoder, decoder->data, (size_t) length)) != DECODE_OK)
+    {
+        return status;
+    }
+
+    decode_site_t* site = &decoder->sites[id];
+    decode_message_t message = {text ? NULL : site->parsed, decoder->data, (size_t) length};
+
+    if (!text && (site->parsed == NULL || !clog_format_validate(site->parsed, decoder->data, (size_t) length)))
+    {
+        return DECODE_INVALID;
+    }
+
+    decoder->timestamp_ns += (long long) (zigzag >> 1) ^ -(long long) (zigzag & 1);
+
+    struct timespec timestamp = {
+            (time_t) (decoder->timestamp_ns / 1000000000LL), (long) (decoder->timestamp_ns % 1000000000LL)
+    };
+    clog_line_t* line = clog_line_begin();
+
+    clog_layout_render(decoder->layout, line, CLOGGER_TRUE, site->level, site->name != NULL ? &site->logger : NULL,
+                       site->location, &timestamp, append_message, &message);
+    clog_line_append(line, "\n", 1);
+    clog_line_write(line, stdout);
+
+    return DECODE_OK;
+}
+
+static decode_status_t decode(decoder_t* decoder)
+{
+    decode_status_t status = read_header(decoder);
+
+    while (status == DECODE_OK)
+    {
+        int tag = fgetc(decoder->input);
+
+        switch (tag)
+        {
+            case EOF:
+                status = DECODE_END;
+                break;
+            case CLOGGER_BINARY_SITE:
+                status = read_site(decoder);
+                break;
+            case CLOGGER_BINARY_RECORD:
+                status = read_message(decoder, CLOGGER_FALSE);
+                break;
+            case CLOGGER_BINARY_TEXT:
+                status = read_message(decoder, CLOGGER_TRUE);
+                break;
+            case CLOGGER_BINARY_PRECISION:
+            {
+                int precision = fgetc(decoder->input);
+
+                if (precision == EOF)
+                {
+                    status = DECODE_TRUNCATED;
+                }
+                else
+                {
+                    clog_set_timestamp_precision((clog_timestamp_precision_t) precision);
+                }
+                break;
+            }
+            default:
+                status = DECODE_INVALID;
+                break;
+        }
+    }
+
+    return status;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* pattern = DECODE_DEFAULT_LAYOUT;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--layout") == 0 || strcmp(argv[i], "-l") == 0) && i + 1 < argc)
+        {
+            pattern = argv[++i];
+        }
+        else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        else if (path == NULL && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    decoder_t decoder = {0};
+
+    decoder.layout = clog_layout_compile(pattern);
+
+    if (decoder.layout == NULL)
+    {
+        fprintf(stderr, "clogger-decode: Invalid layout \"%s\"\n", pattern);
+        return EXIT_FAILURE;
+    }
+
+    decoder.input = path != NULL ? fopen(path, "rb") : stdin;
+
+    if (decoder.input == NULL)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    decode_status_t status = decode(&decoder);
+    long offset = ftell(decoder.input);
+
+    if (status == DECODE_TRUNCATED)
+    {
+        fprintf(stderr, "clogger-decode: The file ends part way through an entry\n");
+    }
+    else if (status == DECODE_INVALID)
+    {
+        fprintf(stderr, "clogger-decode: Invalid entry before offset %ld\n", offset);
+    }
+
+    fflush(stdout);
+
+    if (decoder.input != stdin)
+    {
+        fclose(decoder.input);
+    }
+
+    for (size_t i = 0; i < decoder.site_count; i++)
+    {
+        free_site(&decoder.sites[i]);
+    }
+
+    free(decoder.sites);
+    free(decoder.data);
+    clog_layout_free(decoder.layout);
+
+    return status == DECODE_INVALID || status == DECODE_UNSUPPORTED ? EXIT_FAILURE : EXIT_SUCCESS;
+}